@@ -6,13 +6,64 @@
 #define I2C_SH1107_ADDR 0x3C
 #define I2C_CAMM8_FREQ 400000
 #define I2C_CAMM8_ADDR 0x42
+#define I2C_QUEUE_DEPTH 40
+#define SPI_DISPLAY_FREQ 20000000
+#define SSD1351_CHUNK_ROWS 8
+#define DISPLAY_BAND_ROWS 8
 #define DISPLAY_TIMEOUT 30000
 #define HOLD_TIME_TO_LOCK 500
 #define LOG_BUFFER_SIZE 100
+#define LOG_BLOCK_BYTES 48
+#define LOG_BLOCK_COUNT 12
+#define LOG_COLUMN_SEARCH_CACHE 64
+#define LOG_QUEUE_SIZE 32
+#define SDLOG_PAGE_BUFFERS 4
+#define SDLOG_INDEX_INTERVAL 16
+#define SDLOG_FLUSH_PERIOD 1000
+// Raw blocks owned by the SD log, the card's partitions must start after them
+#define SDLOG_FIRST_BLOCK 2048
+#define SDLOG_BLOCK_COUNT 65536
+// Placeholders until a board revision wires the card, check them before enabling it
+#define SDCARD_CLK GPIO_NUM_12
+#define SDCARD_CMD GPIO_NUM_11
+#define SDCARD_D0 GPIO_NUM_13
+#define SAMPLER_MAX_SENSORS 8
+#define SAMPLER_MAX_CHANNELS 3
+#define SAMPLER_MAX_BUSES 3
+#define SAMPLER_QUEUE_SIZE 32
+#define SAMPLER_COALESCE_US 2000
+#define PARALLEL_DRAW_CORE 1
+// Frames that drew faster than this serially are not worth handing half to the other core
+#define PARALLEL_DRAW_MIN_US 2000
+// Split frames between serial measurements, and serial frames after a split lost
+#define PARALLEL_DRAW_REMEASURE 30
+#define SURFACE_POOL_BYTES 4096
+#define SURFACE_POOL_SLOTS 8
+#define DISPLAY_LIST_SCRATCH 2048
+#define DISPLAY_LIST_SOURCES 16
+#define UI_OVERLAYS 4
+#define UI_TRANSITION_FRAMES 8
+#define UI_PRERENDERS 4
+#define UI_PRERENDER_BYTES 10240
+#define UI_PRERENDER_INTERVAL 2000
+// Time a frame may take, idle frames prerender only while the last prerender fits in what is left
+#define UI_FRAME_BUDGET_US 20000
+#define UI_SCREEN_ARENAS 3
+#define UI_SCREEN_ARENA_BYTES 2048
+#define UI_LIST_ROWS 16
+#define UI_SCROLL_STEP 8
+#define SCREEN_MIRROR_BAUD 921600
+#define SCREEN_MIRROR_TX_BUFFER 4096
+#define SCREEN_MIRROR_INTERVAL_MS 100
+#define SCREEN_MIRROR_KEYFRAME_INTERVAL 50
 
 #ifdef __linux__
 #define INPUT_DEBUG
 #define USE_EVENT_DBG
 #endif
 
-#define USE_LAYOUT_DBG
\ No newline at end of file
+#define USE_LAYOUT_DBG
+//#define USE_SCREEN_MIRROR
+//#define USE_SSD1351
+//#define USE_BAND_RENDERER
+//#define USE_PARALLEL_DRAW
\ No newline at end of file
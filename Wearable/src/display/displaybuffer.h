@@ -3,10 +3,18 @@
 #include "framebuffer.h"
 #include "sh1107.h"
 
+#include <string.h>
+
+#ifdef USE_SSD1351
+#include "ssd1351_buffer.h"
+#endif
+
 namespace wbl {
 
 template<uint8_t WIDTH, uint8_t HEIGHT, uint8_t BPP>
 struct FramebufferPageT : public FramebufferT<StaticbufferT<WIDTH, HEIGHT, BPP>> {
+    static constexpr fb PAGE_ROWS = 8;
+
     inline constexpr fb getOffset(const fb &x, const fb &y) const {
         return (y / 8) * this->WIDTH + x;
     }
@@ -41,12 +49,50 @@ struct FramebufferPageT : public FramebufferT<StaticbufferT<WIDTH, HEIGHT, BPP>>
         const fb bytemask = bitmask << bits;
         return ((this->buffer[offset] & bytemask) >> bits) & bitmask;
     }
+
+    /*
+        @brief Vertical span from y0 to y1 inclusive, one masked byte per page
+    */
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        const fb first = y0 >> 3;
+        const fb last = y1 >> 3;
+        pixel *column = &this->buffer[first * this->WIDTH + x];
+
+        for (fb page = first; page <= last; page++, column += this->WIDTH) {
+            pixel mask = 0xff;
+            if (page == first)
+                mask &= 0xff << (y0 & 7);
+            if (page == last)
+                mask &= 0xff >> (7 - (y1 & 7));
+
+            if (px)
+                *column |= mask;
+            else
+                *column &= ~mask;
+        }
+    }
 };
 
 template<typename Display, typename Frame = FramebufferPageT<Display::WIDTH, Display::HEIGHT, 1>>
 struct DisplayBufferT : public Frame, public Display {
     static constexpr const char *TAG = "wbl::DisplayBufferT";
 
+    // Copy of the frame being sent, one command and one data transfer per page
+    uint8_t transfer_commands[Display::PAGES][4];
+    uint8_t transfer_pages[Display::PAGES][Display::BYTES_PER_PAGE + 1];
+    I2CTransaction command_transactions[Display::PAGES], page_transactions[Display::PAGES];
+    // Display start line sent after the pages of a scroll
+    uint8_t transfer_scroll[3];
+    I2CTransaction scroll_transaction;
+    // Control commands queued behind the frame, the UI task never waits on the bus
+    static constexpr uint8_t CONTROL_SLOTS = 4;
+    uint8_t transfer_control[CONTROL_SLOTS][3];
+    I2CTransaction control_transactions[CONTROL_SLOTS];
+    uint32_t frames_skipped = 0;
+
+    // Runs after each frame is handed to the display, e.g. for a screen mirror
+    void (*on_flush)(const uint8_t *frame) = nullptr;
+
     inline esp_err_t init() {
         ESP_RETURN_ON_ERROR(Display::init(), TAG, "display init failed");
 
@@ -56,27 +102,200 @@ struct DisplayBufferT : public Frame, public Display {
         return ESP_OK;
     }
 
-    inline esp_err_t flush() {
+    inline bool flush_busy() const {
+        for (uint8_t page = 0; page < Display::PAGES; page++)
+            if (command_transactions[page].busy() || page_transactions[page].busy())
+                return true;
+        return scroll_transaction.busy();
+    }
+
+    inline bool control_busy() const {
+        for (const I2CTransaction &t : control_transactions)
+            if (t.busy())
+                return true;
+        return false;
+    }
+
+    inline esp_err_t queue_control(const uint8_t &command, const uint8_t &argument, const uint8_t &size) {
+        for (uint8_t slot = 0; slot < CONTROL_SLOTS; slot++) {
+            I2CTransaction &t = control_transactions[slot];
+            if (t.busy())
+                continue;
+
+            uint8_t *data = transfer_control[slot];
+            data[0] = 0x00;
+            data[1] = command;
+            data[2] = argument;
+
+            t.write_data = data;
+            t.write_size = size;
+            t.priority = I2C_PRIORITY_DISPLAY;
+            ESP_RETURN_ON_ERROR(this->submit(t), TAG, "submit control failed");
+
+            return ESP_OK;
+        }
+
+        return ESP_ERR_NO_MEM;
+    }
+
+    inline esp_err_t setState(const bool &on = true) {
+        if (!Display::arbiter().running)
+            return Display::setState(on);
+        return queue_control(on ? SH1107::ON : SH1107::OFF, 0, 2);
+    }
+
+    inline esp_err_t setContrast(const uint8_t &contrast = 0x7f) {
+        if (!Display::arbiter().running)
+            return Display::setContrast(contrast);
+        return queue_control(SH1107::SET_CONTRAST, contrast, 3);
+    }
+
+    inline esp_err_t setInverted(const bool &inverted_colors = false) {
+        if (!Display::arbiter().running)
+            return Display::setInverted(inverted_colors);
+        return queue_control(inverted_colors ? SH1107::INVERT : SH1107::NORMAL, 0, 2);
+    }
+
+    inline esp_err_t setStartLine(const uint8_t &line = 0) {
+        if (!Display::arbiter().running)
+            return Display::setStartLine(line);
+        return queue_control(SH1107::SET_DISPLAYSTARTLINE, uint8_t(line % Display::HEIGHT), 3);
+    }
+
+    // Remap and scan direction go out as one command pair
+    inline esp_err_t setOrientation(const uint8_t &flags = 0) {
+        if (!Display::arbiter().running)
+            return Display::setOrientation(flags);
+        const uint8_t remap = (flags & Display::FLIP_VERTICAL) ? SH1107::SEGREMAPINV : SH1107::SEGREMAP;
+        const uint8_t scan_direction = (flags & Display::FLIP_HORIZONTAL) ? SH1107::COMSCANDEC : SH1107::COMSCANINC;
+        return queue_control(remap, scan_direction, 3);
+    }
+
+    inline esp_err_t setDisplay(const uint8_t &flags = 0) {
+        ESP_RETURN_ON_ERROR(setInverted(flags & Display::COLOR_INVERT), TAG, "setInverted failed");
+        ESP_RETURN_ON_ERROR(setState(!(flags & Display::DISPLAY_OFF)), TAG, "setState failed");
+        ESP_RETURN_ON_ERROR(setOrientation(flags), TAG, "setOrientation failed");
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t queue_page(const uint8_t &page) {
+        uint8_t *command = transfer_commands[page];
+        command[0] = 0x00;
+        command[1] = SH1107::SET_PAGEADDR + page;
+        command[2] = 0x10;
+        command[3] = 0x00;
+
+        uint8_t *data = transfer_pages[page];
+        data[0] = 0x40;
+        memcpy(data + 1, &this->buffer[page * Display::BYTES_PER_PAGE], Display::BYTES_PER_PAGE);
+
+        I2CTransaction &c = command_transactions[page];
+        c.write_data = command;
+        c.write_size = sizeof(transfer_commands[page]);
+        c.priority = I2C_PRIORITY_DISPLAY;
+        ESP_RETURN_ON_ERROR(this->submit(c), TAG, "submit page command failed");
+
+        I2CTransaction &d = page_transactions[page];
+        d.write_data = data;
+        d.write_size = sizeof(transfer_pages[page]);
+        d.priority = I2C_PRIORITY_DISPLAY;
+        ESP_RETURN_ON_ERROR(this->submit(d), TAG, "submit page data failed");
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t write_page(const uint8_t &page) {
         const uint8_t size = 32;
         const uint8_t dc = 0x40;
-        uint8_t *ptr = &this->buffer[0];
-        for (uint8_t page = 0; page < Display::PAGES; page++) {
-            uint8_t bytes_remaining = Display::BYTES_PER_PAGE;
-            ESP_RETURN_ON_ERROR(Display::setPagePosition(page), TAG, "setPagePosition failed");
-            while (bytes_remaining > 0) {
-                const uint8_t count = bytes_remaining > size ? size : bytes_remaining;
-                ESP_RETURN_ON_ERROR(Display::write_payload(ptr, count, &dc, 1), TAG, "write_payload failed");
-                ptr += count;
-                bytes_remaining -= count;
-            }
+        uint8_t *ptr = &this->buffer[page * Display::BYTES_PER_PAGE];
+        uint8_t bytes_remaining = Display::BYTES_PER_PAGE;
+        ESP_RETURN_ON_ERROR(Display::setPagePosition(page), TAG, "setPagePosition failed");
+        while (bytes_remaining > 0) {
+            const uint8_t count = bytes_remaining > size ? size : bytes_remaining;
+            ESP_RETURN_ON_ERROR(Display::write_payload(ptr, count, &dc, 1), TAG, "write_payload failed");
+            ptr += count;
+            bytes_remaining -= count;
+        }
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Queues the frame on the bus arbiter and returns immediately
+
+        While the previous frame is still on the bus the new one is skipped.
+    */
+    inline esp_err_t flush_async() {
+        if (flush_busy()) {
+            frames_skipped++;
+            return ESP_OK;
+        }
+
+        for (uint8_t page = 0; page < Display::PAGES; page++)
+            ESP_RETURN_ON_ERROR(queue_page(page), TAG, "queue_page failed");
+
+        if (on_flush)
+            on_flush(this->buffer);
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t flush() {
+        if (Display::arbiter().running)
+            return flush_async();
+
+        for (uint8_t page = 0; page < Display::PAGES; page++)
+            ESP_RETURN_ON_ERROR(write_page(page), TAG, "write_page failed");
+
+        if (on_flush)
+            on_flush(this->buffer);
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Sends count pages from first, wrapping past the last, then moves the display start line
+
+        Rows a scroll keeps in view are already in GRAM, only the pages it
+        brings in are sent. A scroll is never skipped, while a frame is still
+        on the bus it returns ESP_ERR_INVALID_STATE so the caller retries.
+    */
+    inline esp_err_t flush_scroll(const uint8_t &first, const uint8_t &count, const uint8_t &line) {
+        if (!Display::arbiter().running) {
+            for (uint8_t i = 0; i < count; i++)
+                ESP_RETURN_ON_ERROR(write_page((first + i) % Display::PAGES), TAG, "write_page failed");
+            return Display::setStartLine(line);
         }
 
+        if (flush_busy())
+            return ESP_ERR_INVALID_STATE;
+
+        for (uint8_t i = 0; i < count; i++)
+            ESP_RETURN_ON_ERROR(queue_page((first + i) % Display::PAGES), TAG, "queue_page failed");
+
+        transfer_scroll[0] = 0x00;
+        transfer_scroll[1] = SH1107::SET_DISPLAYSTARTLINE;
+        transfer_scroll[2] = line % Display::HEIGHT;
+
+        scroll_transaction.write_data = transfer_scroll;
+        scroll_transaction.write_size = sizeof(transfer_scroll);
+        scroll_transaction.priority = I2C_PRIORITY_DISPLAY;
+        ESP_RETURN_ON_ERROR(this->submit(scroll_transaction), TAG, "submit start line failed");
+
         return ESP_OK;
     }
 };
 
 using I2C_SH1107 = I2C<I2C_SH1107_ADDR, I2C_DISPLAY_FREQ>;
 using GME128128 = SH1107::Display<128, 128, I2C_SH1107>;
-using DisplayBuffer = DisplayBufferT<GME128128>;
+#if defined(USE_SSD1351) && defined(USE_BAND_RENDERER)
+using DisplayBuffer = SSD1351BandBuffer;
+#elif defined(USE_SSD1351)
+using DisplayBuffer = SSD1351Buffer;
+#else
+// Clipped for parallel draws and scroll containers
+using DisplayBuffer = DisplayBufferT<GME128128, ClippedT<FramebufferPageT<128, 128, 1>>>;
+#endif
 
 }
\ No newline at end of file
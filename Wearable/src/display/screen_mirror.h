@@ -0,0 +1,462 @@
+#pragma once
+
+#include "esp_system.h"
+#include "wbl_func.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+#include <string.h>
+
+namespace wbl {
+
+/*
+    @brief Framebuffer deltas streamed to a host over a serial link
+
+    Each message carries the spans of the frame that changed since the last
+    message the host received, every span packed with a PackBits style RLE.
+    The frame is sent as raw bytes grouped in pages, either SH1107 pages
+    (one byte is 8 vertical pixels, LSB on top) or 1bpp rows (LSB leftmost).
+
+    Message layout, little endian:
+        'W' 'M'             sync
+        u16 length          bytes from version up to the checksum
+        u8  version
+        u8  flags           MIRROR_KEYFRAME
+        u16 sequence        message counter, a gap means messages were lost
+        u32 frame           frames offered to the mirror so far
+        u32 time_ms
+        u16 encode_us       time spent encoding this message
+        u16 skipped         frames not sent since the previous message
+        u8  layout
+        u16 pages
+        u16 page_bytes
+        u16 span count
+        spans               u8 page, u8 offset, u8 length - 1, RLE data
+        u16 checksum        Fletcher-16 from version to the last span
+
+    RLE control bytes below 0x80 are followed by control + 1 literal bytes,
+    from 0x80 up one byte is repeated control - 0x80 + 2 times.
+*/
+enum MirrorLayout : uint8_t {
+    MIRROR_LAYOUT_PAGES = 0,
+    MIRROR_LAYOUT_ROWS = 1,
+};
+
+enum MirrorFlags : uint8_t {
+    MIRROR_KEYFRAME = 1,
+};
+
+struct MirrorInfo {
+    uint8_t flags = 0;
+    uint16_t sequence = 0;
+    uint32_t frame = 0;
+    uint32_t time_ms = 0;
+    uint16_t encode_us = 0;
+    uint16_t skipped = 0;
+    uint16_t spans = 0;
+};
+
+namespace Mirror {
+    static constexpr const uint8_t SYNC0 = 'W', SYNC1 = 'M';
+    static constexpr const uint8_t VERSION = 1;
+    static constexpr const size_t PREFIX = 4;
+    static constexpr const size_t HEADER = 27;
+    static constexpr const size_t CHECKSUM = 2;
+    static constexpr const size_t SPAN = 3;
+
+    // Unchanged bytes shorter than this stay inside the span, a new span costs about as much
+    static constexpr const uint8_t MERGE_GAP = 4;
+
+    inline constexpr size_t capacity(const size_t &pages, const size_t &page_bytes) {
+        return HEADER + CHECKSUM + pages * (page_bytes + page_bytes / 4 + 8);
+    }
+
+    inline uint16_t fletcher16(const uint8_t *data, const size_t &size) {
+        uint16_t a = 0, b = 0;
+        for (size_t i = 0; i < size; i++) {
+            a = (a + data[i]) % 255;
+            b = (b + a) % 255;
+        }
+        return (b << 8) | a;
+    }
+
+    inline void put16(uint8_t *p, const uint16_t &v) { p[0] = v; p[1] = v >> 8; }
+    inline void put32(uint8_t *p, const uint32_t &v) { put16(p, v); put16(p + 2, v >> 16); }
+    inline uint16_t get16(const uint8_t *p) { return p[0] | (p[1] << 8); }
+    inline uint32_t get32(const uint8_t *p) { return get16(p) | (uint32_t(get16(p + 2)) << 16); }
+
+    inline size_t rle_encode(const uint8_t *src, const size_t &size, uint8_t *out) {
+        size_t i = 0, o = 0;
+        while (i < size) {
+            size_t run = 1;
+            while (i + run < size && run < 129 && src[i + run] == src[i])
+                run++;
+
+            if (run >= 2) {
+                out[o++] = 0x80 | (run - 2);
+                out[o++] = src[i];
+                i += run;
+                continue;
+            }
+
+            // Literals until the next run of three, a run of two costs the same either way
+            const size_t start = i;
+            while (i < size && i - start < 128 && !(i + 2 < size && src[i] == src[i + 1] && src[i] == src[i + 2]))
+                i++;
+
+            out[o++] = i - start - 1;
+            memcpy(out + o, src + start, i - start);
+            o += i - start;
+        }
+        return o;
+    }
+
+    /*
+        @brief Decodes exactly size bytes, returns the input consumed or 0 if malformed
+    */
+    inline size_t rle_decode(const uint8_t *src, const size_t &available, uint8_t *out, const size_t &size) {
+        size_t i = 0, o = 0;
+        while (o < size) {
+            if (i >= available)
+                return 0;
+            const uint8_t control = src[i++];
+            if (control & 0x80) {
+                const size_t run = (control & 0x7f) + 2;
+                if (i >= available || o + run > size)
+                    return 0;
+                memset(out + o, src[i++], run);
+                o += run;
+            } else {
+                const size_t run = control + 1;
+                if (i + run > available || o + run > size)
+                    return 0;
+                memcpy(out + o, src + i, run);
+                i += run;
+                o += run;
+            }
+        }
+        return i;
+    }
+}
+
+/*
+    @brief On-device side, encodes flushed frames and writes them to a Port
+
+    Port needs writable(), the bytes that can be queued without blocking,
+    and write(). A message is only written when it fits completely, when the
+    port is still busy the frame is skipped and the next message is a delta
+    against what the host last received. Messages are at least interval_us
+    apart so the mirror never competes with the display for the CPU.
+*/
+template<typename Port, uint16_t PAGES, uint16_t PAGE_BYTES>
+struct ScreenMirrorT {
+    static constexpr const char *TAG = "wbl::ScreenMirrorT";
+    static constexpr const size_t SIZE = size_t(PAGES) * PAGE_BYTES;
+    static constexpr const size_t CAPACITY = Mirror::capacity(PAGES, PAGE_BYTES);
+
+    static_assert(PAGES <= 256 && PAGE_BYTES <= 256, "Spans address pages and offsets with one byte");
+
+    Port &port;
+    MirrorLayout layout;
+    int64_t interval_us;
+    uint16_t keyframe_interval;
+
+    // What the host holds after the last message written
+    uint8_t sent[SIZE];
+    uint8_t message[CAPACITY];
+
+    bool enabled = false;
+    bool force_keyframe = true;
+    uint16_t sequence = 0;
+    uint16_t since_keyframe = 0;
+    uint32_t frames = 0;
+    uint16_t skipped = 0;
+    int64_t last_us = 0;
+
+    // Totals for diagnostics
+    uint32_t messages = 0;
+    uint32_t frames_busy = 0;
+    uint64_t bytes = 0;
+
+    ScreenMirrorT(Port &port, const MirrorLayout &layout, const int64_t &interval_us = 100000, const uint16_t &keyframe_interval = 50)
+        : port(port), layout(layout), interval_us(interval_us), keyframe_interval(keyframe_interval) {}
+
+    inline void start() {
+        enabled = true;
+        force_keyframe = true;
+    }
+
+    inline void stop() { enabled = false; }
+
+    // A new host attached, the next message carries the whole frame
+    inline void resync() { force_keyframe = true; }
+
+    /*
+        @brief Encodes frame into message, returns its size or 0 when nothing changed
+    */
+    inline size_t encode(const uint8_t *frame, const bool &keyframe) {
+        uint8_t *out = message + Mirror::HEADER;
+        uint16_t spans = 0;
+
+        for (uint16_t page = 0; page < PAGES; page++) {
+            const uint8_t *a = frame + page * PAGE_BYTES;
+            const uint8_t *b = sent + page * PAGE_BYTES;
+
+            for (uint16_t x = 0; x < PAGE_BYTES;) {
+                if (!keyframe && a[x] == b[x]) {
+                    x++;
+                    continue;
+                }
+
+                const uint16_t first = x;
+                uint16_t end = ++x;
+                for (; x < PAGE_BYTES && x - end < Mirror::MERGE_GAP; x++)
+                    if (keyframe || a[x] != b[x])
+                        end = x + 1;
+
+                out[0] = page;
+                out[1] = first;
+                out[2] = end - first - 1;
+                out += Mirror::SPAN;
+                out += Mirror::rle_encode(a + first, end - first, out);
+                spans++;
+                x = end;
+            }
+        }
+
+        if (!spans)
+            return 0;
+
+        const size_t length = out - message;
+        uint8_t *h = message;
+        h[0] = Mirror::SYNC0;
+        h[1] = Mirror::SYNC1;
+        Mirror::put16(h + 2, length - Mirror::PREFIX);
+        h[4] = Mirror::VERSION;
+        h[5] = keyframe ? MIRROR_KEYFRAME : 0;
+        Mirror::put16(h + 6, sequence);
+        Mirror::put32(h + 8, frames);
+        Mirror::put32(h + 12, uint32_t(millis()));
+        Mirror::put16(h + 16, 0);
+        Mirror::put16(h + 18, skipped);
+        h[20] = layout;
+        Mirror::put16(h + 21, PAGES);
+        Mirror::put16(h + 23, PAGE_BYTES);
+        Mirror::put16(h + 25, spans);
+
+        return length + Mirror::CHECKSUM;
+    }
+
+    /*
+        @brief Call after every display flush, never waits for the port
+    */
+    inline esp_err_t update(const uint8_t *frame) {
+        if (!enabled)
+            return ESP_OK;
+
+        frames++;
+
+        const int64_t start = micros();
+        if (messages && start - last_us < interval_us) {
+            skipped++;
+            return ESP_OK;
+        }
+
+        const bool keyframe = force_keyframe || since_keyframe >= keyframe_interval;
+        const size_t length = encode(frame, keyframe);
+        if (!length)
+            return ESP_OK;
+
+        if (port.writable() < length) {
+            skipped++;
+            frames_busy++;
+            return ESP_OK;
+        }
+
+        const int64_t elapsed = micros() - start;
+        Mirror::put16(message + 16, elapsed > 0xffff ? 0xffff : uint16_t(elapsed));
+        Mirror::put16(message + length - Mirror::CHECKSUM, Mirror::fletcher16(message + Mirror::PREFIX, length - Mirror::PREFIX - Mirror::CHECKSUM));
+
+        // A short write leaves the host with a broken message, it drops it and waits for a keyframe
+        if (port.write(message, length) != int(length)) {
+            force_keyframe = true;
+            return ESP_FAIL;
+        }
+
+        memcpy(sent, frame, SIZE);
+        sequence++;
+        since_keyframe = keyframe ? 0 : since_keyframe + 1;
+        force_keyframe = false;
+        skipped = 0;
+        last_us = start;
+        messages++;
+        bytes += length;
+
+        return ESP_OK;
+    }
+};
+
+/*
+    @brief Host side, reassembles frames from the byte stream
+
+    Bytes can arrive in any split. Garbage and corrupted messages are
+    skipped by searching for the next sync. After a lost or corrupted
+    message deltas are ignored until the next keyframe.
+*/
+template<size_t MAX_SIZE>
+struct ScreenMirrorDecoderT {
+    // Enough for any message with pages of at least 16 bytes
+    static constexpr const size_t CAPACITY = Mirror::capacity(MAX_SIZE / 16, 16);
+
+    uint8_t frame[MAX_SIZE];
+    MirrorLayout layout = MIRROR_LAYOUT_PAGES;
+    uint16_t pages = 0, page_bytes = 0;
+
+    // Header of the last message applied to frame
+    MirrorInfo info;
+    bool synced = false;
+
+    uint32_t frames = 0;
+    uint32_t errors = 0;
+    uint32_t lost = 0;
+
+    uint8_t rx[CAPACITY];
+    size_t rx_length = 0;
+
+    inline uint16_t width() const { return layout == MIRROR_LAYOUT_PAGES ? page_bytes : page_bytes * 8; }
+    inline uint16_t height() const { return layout == MIRROR_LAYOUT_PAGES ? pages * 8 : pages; }
+
+    inline bool getPixel(const uint16_t &x, const uint16_t &y) const {
+        if (layout == MIRROR_LAYOUT_PAGES)
+            return (frame[(y >> 3) * page_bytes + x] >> (y & 7)) & 1;
+        return (frame[y * page_bytes + (x >> 3)] >> (x & 7)) & 1;
+    }
+
+    /*
+        @brief Applies one complete message, returns false if it was rejected
+    */
+    inline bool apply(const uint8_t *body, const size_t &size) {
+        if (size < Mirror::HEADER - Mirror::PREFIX || body[0] != Mirror::VERSION)
+            return false;
+
+        MirrorInfo m;
+        m.flags = body[1];
+        m.sequence = Mirror::get16(body + 2);
+        m.frame = Mirror::get32(body + 4);
+        m.time_ms = Mirror::get32(body + 8);
+        m.encode_us = Mirror::get16(body + 12);
+        m.skipped = Mirror::get16(body + 14);
+        const uint8_t l = body[16];
+        const uint16_t p = Mirror::get16(body + 17), pb = Mirror::get16(body + 19);
+        m.spans = Mirror::get16(body + 21);
+
+        const bool keyframe = m.flags & MIRROR_KEYFRAME;
+
+        if (synced && m.sequence != uint16_t(info.sequence + 1)) {
+            lost += uint16_t(m.sequence - info.sequence - 1);
+            synced = false;
+        }
+
+        if (!synced && !keyframe)
+            return true;
+
+        if (keyframe) {
+            if (size_t(p) * pb > MAX_SIZE || l > MIRROR_LAYOUT_ROWS)
+                return false;
+            layout = MirrorLayout(l);
+            pages = p;
+            page_bytes = pb;
+        } else if (p != pages || pb != page_bytes) {
+            synced = false;
+            return false;
+        }
+
+        size_t i = Mirror::HEADER - Mirror::PREFIX;
+        for (uint16_t s = 0; s < m.spans; s++) {
+            if (i + Mirror::SPAN > size) {
+                synced = false;
+                return false;
+            }
+            const uint8_t page = body[i], offset = body[i + 1];
+            const size_t length = size_t(body[i + 2]) + 1;
+            i += Mirror::SPAN;
+
+            if (page >= pages || offset + length > page_bytes) {
+                synced = false;
+                return false;
+            }
+
+            const size_t used = Mirror::rle_decode(body + i, size - i, frame + page * page_bytes + offset, length);
+            if (!used) {
+                synced = false;
+                return false;
+            }
+            i += used;
+        }
+
+        info = m;
+        synced = true;
+        frames++;
+        return true;
+    }
+
+    /*
+        @brief Feeds received bytes, returns the number of frames completed
+    */
+    inline int feed(const uint8_t *data, size_t size) {
+        int completed = 0;
+
+        while (size) {
+            const size_t n = size < CAPACITY - rx_length ? size : CAPACITY - rx_length;
+            memcpy(rx + rx_length, data, n);
+            rx_length += n;
+            data += n;
+            size -= n;
+
+            for (;;) {
+                size_t skip = 0;
+                while (skip < rx_length && !(rx[skip] == Mirror::SYNC0 && (skip + 1 == rx_length || rx[skip + 1] == Mirror::SYNC1)))
+                    skip++;
+                consume(skip);
+
+                if (rx_length < Mirror::PREFIX)
+                    break;
+
+                const size_t body = Mirror::get16(rx + 2);
+                const size_t total = Mirror::PREFIX + body + Mirror::CHECKSUM;
+
+                // Too long to be a message, this sync was part of the data
+                if (total > CAPACITY) {
+                    errors++;
+                    consume(1);
+                    continue;
+                }
+
+                if (rx_length < total)
+                    break;
+
+                const uint16_t expected = Mirror::get16(rx + Mirror::PREFIX + body);
+                if (Mirror::fletcher16(rx + Mirror::PREFIX, body) != expected) {
+                    errors++;
+                    consume(1);
+                    continue;
+                }
+
+                const uint32_t before = frames;
+                if (!apply(rx + Mirror::PREFIX, body))
+                    errors++;
+                completed += frames - before;
+                consume(total);
+            }
+        }
+
+        return completed;
+    }
+
+    inline void consume(const size_t &n) {
+        memmove(rx, rx + n, rx_length - n);
+        rx_length -= n;
+    }
+};
+
+}
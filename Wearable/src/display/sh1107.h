@@ -67,6 +67,13 @@ struct Display : public I2C_DEVICE {
         return this->write_command(SH1107::SET_CONTRAST, contrast);
     }
 
+    /*
+        @brief Shows GRAM from row line at the top of the panel, rows wrap around
+    */
+    inline esp_err_t setStartLine(const uint8_t &line = 0) {
+        return this->write_command(SH1107::SET_DISPLAYSTARTLINE, uint8_t(line % HEIGHT));
+    }
+
     inline esp_err_t setOrientation(const uint8_t &flags = 0) {
         uint8_t scan_direction = SH1107::COMSCANINC;
         uint8_t remap = SH1107::SEGREMAP;
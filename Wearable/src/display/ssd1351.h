@@ -0,0 +1,99 @@
+#pragma once
+
+#include "ssd1351_defs.h"
+#include "config.h"
+#include "spi.h"
+
+#include <inttypes.h>
+
+namespace wbl {
+namespace SSD1351 {
+
+template<uint8_t _WIDTH, uint8_t _HEIGHT, typename SPI_DEVICE>
+struct Display : public SPI_DEVICE {
+    static constexpr const char *TAG = "wbl::SSD1351::Display";
+    static constexpr uint8_t WIDTH = _WIDTH;
+    static constexpr uint8_t HEIGHT = _HEIGHT;
+    static constexpr uint8_t BYTES_PER_PIXEL = 2;
+
+    enum {
+        FLIP_NONE = 0,
+        FLIP_HORIZONTAL = 1,
+        FLIP_VERTICAL = 2,
+        COLOR_NORMAL = 4,
+        COLOR_INVERT = 8,
+        DISPLAY_OFF = 16,
+        DISPLAY_ON = 32,
+    };
+
+    /*
+        @brief Limits RAM writes to the window and starts a write, data follows
+    */
+    inline esp_err_t setWindow(const uint8_t &x0, const uint8_t &y0, const uint8_t &x1, const uint8_t &y1) {
+        ESP_RETURN_ON_ERROR(this->write_command(SSD1351::SET_COLUMN, x0, x1), TAG, "set column failed");
+        ESP_RETURN_ON_ERROR(this->write_command(SSD1351::SET_ROW, y0, y1), TAG, "set row failed");
+        ESP_RETURN_ON_ERROR(this->write_command(SSD1351::WRITE_RAM), TAG, "write ram failed");
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t clearDisplay(const uint16_t &color=0x0) {
+        uint8_t row[WIDTH * BYTES_PER_PIXEL];
+        for (uint8_t i = 0; i < WIDTH; i++) {
+            row[i * 2] = color >> 8;
+            row[i * 2 + 1] = color;
+        }
+
+        ESP_RETURN_ON_ERROR(this->setWindow(0, 0, WIDTH - 1, HEIGHT - 1), TAG, "clearDisplay setWindow failed");
+        for (uint8_t y = 0; y < HEIGHT; y++)
+            ESP_RETURN_ON_ERROR(this->transmit(row, sizeof(row), true), TAG, "clearDisplay transmit failed");
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t setInverted(const bool &inverted_colors = false) {
+        return this->write_command(inverted_colors ? SSD1351::INVERT : SSD1351::NORMAL);
+    }
+
+    inline esp_err_t setState(const bool &on = true) {
+        return this->write_command(on ? SSD1351::ON : SSD1351::OFF);
+    }
+
+    // Master current in 16 steps, scaled from the 8 bit contrast the SH1107 takes
+    inline esp_err_t setContrast(const uint8_t &contrast = 0x7f) {
+        return this->write_command(SSD1351::SET_CONTRAST_MASTER, contrast >> 4);
+    }
+
+    inline esp_err_t setOrientation(const uint8_t &flags = 0) {
+        uint8_t remap = SSD1351::REMAP_DEFAULT;
+
+        if (flags & FLIP_HORIZONTAL)
+            remap ^= SSD1351::REMAP_COM_SCAN;
+        if (flags & FLIP_VERTICAL)
+            remap ^= SSD1351::REMAP_COLUMN;
+
+        return this->write_command(SSD1351::SET_REMAP, remap);
+    }
+
+    inline esp_err_t setDisplay(const uint8_t &flags = 0) {
+        ESP_RETURN_ON_ERROR(this->setInverted(flags & COLOR_INVERT), TAG, "setInverted failed");
+        ESP_RETURN_ON_ERROR(this->setState(!(flags & DISPLAY_OFF)), TAG, "setState failed");
+        ESP_RETURN_ON_ERROR(this->setOrientation(flags), TAG, "setOrientation failed");
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t reset() {
+        ESP_RETURN_ON_ERROR(this->write_commands(SSD1351::initcmds, sizeof(SSD1351::initcmds), SSD1351::arguments), TAG, "initcmds failed");
+        return ESP_OK;
+    }
+
+    inline esp_err_t init() {
+        ESP_RETURN_ON_ERROR(SPI_DEVICE::init(), TAG, "spi_device init failed");
+
+        return this->reset();
+    }
+};
+
+}
+}
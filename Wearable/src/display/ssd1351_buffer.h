@@ -0,0 +1,157 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "ssd1351.h"
+
+#include <string.h>
+
+namespace wbl {
+
+/*
+    @brief SSD1351 backend with the DisplayBufferT interface
+
+    Frame is the buffer the UI draws into. RGB565 rows are sent as stored,
+    RGB332 rows go through a lookup table and 1bpp rows (linear, LSB first)
+    are expanded through mono_palette. Rows are converted CHUNK_ROWS at a
+    time into two DMA buffers, the CPU fills one while the other is on the bus.
+
+    A banded Frame (BandT) holds one band of rows. The UI draws the tree per
+    band between begin_band and end_band, and each band is converted and
+    queued as it finishes, so the frame is never held in full. on_flush is
+    not called then.
+*/
+template<typename Display, typename Frame, uint8_t CHUNK_ROWS = SSD1351_CHUNK_ROWS>
+struct SSD1351BufferT : public Frame, public Display {
+    static constexpr const char *TAG = "wbl::SSD1351BufferT";
+    static constexpr size_t CHUNK_PIXELS = size_t(Display::WIDTH) * CHUNK_ROWS;
+    static constexpr bool BANDED = requires { Frame::BANDS; };
+
+    static_assert(Frame::WIDTH == Display::WIDTH && Frame::HEIGHT == Display::HEIGHT, "Frame and display differ in size");
+    static_assert(Frame::BPP == 1 || Frame::BPP == 8 || Frame::BPP == 16, "1bpp, RGB332 or RGB565 frames");
+    static_assert(CHUNK_PIXELS * 2 <= Display::MAX_TRANSFER, "Chunk exceeds the bus transfer size");
+
+    // Big endian RGB565, as the display reads it
+    uint16_t chunks[2][CHUNK_PIXELS];
+    uint8_t chunk = 0;
+
+    // Foreground and background of 1bpp frames
+    PaletteT<FormatRGB565, 2> mono_palette;
+    uint16_t rgb332[Frame::BPP == 8 ? 256 : 1];
+
+    // Runs after each frame is handed to the display, e.g. for a screen mirror
+    void (*on_flush)(const uint8_t *frame) = nullptr;
+
+    inline esp_err_t init() {
+        ESP_RETURN_ON_ERROR(Display::init(), TAG, "display init failed");
+
+        if constexpr (Frame::BPP == 8)
+            for (int i = 0; i < 256; i++)
+                rgb332[i] = FormatRGB565::from565(FormatRGB332::to565(i));
+
+        Frame::clear();
+        ESP_RETURN_ON_ERROR(Display::clearDisplay(), TAG, "clear display failed");
+
+        return ESP_OK;
+    }
+
+    // y0 is the first row in storage, band relative for banded frames
+    inline void convert_rows(const fb &y0, const fb &rows, uint16_t *out) const {
+        const size_t count = size_t(rows) * Display::WIDTH;
+
+        if constexpr (Frame::BPP == 16) {
+            memcpy(out, &this->buffer[y0 * Display::WIDTH], count * 2);
+        } else if constexpr (Frame::BPP == 8) {
+            const uint8_t *in = &this->buffer[y0 * Display::WIDTH];
+            for (size_t i = 0; i < count; i++)
+                out[i] = rgb332[in[i]];
+        } else {
+            const uint16_t off = mono_palette[0], on = mono_palette[1];
+            const uint8_t *in = &this->buffer[y0 * Display::WIDTH / 8];
+            for (size_t i = 0; i < count / 8; i++, out += 8) {
+                const uint8_t bits = in[i];
+                for (uint8_t b = 0; b < 8; b++)
+                    out[b] = (bits >> b) & 1 ? on : off;
+            }
+        }
+    }
+
+    /*
+        @brief Queues rows of storage after the window is set, up to two chunks stay on the bus
+
+        The frame is not read after this returns.
+    */
+    inline esp_err_t queue_rows(const fb &y0, const fb &rows) {
+        for (fb y = y0; y < y0 + rows; y += CHUNK_ROWS) {
+            const fb n = y0 + rows - y < CHUNK_ROWS ? y0 + rows - y : CHUNK_ROWS;
+
+            // The buffer about to be filled went out two chunks ago
+            ESP_RETURN_ON_ERROR(Display::wait_slot(), TAG, "wait_slot failed");
+
+            uint16_t *out = chunks[chunk];
+            chunk ^= 1;
+            convert_rows(y, n, out);
+            ESP_RETURN_ON_ERROR(Display::queue_data((const uint8_t*)out, size_t(n) * Display::WIDTH * 2), TAG, "queue_data failed");
+        }
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Sends rows y0 to y0 + rows - 1, returns with up to two chunks still on the bus
+    */
+    inline esp_err_t write_rows(const fb &y0, const fb &rows) {
+        ESP_RETURN_ON_ERROR(Display::setWindow(0, y0, Display::WIDTH - 1, y0 + rows - 1), TAG, "setWindow failed");
+
+        return queue_rows(y0, rows);
+    }
+
+    /*
+        @brief Moves a banded frame to the band, the first band opens the full window
+    */
+    inline esp_err_t begin_band(const fb &band) {
+        if (band == 0)
+            ESP_RETURN_ON_ERROR(Display::setWindow(0, 0, Display::WIDTH - 1, Display::HEIGHT - 1), TAG, "setWindow failed");
+
+        Frame::setBand(band);
+
+        return ESP_OK;
+    }
+
+    // The band's rows follow the previous band's in the window
+    inline esp_err_t end_band() {
+        return queue_rows(0, Frame::getBandRows());
+    }
+
+    inline bool flush_busy() {
+        return Display::busy();
+    }
+
+    inline esp_err_t flush_async() {
+        // Bands went out as they were drawn
+        if constexpr (BANDED)
+            return ESP_OK;
+
+        ESP_RETURN_ON_ERROR(write_rows(0, Display::HEIGHT), TAG, "write_rows failed");
+
+        if (on_flush)
+            on_flush((const uint8_t*)this->buffer);
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t flush() {
+        ESP_RETURN_ON_ERROR(flush_async(), TAG, "flush_async failed");
+        ESP_RETURN_ON_ERROR(Display::wait_all(), TAG, "wait_all failed");
+
+        return ESP_OK;
+    }
+};
+
+using SPI_SSD1351 = SPI_DC<GPIO_NUM_40, GPIO_NUM_41, GPIO_NUM_42, SPI_DISPLAY_FREQ, SPI_BUS_2>;
+using OLED128128RGB = SSD1351::Display<128, 128, SPI_SSD1351>;
+using SSD1351Frame = ClippedT<ColorFramebufferT<ColorbufferT<128, 128, FormatRGB565>>>;
+using SSD1351Buffer = SSD1351BufferT<OLED128128RGB, SSD1351Frame>;
+using SSD1351Band = ClippedT<BandT<ColorFramebufferT<ColorbufferT<128, DISPLAY_BAND_ROWS, FormatRGB565>>, 128>>;
+using SSD1351BandBuffer = SSD1351BufferT<OLED128128RGB, SSD1351Band>;
+
+}
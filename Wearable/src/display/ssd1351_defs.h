@@ -0,0 +1,87 @@
+#pragma once
+
+#include <inttypes.h>
+
+namespace wbl {
+namespace SSD1351 {
+
+enum : uint8_t {
+    SET_COLUMN                = 0x15,
+    SET_ROW                   = 0x75,
+    WRITE_RAM                 = 0x5C,
+    READ_RAM                  = 0x5D,
+    SET_REMAP                 = 0xA0,
+    SET_STARTLINE             = 0xA1,
+    SET_OFFSET                = 0xA2,
+    ALL_OFF                   = 0xA4,
+    ALL_ON                    = 0xA5,
+    NORMAL                    = 0xA6,
+    INVERT                    = 0xA7,
+    FUNCTION_SELECT           = 0xAB,
+    OFF                       = 0xAE,
+    ON                        = 0xAF,
+};
+
+enum : uint8_t {
+    SET_PHASE_LENGTH          = 0xB1,
+    SET_CLOCKDIV              = 0xB3,
+    SET_VSL                   = 0xB4,
+    SET_GPIO                  = 0xB5,
+    SET_PRECHARGE2            = 0xB6,
+    SET_PRECHARGE             = 0xBB,
+    SET_VCOMH                 = 0xBE,
+    SET_CONTRAST_ABC          = 0xC1,
+    SET_CONTRAST_MASTER       = 0xC7,
+    SET_MUX                   = 0xCA,
+    SET_LOCK                  = 0xFD,
+};
+
+// SET_REMAP bits
+enum : uint8_t {
+    REMAP_VERTICAL_INCREMENT  = 0x01,
+    REMAP_COLUMN              = 0x02,
+    REMAP_COLOR_SWAP          = 0x04,
+    REMAP_COM_SCAN            = 0x10,
+    REMAP_COM_SPLIT           = 0x20,
+    REMAP_65K                 = 0x40,
+};
+
+// Upright on the 1.5" module, 65k colours sent as big endian RGB565
+const uint8_t REMAP_DEFAULT = REMAP_65K | REMAP_COM_SPLIT | REMAP_COM_SCAN | REMAP_COLOR_SWAP;
+
+// Argument count of every command above, the init table and the model rely on it
+inline constexpr uint8_t arguments(const uint8_t &c) {
+    switch (c) {
+        case SET_COLUMN: case SET_ROW: return 2;
+        case SET_VSL: case SET_CONTRAST_ABC: return 3;
+        case SET_REMAP: case SET_STARTLINE: case SET_OFFSET: case FUNCTION_SELECT:
+        case SET_PHASE_LENGTH: case SET_CLOCKDIV: case SET_GPIO: case SET_PRECHARGE2:
+        case SET_PRECHARGE: case SET_VCOMH: case SET_CONTRAST_MASTER: case SET_MUX: case SET_LOCK:
+            return 1;
+    }
+    return 0;
+}
+
+const uint8_t initcmds[] = {
+    SET_LOCK, 0x12,
+    SET_LOCK, 0xB1,
+    OFF,
+    SET_CLOCKDIV, 0xF1,
+    SET_MUX, 0x7F,
+    SET_OFFSET, 0x00,
+    SET_STARTLINE, 0x00,
+    SET_REMAP, REMAP_DEFAULT,
+    SET_GPIO, 0x00,
+    FUNCTION_SELECT, 0x01,
+    SET_PHASE_LENGTH, 0x32,
+    SET_VCOMH, 0x05,
+    NORMAL,
+    SET_CONTRAST_ABC, 0xC8, 0x80, 0xC8,
+    SET_CONTRAST_MASTER, 0x0F,
+    SET_VSL, 0xA0, 0xB5, 0x55,
+    SET_PRECHARGE2, 0x01,
+    ON,
+};
+
+}
+}
@@ -1,10 +1,18 @@
 #pragma once
 
+#include "config.h"
 #include "framebuffer.h"
 #include "console.h"
+#include "shm_framebuffer.h"
+#include "wbl_func.h"
 
 #include <string.h>
 #include <inttypes.h>
+#include <stdio.h>
+#include <stdio_ext.h>
+#include <signal.h>
+#include <unistd.h>
+#include <algorithm>
 
 namespace wbl {
 
@@ -13,16 +21,84 @@ struct Display {
     inline int init();
 };
 
-struct ConsoleBuffer : public FramebufferT<StaticbufferT<128,128,1>>, public Display {
-    using Frame = FramebufferT<StaticbufferT<128,128,1>>;
+using ConsoleFrame = ClippedT<FramebufferT<StaticbufferT<128,128,1>>>;
+
+struct ConsoleBuffer : public ConsoleFrame, public Display {
+    using Frame = ConsoleFrame;
 
     static constexpr const char* blockMap = " \0▘\0▝\0▀\0▖\0▌\0▞\0▛\0▗\0▚\0▐\0▜\0▄\0▙\0▟\0█\0";
     static constexpr const char* blockMap2w = "  \0▀ \0 ▀\0▀▀\0▄ \0█ \0▄▀\0█▀\0 ▄\0▀▄\0 █\0▀█\0▄▄\0█▄\0▄█\0██\0";
     static constexpr const char *blockMapAscii = " \0`\0'\0^\0,\0[\0/\0<\0.\0\\\0]\0>\0_\0L\0J\0#\0";
     static constexpr const char *blockMapAscii2w = "  \0^ \0 ^\0^^\0v \0$ \0v^\0$^\0 v\0^v\0 $\0^$\0vv\0$v\0v$\0$$\0";
 
+    static constexpr const int max_cells_x = 128 / 2, max_cells_y = 128 / 2;
+
+    // Block glyph last written to each terminal cell
+    uint8_t cells[max_cells_x * max_cells_y];
+    int cells_width = 0, cells_height = 0;
+    const void *cells_map = nullptr;
+
+    // Set by invalidate(), which may run in a signal handler
+    volatile sig_atomic_t repaint = 1, clear_screen = 1;
+
+    // Escape sequences and glyphs for one frame, sent with a single write
+    char out[max_cells_x * max_cells_y * 16];
+    int out_length = 0;
+
+    // Frames stay in memory only, nothing is written to the terminal
+    bool headless = false;
+
+    // Every flushed frame is also published here once created
+    SharedFramebuffer shared;
+
+    // Runs after each flush with the raw frame, rows of 16 bytes
+    void (*on_flush)(const uint8_t *frame) = nullptr;
+
     inline int init() {return 0;}
 
+    /*
+        @brief Forces the next flush to redraw every cell
+
+        For when something else wrote to the terminal. With clear the screen
+        is erased first, e.g. after a resize reflowed it. Safe to call from
+        a signal handler.
+    */
+    inline void invalidate(const bool &clear = false) {
+        repaint = 1;
+        if (clear)
+            clear_screen = 1;
+    }
+
+    /*
+        @brief Writes out what was appended, a failed write repaints the next frame
+
+        cells already holds what the lost bytes would have drawn.
+    */
+    inline void out_flush() {
+        for (int written = 0; written < out_length;) {
+            const ssize_t n = ::write(STDOUT_FILENO, out + written, out_length - written);
+            if (n <= 0) {
+                invalidate();
+                break;
+            }
+            written += n;
+        }
+
+        out_length = 0;
+    }
+
+    // A full buffer is written out first, nothing appended is dropped
+    inline void out_append(const char *str, const int &length) {
+        if (out_length + length > int(sizeof(out)))
+            out_flush();
+        if (length > int(sizeof(out))) {
+            invalidate();
+            return;
+        }
+        memcpy(out + out_length, str, length);
+        out_length += length;
+    }
+
     inline fb blockToNum(const fb &x, const fb &y, const fb &xn, const fb &yn) {
         fb num = 0;
         const fb mask = (1 << this->BPP) - 1;
@@ -57,42 +133,82 @@ struct ConsoleBuffer : public FramebufferT<StaticbufferT<128,128,1>>, public Dis
 template<typename BLOCKSRC>
 void ConsoleBuffer::flushBlocks(const BLOCKSRC _blockMap, const int &w, const int &stride_x, const int &stride_y) {
     const int cwidth = console::getConsoleWidth(), cheight = console::getConsoleHeight();
-    const int clength = cwidth * cheight;
     const int mapLength = (1 << (stride_x * stride_y));
-    const int blength = clength * 4 * w;
     const char *blockMap = (const char*)_blockMap;
 
     int mapOffsets[mapLength][2];
     for (int i = 0, j = 0, k = 0, l = 0; i < mapLength; 
         l = strlen(blockMap + j), j += l + 1, mapOffsets[i][0] = k, mapOffsets[i][1] = l, k = j, i++);
 
-    char ch_buffer[blength];
-    int offset2 = 0, _offset = 0;
+    const int rows = std::min({(this->HEIGHT + stride_y - 1) / stride_y, cheight, max_cells_y});
+    const int cols = std::min({(this->WIDTH + stride_x - 1) / stride_x, (cwidth & -2) / w, max_cells_x});
+
+    // Text printed since the last frame is still buffered, it goes out first and may have scrolled the frame away
+    if (__fpending(stdout) || __fpending(stderr)) {
+        fflush(stdout);
+        fflush(stderr);
+        invalidate();
+    }
+
+    // Anything that changes the cell layout invalidates what the terminal shows
+    if (clear_screen || cwidth != cells_width || cheight != cells_height || _blockMap != cells_map) {
+        clear_screen = 0;
+        repaint = 1;
+        cells_width = cwidth;
+        cells_height = cheight;
+        cells_map = _blockMap;
+        out_append("\x1b[2J", 4);
+    }
+
+    if (repaint) {
+        repaint = 0;
+        memset(cells, 0xff, sizeof(cells));
+    }
+
+    char move[16];
+
+    for (int cy = 0; cy < rows; cy++) {
+        bool in_run = false;
 
-    memset(ch_buffer, ' ', blength);
+        for (int cx = 0; cx < cols; cx++) {
+            const uint8_t num = blockToNum(cx * stride_x, cy * stride_y, stride_x, stride_y);
+            uint8_t &cell = cells[cy * max_cells_x + cx];
 
-    for (int sy = 0, cy = 0; sy < this->HEIGHT && cy < cheight; sy+=stride_y, cy++) {
-        for (int sx = 0, cx = 0; sx < this->WIDTH && cx < (cwidth & -2); sx+=stride_x, cx+=w) {
-            const int num = blockToNum(sx, sy, stride_x, stride_y);
-            const char *ch = &blockMap[mapOffsets[num][0]];
-            const int l = mapOffsets[num][1];
-            const int offset = cy * cwidth + cx;
+            if (cell == num) {
+                in_run = false;
+                continue;
+            }
 
-            for (int i = 0; i < l; i++)
-                ch_buffer[i + offset + offset2] = ch[i];
+            cell = num;
 
-            offset2 += (l-w);
-            _offset = offset + offset2;
+            if (!in_run) {
+                const int n = snprintf(move, sizeof(move), "\x1b[%i;%iH", cy + 1, cx * w + 1);
+                if (n > 0 && n < int(sizeof(move)))
+                    out_append(move, n);
+                in_run = true;
+            }
+
+            out_append(&blockMap[mapOffsets[num][0]], mapOffsets[num][1]);
         }
     }
 
-    ch_buffer[_offset+w] = '\0';
-    console::clear();
-    console::write(0, 0, ch_buffer);
+    if (!out_length)
+        return;
+
+    // Leave the cursor under the frame, where other output goes
+    const int n = snprintf(move, sizeof(move), "\x1b[%i;1H", rows + 1);
+    if (n > 0 && n < int(sizeof(move)))
+        out_append(move, n);
+
+    out_flush();
 }
 
 int ConsoleBuffer::flush() {
-    flushBlocks(blockMap2w, 2);
+    shared.publish(this->buffer, micros());
+    if (!headless)
+        flushBlocks(blockMap2w, 2);
+    if (on_flush)
+        on_flush(this->buffer);
     return 0;
 }
 
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <inttypes.h>
+
+/*
+    @brief Emulator only, virtual time for headless runs
+
+    With the virtual clock enabled micros()/millis() report simulated time
+    and vTaskDelay() no longer sleeps. Once every task that has called
+    vTaskDelay() is waiting, the clock jumps straight to the earliest
+    deadline and wakes whoever is due.
+*/
+struct EmuClockStats {
+    uint64_t frames = 0;
+    int64_t render_us_total = 0, render_us_max = 0;
+    int64_t wall_us = 0;
+};
+
+void emu_clock_set_virtual(const bool &enabled);
+
+bool emu_clock_is_virtual();
+
+// Called once simulated time reaches limit_us
+void emu_clock_set_limit(const int64_t &limit_us, void (*on_limit)());
+
+// Delays of the calling thread mark frame boundaries, the time between them is render cost
+void emu_clock_set_frame_thread();
+
+// Runs on the frame thread at every frame boundary, before the next frame starts
+void emu_clock_on_frame(void (*callback)());
+
+EmuClockStats emu_clock_stats();
+
+// Ends every task started through xTaskCreate at its next blocking call and joins it
+void emu_tasks_stop();
@@ -1,6 +1,20 @@
 #include <chrono>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <algorithm>
+#include <string.h>
 
 #include "wbl_func.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "esp_timer.h"
+#include "emu_clock.h"
 
 using CLK = std::chrono::high_resolution_clock;
 using TP = CLK::time_point;
@@ -8,32 +22,512 @@ using DUR = CLK::duration;
 
 TP start = CLK::now();
 
-template<typename RATIO>
-int64_t get_duration() {
-    TP now = CLK::now();
+static int64_t wall_micros() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(CLK::now() - start).count();
+}
+
+struct VirtualClock {
+    struct Waiter {
+        int64_t target;
+        std::atomic<bool> woken;
+        // Tasks in a bounded wait sleep on their queue or semaphore, not on cv
+        std::condition_variable *wake = nullptr;
+    };
+
+    std::mutex lock;
+    std::condition_variable cv;
+    std::atomic<bool> enabled{false};
+    std::atomic<int64_t> now{0};
+    int participants = 0, sleeping = 0;
+    std::vector<Waiter*> waiters;
+
+    int64_t limit = INT64_MAX;
+    void (*on_limit)() = nullptr;
+    std::atomic<bool> limit_reached{false};
+
+    std::thread::id frame_thread;
+    int64_t frame_start = 0;
+    void (*on_frame)() = nullptr;
+    EmuClockStats stats;
+
+    // Only runs once every participant waits, nothing else can move time
+    void advance() {
+        if (!sleeping || sleeping < participants)
+            return;
+
+        int64_t next = INT64_MAX;
+        for (Waiter *w : waiters)
+            if (!w->woken && w->target < next)
+                next = w->target;
+
+        // Everyone is blocked on something other than time
+        if (next == INT64_MAX)
+            return;
+
+        if (next > now)
+            now = next;
+
+        for (Waiter *w : waiters) {
+            if (!w->woken && w->target <= now) {
+                w->woken = true;
+                sleeping--;
+                if (w->wake)
+                    w->wake->notify_all();
+            }
+        }
+
+        cv.notify_all();
+    }
+};
+
+static VirtualClock vclock;
+static thread_local bool clock_participant = false;
+
+struct EmuTask {
+    std::mutex lock;
+    std::condition_variable cv;
+    uint32_t notifications = 0;
+
+    // False for threads not started through xTaskCreate, which cannot be stopped
+    bool started = false;
+    std::thread thread;
+    // Set by vTaskDelete or emu_tasks_stop, the task ends at its next blocking call
+    std::atomic<bool> stopping{false}, finished{false};
+    // What the task sleeps on, so a stop can wake it
+    std::atomic<std::condition_variable*> blocked_on{nullptr};
+};
+
+// Unwinds a task's function back to where its thread started
+struct EmuTaskExit {};
+
+static struct {
+    std::mutex lock;
+    std::vector<EmuTask*> list;
+} tasks;
+
+static thread_local EmuTask *current_task = nullptr;
+static thread_local std::unique_ptr<EmuTask> adopted_task;
 
-    return std::chrono::duration_cast
-        <std::chrono::duration<int64_t, RATIO>>
-            (now - start)
-                .count();
+static EmuTask *get_current_task() {
+    // Threads not started through xTaskCreate, like main, get a handle on first use
+    if (!current_task) {
+        adopted_task.reset(new EmuTask());
+        current_task = adopted_task.get();
+    }
+    return current_task;
+}
+
+static bool stop_requested() {
+    return current_task && current_task->started && current_task->stopping;
+}
+
+static void check_stop() {
+    if (stop_requested())
+        throw EmuTaskExit();
+}
+
+// Joins and frees tasks whose function has returned, call with tasks.lock held
+static void reap_tasks() {
+    for (auto it = tasks.list.begin(); it != tasks.list.end();) {
+        EmuTask *task = *it;
+        if (task->finished) {
+            task->thread.join();
+            delete task;
+            it = tasks.list.erase(it);
+        } else
+            it++;
+    }
+}
+
+static bool join_virtual_clock() {
+    if (!vclock.enabled)
+        return false;
+
+    std::lock_guard<std::mutex> guard(vclock.lock);
+    vclock.participants++;
+    return true;
+}
+
+static void idle_enter() {
+    if (!clock_participant || !vclock.enabled)
+        return;
+
+    std::lock_guard<std::mutex> guard(vclock.lock);
+    vclock.sleeping++;
+    vclock.advance();
+}
+
+static void idle_exit() {
+    if (!clock_participant || !vclock.enabled)
+        return;
+
+    std::lock_guard<std::mutex> guard(vclock.lock);
+    vclock.sleeping--;
+}
+
+static void virtual_delay(const int64_t &us) {
+    if (!clock_participant)
+        clock_participant = join_virtual_clock();
+
+    std::unique_lock<std::mutex> guard(vclock.lock);
+
+    VirtualClock::Waiter waiter { vclock.now + us, false };
+    vclock.waiters.push_back(&waiter);
+    vclock.sleeping++;
+
+    vclock.advance();
+    vclock.cv.wait(guard, [&]() { return waiter.woken.load() || stop_requested(); });
+
+    if (!waiter.woken)
+        vclock.sleeping--;
+    vclock.waiters.erase(std::find(vclock.waiters.begin(), vclock.waiters.end(), &waiter));
+    if (stop_requested()) {
+        guard.unlock();
+        throw EmuTaskExit();
+    }
+
+    const bool reached = vclock.now >= vclock.limit && vclock.on_limit;
+    guard.unlock();
+
+    if (reached && !vclock.limit_reached.exchange(true))
+        vclock.on_limit();
+}
+
+static void leave_virtual_clock() {
+    std::lock_guard<std::mutex> guard(vclock.lock);
+
+    if (!clock_participant)
+        return;
+
+    clock_participant = false;
+    vclock.participants--;
+    vclock.advance();
+}
+
+void emu_clock_set_virtual(const bool &enabled) {
+    vclock.now = wall_micros();
+    vclock.enabled = enabled;
+}
+
+bool emu_clock_is_virtual() {
+    return vclock.enabled;
+}
+
+void emu_clock_set_limit(const int64_t &limit_us, void (*on_limit)()) {
+    std::lock_guard<std::mutex> guard(vclock.lock);
+    vclock.limit = limit_us;
+    vclock.on_limit = on_limit;
+}
+
+void emu_clock_set_frame_thread() {
+    if (!clock_participant)
+        clock_participant = join_virtual_clock();
+    vclock.frame_thread = std::this_thread::get_id();
+    vclock.frame_start = wall_micros();
+}
+
+void emu_clock_on_frame(void (*callback)()) {
+    vclock.on_frame = callback;
+}
+
+EmuClockStats emu_clock_stats() {
+    std::lock_guard<std::mutex> guard(vclock.lock);
+    EmuClockStats stats = vclock.stats;
+    stats.wall_us = wall_micros();
+    return stats;
 }
 
 int64_t micros() {
-    return get_duration<std::micro>();
+    return vclock.enabled ? vclock.now.load() : wall_micros();
 }
 
 int64_t millis() {
-    return get_duration<std::milli>();
+    return micros() / 1000;
 }
 
 int64_t seconds() {
-    return get_duration<std::ratio<1>>();    
+    return micros() / 1000000;
 }
 
 void vTaskDelay(TickType_t delay) {
-    usleep(delay * 1000);
+    check_stop();
+    const bool frame = std::this_thread::get_id() == vclock.frame_thread;
+
+    if (frame) {
+        const int64_t render = wall_micros() - vclock.frame_start;
+        std::lock_guard<std::mutex> guard(vclock.lock);
+        vclock.stats.frames++;
+        vclock.stats.render_us_total += render;
+        if (render > vclock.stats.render_us_max)
+            vclock.stats.render_us_max = render;
+    }
+
+    if (vclock.enabled)
+        virtual_delay(int64_t(delay) * portTICK_PERIOD_MS * 1000);
+    else
+        usleep(delay * 1000);
+    check_stop();
+
+    if (frame && vclock.on_frame)
+        vclock.on_frame();
+
+    if (frame)
+        vclock.frame_start = wall_micros();
 }
 
 void vPortYield() {
     sched_yield();
+}
+
+/*
+    Bounded waits on the virtual clock time out at a simulated deadline, the
+    clock wakes the task once it jumps there. The clock notifies cv without
+    holding the caller's lock, the short real wait covers a wakeup that
+    lands between checking and sleeping.
+*/
+template<typename Predicate>
+static bool wait_ticks_virtual(std::unique_lock<std::mutex> &guard, std::condition_variable &cv, const TickType_t &ticks, Predicate predicate) {
+    VirtualClock::Waiter waiter { 0, false, &cv };
+    {
+        std::lock_guard<std::mutex> clock(vclock.lock);
+        waiter.target = vclock.now + int64_t(ticks) * portTICK_PERIOD_MS * 1000;
+        vclock.waiters.push_back(&waiter);
+        vclock.sleeping++;
+        vclock.advance();
+    }
+
+    while (!predicate() && !waiter.woken && !stop_requested())
+        cv.wait_for(guard, std::chrono::milliseconds(1));
+
+    {
+        std::lock_guard<std::mutex> clock(vclock.lock);
+        if (!waiter.woken)
+            vclock.sleeping--;
+        vclock.waiters.erase(std::find(vclock.waiters.begin(), vclock.waiters.end(), &waiter));
+    }
+
+    return predicate();
+}
+
+template<typename Predicate>
+static bool wait_ticks(std::unique_lock<std::mutex> &guard, std::condition_variable &cv, const TickType_t &ticks, Predicate predicate) {
+    check_stop();
+    if (predicate())
+        return true;
+
+    EmuTask *task = get_current_task();
+    task->blocked_on = &cv;
+
+    bool ready = true;
+    if (ticks != portMAX_DELAY && clock_participant && vclock.enabled)
+        ready = wait_ticks_virtual(guard, cv, ticks, predicate);
+    else {
+        // Blocked tasks must not hold back the virtual clock
+        idle_enter();
+
+        auto woken = [&]() { return predicate() || stop_requested(); };
+        if (ticks == portMAX_DELAY)
+            cv.wait(guard, woken);
+        else
+            cv.wait_for(guard, std::chrono::milliseconds(ticks * portTICK_PERIOD_MS), woken);
+        ready = predicate();
+
+        idle_exit();
+    }
+
+    task->blocked_on = nullptr;
+    check_stop();
+
+    return ready;
+}
+
+BaseType_t xTaskCreatePinnedToCore(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle, BaseType_t core) {
+    std::lock_guard<std::mutex> guard(tasks.lock);
+    reap_tasks();
+
+    EmuTask *task = new EmuTask();
+    task->started = true;
+
+    // Joins the virtual clock before it can run, so time waits for its first delay
+    const bool participant = join_virtual_clock();
+
+    task->thread = std::thread([=]() {
+        current_task = task;
+        clock_participant = participant;
+        try {
+            function(arg);
+        } catch (const EmuTaskExit &) {
+        }
+        leave_virtual_clock();
+        task->finished = true;
+    });
+    tasks.list.push_back(task);
+
+    if (handle)
+        *handle = task;
+    return pdPASS;
+}
+
+BaseType_t xTaskCreate(TaskFunction_t function, const char *name, uint32_t stack_depth, void *arg, UBaseType_t priority, TaskHandle_t *handle) {
+    return xTaskCreatePinnedToCore(function, name, stack_depth, arg, priority, handle, tskNO_AFFINITY);
+}
+
+void vTaskDelete(TaskHandle_t handle) {
+    EmuTask *task = handle ? (EmuTask*)handle : get_current_task();
+    if (!task->started)
+        return;
+
+    task->stopping = true;
+    if (task == current_task)
+        throw EmuTaskExit();
+
+    // Another task ends once it next blocks, and is freed by a later xTaskCreate or emu_tasks_stop
+    if (std::condition_variable *cv = task->blocked_on)
+        cv->notify_all();
+    vclock.cv.notify_all();
+}
+
+void emu_tasks_stop() {
+    std::lock_guard<std::mutex> guard(tasks.lock);
+
+    for (EmuTask *task : tasks.list)
+        task->stopping = true;
+
+    // A stop lands between a task checking and sleeping, keep waking until it ends
+    const int64_t deadline = wall_micros() + 200000;
+    for (EmuTask *task : tasks.list) {
+        if (task == current_task)
+            continue;
+
+        while (!task->finished && wall_micros() < deadline) {
+            if (std::condition_variable *cv = task->blocked_on)
+                cv->notify_all();
+            vclock.cv.notify_all();
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // Tasks busy outside a blocking call, and the caller's own, are left to the process exit
+    reap_tasks();
+}
+
+TaskHandle_t xTaskGetCurrentTaskHandle() {
+    return get_current_task();
+}
+
+uint32_t ulTaskNotifyTake(BaseType_t clear_on_exit, TickType_t ticks) {
+    EmuTask *task = get_current_task();
+    std::unique_lock<std::mutex> guard(task->lock);
+
+    if (!wait_ticks(guard, task->cv, ticks, [&]() { return task->notifications > 0; }))
+        return 0;
+
+    const uint32_t value = task->notifications;
+    task->notifications = clear_on_exit ? 0 : value - 1;
+    return value;
+}
+
+BaseType_t xTaskNotifyGive(TaskHandle_t handle) {
+    EmuTask *task = (EmuTask*)handle;
+    {
+        std::lock_guard<std::mutex> guard(task->lock);
+        task->notifications++;
+    }
+    task->cv.notify_all();
+    return pdPASS;
+}
+
+struct EmuQueue {
+    std::mutex lock;
+    std::condition_variable cv;
+    std::deque<std::vector<uint8_t>> items;
+    UBaseType_t length, item_size;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size) {
+    return new EmuQueue { {}, {}, {}, length, item_size };
+}
+
+BaseType_t xQueueSend(QueueHandle_t handle, const void *item, TickType_t ticks) {
+    EmuQueue *queue = (EmuQueue*)handle;
+    std::unique_lock<std::mutex> guard(queue->lock);
+
+    if (!wait_ticks(guard, queue->cv, ticks, [&]() { return queue->items.size() < queue->length; }))
+        return pdFALSE;
+
+    const uint8_t *bytes = (const uint8_t*)item;
+    queue->items.emplace_back(bytes, bytes + queue->item_size);
+    guard.unlock();
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t handle, void *item, TickType_t ticks) {
+    EmuQueue *queue = (EmuQueue*)handle;
+    std::unique_lock<std::mutex> guard(queue->lock);
+
+    if (!wait_ticks(guard, queue->cv, ticks, [&]() { return !queue->items.empty(); }))
+        return pdFALSE;
+
+    memcpy(item, queue->items.front().data(), queue->item_size);
+    queue->items.pop_front();
+    guard.unlock();
+    queue->cv.notify_all();
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t handle) {
+    EmuQueue *queue = (EmuQueue*)handle;
+    std::lock_guard<std::mutex> guard(queue->lock);
+    return queue->items.size();
+}
+
+void vQueueDelete(QueueHandle_t handle) {
+    delete (EmuQueue*)handle;
+}
+
+struct EmuSemaphore {
+    std::mutex lock;
+    std::condition_variable cv;
+    UBaseType_t count, max_count;
+};
+
+SemaphoreHandle_t xSemaphoreCreateCounting(UBaseType_t max_count, UBaseType_t initial_count) {
+    return new EmuSemaphore { {}, {}, initial_count, max_count };
+}
+
+// No priority inheritance on the host, a binary semaphore is enough
+SemaphoreHandle_t xSemaphoreCreateMutex() {
+    return xSemaphoreCreateCounting(1, 1);
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t handle) {
+    EmuSemaphore *semaphore = (EmuSemaphore*)handle;
+    {
+        std::lock_guard<std::mutex> guard(semaphore->lock);
+        if (semaphore->count >= semaphore->max_count)
+            return pdFALSE;
+        semaphore->count++;
+    }
+    semaphore->cv.notify_one();
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t handle, TickType_t ticks) {
+    EmuSemaphore *semaphore = (EmuSemaphore*)handle;
+    std::unique_lock<std::mutex> guard(semaphore->lock);
+
+    if (!wait_ticks(guard, semaphore->cv, ticks, [&]() { return semaphore->count > 0; }))
+        return pdFALSE;
+
+    semaphore->count--;
+    return pdTRUE;
+}
+
+void vSemaphoreDelete(SemaphoreHandle_t handle) {
+    delete (EmuSemaphore*)handle;
+}
+
+int64_t esp_timer_get_time() {
+    return micros();
 }
\ No newline at end of file
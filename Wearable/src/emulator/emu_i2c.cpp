@@ -0,0 +1,140 @@
+#include <mutex>
+
+#include "driver/i2c_master.h"
+
+static const int max_devices = 8;
+
+struct EmuI2CBus {
+    i2c_port_num_t port;
+    std::mutex lock;
+    EmuI2CStats stats;
+    struct {
+        uint16_t address;
+        EmuI2CDevice *device;
+    } attached[max_devices];
+    int attached_count = 0;
+    bool in_use = false;
+};
+
+struct EmuI2CDev {
+    EmuI2CBus *bus;
+    uint16_t address;
+    uint32_t scl_speed_hz;
+};
+
+static EmuI2CBus buses[I2C_NUM_MAX];
+
+static EmuI2CDevice *find_device(EmuI2CBus *bus, const uint16_t &address) {
+    for (int i = 0; i < bus->attached_count; i++)
+        if (bus->attached[i].address == address)
+            return bus->attached[i].device;
+    return nullptr;
+}
+
+static void count(EmuI2CDev *dev, const size_t &bytes, const int &clocks) {
+    EmuI2CStats &stats = dev->bus->stats;
+    stats.transactions++;
+    stats.bytes += bytes;
+    stats.bus_us += clocks * 1e6 / dev->scl_speed_hz;
+}
+
+esp_err_t emu_i2c_attach(const i2c_port_num_t &port, const uint16_t &address, EmuI2CDevice *device) {
+    if (port < 0 || port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    EmuI2CBus &bus = buses[port];
+    std::lock_guard<std::mutex> guard(bus.lock);
+
+    if (bus.attached_count == max_devices)
+        return ESP_ERR_NO_MEM;
+
+    bus.attached[bus.attached_count++] = { address, device };
+    return ESP_OK;
+}
+
+EmuI2CStats emu_i2c_stats(const i2c_port_num_t &port) {
+    std::lock_guard<std::mutex> guard(buses[port].lock);
+    return buses[port].stats;
+}
+
+void emu_i2c_reset_stats(const i2c_port_num_t &port) {
+    std::lock_guard<std::mutex> guard(buses[port].lock);
+    buses[port].stats = EmuI2CStats();
+}
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config, i2c_master_bus_handle_t *bus) {
+    if (!config || !bus || config->i2c_port < 0 || config->i2c_port >= I2C_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    EmuI2CBus &b = buses[config->i2c_port];
+    if (b.in_use)
+        return ESP_ERR_INVALID_STATE;
+
+    b.port = config->i2c_port;
+    b.in_use = true;
+    *bus = &b;
+    return ESP_OK;
+}
+
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus) {
+    bus->in_use = false;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t address, int timeout_ms) {
+    std::lock_guard<std::mutex> guard(bus->lock);
+    return find_device(bus, address) ? ESP_OK : ESP_ERR_NOT_FOUND;
+}
+
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config, i2c_master_dev_handle_t *dev) {
+    if (!bus || !config || !dev || !config->scl_speed_hz)
+        return ESP_ERR_INVALID_ARG;
+
+    *dev = new EmuI2CDev { bus, config->device_address, config->scl_speed_hz };
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev) {
+    delete dev;
+    return ESP_OK;
+}
+
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size, int timeout_ms) {
+    std::lock_guard<std::mutex> guard(dev->bus->lock);
+
+    EmuI2CDevice *device = find_device(dev->bus, dev->address);
+    if (!device)
+        return ESP_ERR_TIMEOUT;
+
+    // Start, address byte, payload, stop
+    count(dev, write_size, 9 * (write_size + 1) + 2);
+    return device->on_transmit(write_buffer, write_size);
+}
+
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *read_buffer, size_t read_size, int timeout_ms) {
+    std::lock_guard<std::mutex> guard(dev->bus->lock);
+
+    EmuI2CDevice *device = find_device(dev->bus, dev->address);
+    if (!device)
+        return ESP_ERR_TIMEOUT;
+
+    count(dev, read_size, 9 * (read_size + 1) + 2);
+    return device->on_receive(read_buffer, read_size);
+}
+
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size, uint8_t *read_buffer, size_t read_size, int timeout_ms) {
+    std::lock_guard<std::mutex> guard(dev->bus->lock);
+
+    EmuI2CDevice *device = find_device(dev->bus, dev->address);
+    if (!device)
+        return ESP_ERR_TIMEOUT;
+
+    // Repeated start between the two halves
+    count(dev, write_size + read_size, 9 * (write_size + 1) + 9 * (read_size + 1) + 3);
+
+    const esp_err_t err = device->on_transmit(write_buffer, write_size);
+    if (err != ESP_OK)
+        return err;
+
+    return device->on_receive(read_buffer, read_size);
+}
@@ -0,0 +1,164 @@
+#include <mutex>
+#include <deque>
+
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+
+static const int max_devices = 4;
+static const int gpio_count = 49;
+
+struct EmuSPIBus {
+    std::mutex lock;
+    EmuSPIStats stats;
+    struct {
+        int cs;
+        EmuSPIDevice *device;
+    } attached[max_devices];
+    int attached_count = 0;
+    bool in_use = false;
+};
+
+struct EmuSPIDev {
+    EmuSPIBus *bus;
+    spi_device_interface_config_t config;
+    std::deque<spi_transaction_t*> done;
+};
+
+static EmuSPIBus buses[SPI_HOST_MAX];
+static uint8_t levels[gpio_count];
+
+esp_err_t gpio_config(const gpio_config_t *config) {
+    return config ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t gpio_set_level(gpio_num_t gpio_num, uint32_t level) {
+    if (gpio_num < 0 || gpio_num >= gpio_count)
+        return ESP_ERR_INVALID_ARG;
+    levels[gpio_num] = level != 0;
+    return ESP_OK;
+}
+
+int gpio_get_level(gpio_num_t gpio_num) {
+    return gpio_num >= 0 && gpio_num < gpio_count ? levels[gpio_num] : 0;
+}
+
+esp_err_t emu_spi_attach(const spi_host_device_t &host, const int &cs, EmuSPIDevice *device) {
+    if (host < 0 || host >= SPI_HOST_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    EmuSPIBus &bus = buses[host];
+    std::lock_guard<std::mutex> guard(bus.lock);
+
+    if (bus.attached_count == max_devices)
+        return ESP_ERR_NO_MEM;
+
+    bus.attached[bus.attached_count++] = { cs, device };
+    return ESP_OK;
+}
+
+EmuSPIStats emu_spi_stats(const spi_host_device_t &host) {
+    std::lock_guard<std::mutex> guard(buses[host].lock);
+    return buses[host].stats;
+}
+
+void emu_spi_reset_stats(const spi_host_device_t &host) {
+    std::lock_guard<std::mutex> guard(buses[host].lock);
+    buses[host].stats = EmuSPIStats();
+}
+
+esp_err_t spi_bus_initialize(spi_host_device_t host, const spi_bus_config_t *config, spi_dma_chan_t dma) {
+    if (host < 0 || host >= SPI_HOST_MAX || !config)
+        return ESP_ERR_INVALID_ARG;
+
+    EmuSPIBus &bus = buses[host];
+    if (bus.in_use)
+        return ESP_ERR_INVALID_STATE;
+
+    bus.in_use = true;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_free(spi_host_device_t host) {
+    buses[host].in_use = false;
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_add_device(spi_host_device_t host, const spi_device_interface_config_t *config, spi_device_handle_t *handle) {
+    if (host < 0 || host >= SPI_HOST_MAX || !config || !handle || config->clock_speed_hz <= 0)
+        return ESP_ERR_INVALID_ARG;
+    if (!buses[host].in_use)
+        return ESP_ERR_INVALID_STATE;
+
+    *handle = new EmuSPIDev { &buses[host], *config, {} };
+    return ESP_OK;
+}
+
+esp_err_t spi_bus_remove_device(spi_device_handle_t handle) {
+    delete handle;
+    return ESP_OK;
+}
+
+static esp_err_t transfer(spi_device_handle_t handle, spi_transaction_t *trans) {
+    EmuSPIBus &bus = *handle->bus;
+
+    if (handle->config.pre_cb)
+        handle->config.pre_cb(trans);
+
+    const size_t bytes = (trans->length + 7) / 8;
+
+    std::lock_guard<std::mutex> guard(bus.lock);
+    bus.stats.transactions++;
+    bus.stats.bytes += bytes;
+    bus.stats.bus_us += trans->length * 1e6 / handle->config.clock_speed_hz;
+
+    esp_err_t err = ESP_OK;
+    for (int i = 0; i < bus.attached_count; i++)
+        if (bus.attached[i].cs == handle->config.spics_io_num)
+            err = bus.attached[i].device->on_transfer((const uint8_t*)trans->tx_buffer, bytes);
+
+    if (handle->config.post_cb)
+        handle->config.post_cb(trans);
+
+    return err;
+}
+
+esp_err_t spi_device_queue_trans(spi_device_handle_t handle, spi_transaction_t *trans, TickType_t ticks_to_wait) {
+    if (!handle || !trans)
+        return ESP_ERR_INVALID_ARG;
+    if (int(handle->done.size()) >= handle->config.queue_size)
+        return ESP_ERR_TIMEOUT;
+
+    const esp_err_t err = transfer(handle, trans);
+    {
+        std::lock_guard<std::mutex> guard(handle->bus->lock);
+        handle->bus->stats.queued++;
+    }
+    handle->done.push_back(trans);
+    return err;
+}
+
+esp_err_t spi_device_get_trans_result(spi_device_handle_t handle, spi_transaction_t **trans, TickType_t ticks_to_wait) {
+    if (!handle || !trans)
+        return ESP_ERR_INVALID_ARG;
+    if (handle->done.empty())
+        return ESP_ERR_TIMEOUT;
+
+    *trans = handle->done.front();
+    handle->done.pop_front();
+    return ESP_OK;
+}
+
+esp_err_t spi_device_polling_transmit(spi_device_handle_t handle, spi_transaction_t *trans) {
+    if (!handle || !trans)
+        return ESP_ERR_INVALID_ARG;
+
+    // Like the driver, polling transfers can not start while queued ones are pending
+    if (!handle->done.empty())
+        return ESP_ERR_INVALID_STATE;
+
+    return transfer(handle, trans);
+}
+
+esp_err_t spi_device_transmit(spi_device_handle_t handle, spi_transaction_t *trans) {
+    return spi_device_polling_transmit(handle, trans);
+}
@@ -0,0 +1,380 @@
+#include <mutex>
+#include <vector>
+#include <string.h>
+#include <stdio.h>
+
+#include "emu_trace.h"
+#include "user_inputs.h"
+#include "wbl_func.h"
+#include "gps.h"
+
+static const uint8_t trace_version = 1;
+static const int max_sensors = 16;
+static const int max_channels = 8;
+
+enum RecordType : uint8_t {
+    RECORD_DPAD = 0,
+    RECORD_GPS = 1,
+    RECORD_SENSOR = 2,
+    RECORD_SENSOR_NAME = 3,
+};
+
+struct TraceEvent {
+    int64_t time;
+    RecordType type;
+    uint8_t button;
+    bool rising;
+    int64_t fix;
+};
+
+struct TraceSensor {
+    char name[32];
+    uint8_t channels;
+    int32_t last[max_channels];
+
+    // Replay only, recorded samples in order and the next one to hand out
+    std::vector<int32_t> values;
+    size_t cursor;
+};
+
+static struct {
+    std::mutex lock;
+    EmuTraceMode mode = EMU_TRACE_OFF;
+
+    FILE *file = nullptr;
+    int64_t last_time = 0;
+
+    TraceSensor sensors[max_sensors];
+    int sensor_count = 0;
+
+    // Replay times are relative to when the replay was loaded
+    int64_t start = 0;
+    std::vector<TraceEvent> events;
+    size_t next_event = 0;
+    int64_t gps_fix = -1;
+} trace;
+
+static void put_varint(std::vector<uint8_t> &out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back(uint8_t(v) | 0x80);
+        v >>= 7;
+    }
+    out.push_back(uint8_t(v));
+}
+
+static void put_zigzag(std::vector<uint8_t> &out, const int64_t &v) {
+    put_varint(out, (uint64_t(v) << 1) ^ uint64_t(v >> 63));
+}
+
+static bool get_varint(const uint8_t *&p, const uint8_t *end, uint64_t &v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        const uint8_t b = *p++;
+        v |= uint64_t(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return true;
+    }
+    return false;
+}
+
+static bool get_zigzag(const uint8_t *&p, const uint8_t *end, int64_t &v) {
+    uint64_t u;
+    if (!get_varint(p, end, u))
+        return false;
+    v = int64_t(u >> 1) ^ -int64_t(u & 1);
+    return true;
+}
+
+static int find_sensor(const char *name) {
+    for (int i = 0; i < trace.sensor_count; i++)
+        if (strncmp(trace.sensors[i].name, name, sizeof(TraceSensor::name) - 1) == 0)
+            return i;
+    return -1;
+}
+
+// Caller holds trace.lock, time deltas never go backwards across threads
+static void begin_record(std::vector<uint8_t> &out, const RecordType &type) {
+    int64_t now = micros();
+    if (now < trace.last_time)
+        now = trace.last_time;
+
+    out.push_back(type);
+    put_varint(out, now - trace.last_time);
+    trace.last_time = now;
+}
+
+static void write_record(const std::vector<uint8_t> &out) {
+    if (trace.file)
+        fwrite(out.data(), 1, out.size(), trace.file);
+}
+
+esp_err_t emu_trace_record(const char *path) {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    if (trace.mode != EMU_TRACE_OFF)
+        return ESP_ERR_INVALID_STATE;
+
+    trace.file = fopen(path, "wb");
+    if (!trace.file)
+        return ESP_FAIL;
+
+    fwrite("WBTR", 1, 4, trace.file);
+    fwrite(&trace_version, 1, 1, trace.file);
+
+    trace.last_time = micros();
+    trace.mode = EMU_TRACE_RECORD;
+    return ESP_OK;
+}
+
+static esp_err_t parse(const std::vector<uint8_t> &data) {
+    const uint8_t *p = data.data() + 5;
+    const uint8_t *end = data.data() + data.size();
+    int64_t time = 0;
+
+    // Sensor ids in the file map to slots by name, deltas decode per slot
+    int slot_of[max_sensors];
+    for (int i = 0; i < max_sensors; i++)
+        slot_of[i] = -1;
+
+    while (p < end) {
+        const RecordType type = RecordType(*p++);
+        uint64_t delta;
+        if (!get_varint(p, end, delta))
+            return ESP_ERR_INVALID_SIZE;
+        time += delta;
+
+        switch (type) {
+            case RECORD_DPAD: {
+                if (p == end)
+                    return ESP_ERR_INVALID_SIZE;
+                const uint8_t b = *p++;
+                if ((b >> 1) >= wbl::dpad.button_count)
+                    return ESP_ERR_INVALID_ARG;
+                trace.events.push_back({ time, type, uint8_t(b >> 1), bool(b & 1), 0 });
+                break;
+            }
+            case RECORD_GPS: {
+                int64_t fix;
+                if (!get_zigzag(p, end, fix))
+                    return ESP_ERR_INVALID_SIZE;
+                trace.events.push_back({ time, type, 0, false, fix });
+                break;
+            }
+            case RECORD_SENSOR_NAME: {
+                if (end - p < 3)
+                    return ESP_ERR_INVALID_SIZE;
+                const uint8_t id = *p++, channels = *p++, length = *p++;
+                if (id >= max_sensors || trace.sensor_count == max_sensors || channels > max_channels || length >= sizeof(TraceSensor::name) || end - p < length)
+                    return ESP_ERR_INVALID_ARG;
+
+                TraceSensor &s = trace.sensors[trace.sensor_count];
+                memcpy(s.name, p, length);
+                s.name[length] = 0;
+                s.channels = channels;
+                s.cursor = 0;
+                memset(s.last, 0, sizeof(s.last));
+                slot_of[id] = trace.sensor_count++;
+                p += length;
+                break;
+            }
+            case RECORD_SENSOR: {
+                if (p == end || *p >= max_sensors || slot_of[*p] < 0)
+                    return ESP_ERR_INVALID_ARG;
+                TraceSensor &s = trace.sensors[slot_of[*p++]];
+                for (int i = 0; i < s.channels; i++) {
+                    int64_t d;
+                    if (!get_zigzag(p, end, d))
+                        return ESP_ERR_INVALID_SIZE;
+                    s.last[i] += int32_t(d);
+                    s.values.push_back(s.last[i]);
+                }
+                break;
+            }
+            default:
+                return ESP_ERR_INVALID_ARG;
+        }
+    }
+
+    return ESP_OK;
+}
+
+esp_err_t emu_trace_replay(const char *path) {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    if (trace.mode != EMU_TRACE_OFF)
+        return ESP_ERR_INVALID_STATE;
+
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return ESP_ERR_NOT_FOUND;
+
+    std::vector<uint8_t> data;
+    uint8_t buf[4096];
+    size_t n;
+    while ((n = fread(buf, 1, sizeof(buf), f)) > 0)
+        data.insert(data.end(), buf, buf + n);
+    fclose(f);
+
+    if (data.size() < 5 || memcmp(data.data(), "WBTR", 4) != 0 || data[4] != trace_version)
+        return ESP_ERR_INVALID_VERSION;
+
+    const esp_err_t err = parse(data);
+    if (err != ESP_OK) {
+        for (int i = 0; i < trace.sensor_count; i++)
+            trace.sensors[i].values.clear();
+        trace.events.clear();
+        trace.sensor_count = 0;
+        return err;
+    }
+
+    trace.start = micros();
+    trace.mode = EMU_TRACE_REPLAY;
+    return ESP_OK;
+}
+
+EmuTraceMode emu_trace_mode() {
+    return trace.mode;
+}
+
+void emu_trace_close() {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    if (trace.file) {
+        fclose(trace.file);
+        trace.file = nullptr;
+    }
+
+    for (int i = 0; i < trace.sensor_count; i++)
+        trace.sensors[i].values.clear();
+    trace.sensor_count = 0;
+    trace.events.clear();
+    trace.next_event = 0;
+    trace.gps_fix = -1;
+    trace.mode = EMU_TRACE_OFF;
+}
+
+void emu_trace_dpad(const uint8_t &button, const bool &rising) {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    if (trace.mode != EMU_TRACE_RECORD)
+        return;
+
+    std::vector<uint8_t> out;
+    begin_record(out, RECORD_DPAD);
+    out.push_back((button << 1) | rising);
+    write_record(out);
+}
+
+void emu_trace_gps_fix(const int64_t &time) {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    if (trace.mode != EMU_TRACE_RECORD)
+        return;
+
+    std::vector<uint8_t> out;
+    begin_record(out, RECORD_GPS);
+    put_zigzag(out, time);
+    write_record(out);
+}
+
+int64_t emu_trace_gps() {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    const int64_t fix = trace.gps_fix;
+    trace.gps_fix = -1;
+    return fix;
+}
+
+esp_err_t emu_trace_sensor(const char *name, const uint8_t &channels, int32_t *values, esp_err_t result) {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    if (trace.mode == EMU_TRACE_OFF || channels > max_channels)
+        return result;
+
+    int id = find_sensor(name);
+
+    if (trace.mode == EMU_TRACE_REPLAY) {
+        // Sensors missing from the trace, or past its end, read live
+        if (id < 0 || trace.sensors[id].channels != channels)
+            return result;
+
+        TraceSensor &s = trace.sensors[id];
+        if (s.cursor + channels > s.values.size())
+            return result;
+
+        memcpy(values, &s.values[s.cursor], channels * sizeof(int32_t));
+        s.cursor += channels;
+        return ESP_OK;
+    }
+
+    // Failed reads replay as live reads, only good samples are recorded
+    if (result != ESP_OK)
+        return result;
+
+    std::vector<uint8_t> out;
+
+    if (id < 0) {
+        if (trace.sensor_count == max_sensors)
+            return result;
+
+        id = trace.sensor_count++;
+        TraceSensor &s = trace.sensors[id];
+        strncpy(s.name, name, sizeof(s.name) - 1);
+        s.name[sizeof(s.name) - 1] = 0;
+        s.channels = channels;
+        memset(s.last, 0, sizeof(s.last));
+
+        const uint8_t length = strlen(s.name);
+        begin_record(out, RECORD_SENSOR_NAME);
+        out.push_back(id);
+        out.push_back(channels);
+        out.push_back(length);
+        out.insert(out.end(), s.name, s.name + length);
+    }
+
+    TraceSensor &s = trace.sensors[id];
+    begin_record(out, RECORD_SENSOR);
+    out.push_back(id);
+    for (int i = 0; i < channels; i++) {
+        put_zigzag(out, int64_t(values[i]) - s.last[i]);
+        s.last[i] = values[i];
+    }
+    write_record(out);
+
+    return result;
+}
+
+void emu_trace_poll() {
+    std::lock_guard<std::mutex> guard(trace.lock);
+
+    if (trace.mode != EMU_TRACE_REPLAY)
+        return;
+
+    const int64_t now = micros() - trace.start;
+
+    for (; trace.next_event < trace.events.size() && trace.events[trace.next_event].time <= now; trace.next_event++) {
+        const TraceEvent &e = trace.events[trace.next_event];
+
+        if (e.type == RECORD_GPS) {
+            trace.gps_fix = e.fix;
+        } else if (e.rising) {
+            wbl::dpad.buttons[e.button].rising_edge();
+        } else {
+            wbl::dpad.buttons[e.button].falling_edge();
+        }
+    }
+}
+
+bool emu_trace_finished() {
+    std::lock_guard<std::mutex> guard(trace.lock);
+    return trace.mode == EMU_TRACE_REPLAY && trace.next_event == trace.events.size();
+}
+
+// The emulator has no receiver, fixes only come from a replayed trace
+esp_err_t wbl::init() {
+    return ESP_OK;
+}
+
+int64_t wbl::getGPSTime() {
+    return emu_trace_gps();
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <inttypes.h>
+
+#include "esp_system.h"
+
+/*
+    @brief Emulator only, records or replays everything nondeterministic
+
+    Dpad edges, GPS fixes and raw sensor reads go to a compact binary trace
+    while recording. On replay the keyboard is ignored, edges and fixes are
+    applied at frame boundaries once their recorded time has passed, and
+    each sensor read returns the next recorded values for that sensor.
+    Combined with the virtual clock a replay sees the same inputs at the
+    same frames on every run.
+
+    Trace layout, after the "WBTR" magic and a version byte, is a stream of
+    records: a type byte, the varint microseconds since the previous record
+    and a type specific payload. Sensor values are zigzag varint deltas
+    against that sensor's previous sample.
+*/
+enum EmuTraceMode : uint8_t {
+    EMU_TRACE_OFF = 0,
+    EMU_TRACE_RECORD = 1,
+    EMU_TRACE_REPLAY = 2,
+};
+
+esp_err_t emu_trace_record(const char *path);
+
+esp_err_t emu_trace_replay(const char *path);
+
+EmuTraceMode emu_trace_mode();
+
+// Ends a recording or replay, flushing the recorded file
+void emu_trace_close();
+
+// Input thread, one edge of wbl::dpad.buttons[button]
+void emu_trace_dpad(const uint8_t &button, const bool &rising);
+
+// Returns the pending GPS fix in microseconds since epoch, or -1
+int64_t emu_trace_gps();
+
+// Records a live fix, for GPS sources attached to the emulator
+void emu_trace_gps_fix(const int64_t &time);
+
+/*
+    @brief Sampler tap, records the read or replaces it with the recorded one
+*/
+esp_err_t emu_trace_sensor(const char *name, const uint8_t &channels, int32_t *values, esp_err_t result);
+
+// Frame thread, applies replayed events that are due
+void emu_trace_poll();
+
+// True once a replay has delivered every record
+bool emu_trace_finished();
@@ -0,0 +1,143 @@
+#include <mutex>
+#include <poll.h>
+#include <unistd.h>
+
+#include "driver/uart.h"
+#include "wbl_func.h"
+
+struct EmuUart {
+    std::mutex lock;
+    bool installed = false;
+    int fd = -1;
+    int baud = 115200;
+    size_t tx_size = 0;
+
+    // Bytes still in the modeled ring buffer as of drained_us
+    size_t queued = 0;
+    int64_t drained_us = 0;
+};
+
+static EmuUart uarts[UART_NUM_MAX];
+
+static bool valid(const uart_port_t &port) {
+    return port >= 0 && port < UART_NUM_MAX && uarts[port].installed;
+}
+
+static void drain(EmuUart &u) {
+    const int64_t now = micros();
+    const int64_t sent = (now - u.drained_us) * u.baud / 10 / 1000000;
+    if (sent <= 0)
+        return;
+
+    if (size_t(sent) >= u.queued) {
+        u.queued = 0;
+        u.drained_us = now;
+    } else {
+        u.queued -= sent;
+        u.drained_us += sent * 10 * 1000000 / u.baud;
+    }
+}
+
+esp_err_t emu_uart_attach(const uart_port_t &port, const int &fd) {
+    if (port < 0 || port >= UART_NUM_MAX)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(uarts[port].lock);
+    uarts[port].fd = fd;
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_install(uart_port_t port, int rx_buffer_size, int tx_buffer_size, int queue_size, void *uart_queue, int intr_alloc_flags) {
+    if (port < 0 || port >= UART_NUM_MAX || tx_buffer_size < 0)
+        return ESP_ERR_INVALID_ARG;
+
+    EmuUart &u = uarts[port];
+    std::lock_guard<std::mutex> guard(u.lock);
+    if (u.installed)
+        return ESP_ERR_INVALID_STATE;
+
+    u.installed = true;
+    u.tx_size = tx_buffer_size;
+    u.queued = 0;
+    u.drained_us = micros();
+    return ESP_OK;
+}
+
+esp_err_t uart_driver_delete(uart_port_t port) {
+    if (!valid(port))
+        return ESP_ERR_INVALID_STATE;
+
+    std::lock_guard<std::mutex> guard(uarts[port].lock);
+    uarts[port].installed = false;
+    return ESP_OK;
+}
+
+esp_err_t uart_param_config(uart_port_t port, const uart_config_t *config) {
+    if (!valid(port) || !config || config->baud_rate <= 0)
+        return ESP_ERR_INVALID_ARG;
+
+    std::lock_guard<std::mutex> guard(uarts[port].lock);
+    uarts[port].baud = config->baud_rate;
+    return ESP_OK;
+}
+
+esp_err_t uart_set_pin(uart_port_t port, int tx_io_num, int rx_io_num, int rts_io_num, int cts_io_num) {
+    return valid(port) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+esp_err_t uart_get_tx_buffer_free_size(uart_port_t port, size_t *size) {
+    if (!valid(port) || !size)
+        return ESP_ERR_INVALID_ARG;
+
+    EmuUart &u = uarts[port];
+    std::lock_guard<std::mutex> guard(u.lock);
+    drain(u);
+    *size = u.queued < u.tx_size ? u.tx_size - u.queued : 0;
+    return ESP_OK;
+}
+
+int uart_write_bytes(uart_port_t port, const void *src, size_t size) {
+    if (!valid(port) || !src)
+        return -1;
+
+    EmuUart &u = uarts[port];
+
+    // Like the driver, waits for room in the ring buffer
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> guard(u.lock);
+            drain(u);
+            if (u.queued + size <= u.tx_size || !u.queued)
+                break;
+        }
+        vTaskDelay(1);
+    }
+
+    std::lock_guard<std::mutex> guard(u.lock);
+    u.queued += size;
+
+    for (size_t written = 0; u.fd >= 0 && written < size;) {
+        const ssize_t n = ::write(u.fd, (const uint8_t*)src + written, size - written);
+        if (n <= 0)
+            break;
+        written += n;
+    }
+
+    return size;
+}
+
+int uart_read_bytes(uart_port_t port, void *buf, uint32_t length, TickType_t ticks_to_wait) {
+    if (!valid(port) || !buf)
+        return -1;
+
+    const int fd = uarts[port].fd;
+    if (fd < 0)
+        return 0;
+
+    pollfd p = { fd, POLLIN, 0 };
+    if (poll(&p, 1, ticks_to_wait == portMAX_DELAY ? -1 : int(ticks_to_wait * portTICK_PERIOD_MS)) <= 0)
+        return 0;
+
+    const ssize_t n = ::read(fd, buf, length);
+    return n < 0 ? -1 : int(n);
+}
@@ -1,20 +1,180 @@
 #include <thread>
 #include <signal.h>
 #include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
 #include "console.h"
 #include "user_inputs.h"
+#include "sprites.h"
+#include "ui.h"
+#include "wbl_func.h"
+#include "emu_clock.h"
+#include "emu_trace.h"
+#include "sampler.h"
+#include "sdcard.h"
+#include "uart.h"
+#include "screen_mirror.h"
 
 extern "C" void app_main();
+extern wbl::Sampler sampler;
+extern wbl::SDCard sdcard;
 
-void handle_signal(int signal) {
+wbl::MirrorUart mirroruart;
+wbl::ScreenMirrorT<wbl::MirrorUart, 128, 16> mirror(mirroruart, wbl::MIRROR_LAYOUT_ROWS, SCREEN_MIRROR_INTERVAL_MS * 1000, SCREEN_MIRROR_KEYFRAME_INTERVAL);
+
+void mirror_frame(const uint8_t *frame) {
+    mirror.update(frame);
+}
+
+esp_err_t mirror_open(const char *path) {
+    const int fd = open(path, O_RDWR | O_NOCTTY);
+    if (fd < 0)
+        return ESP_ERR_NOT_FOUND;
+
+    // A terminal would otherwise translate newlines inside the binary stream
+    termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    ESP_RETURN_ON_ERROR(emu_uart_attach(wbl::MirrorUart::PORT, fd), "emulator", "emu_uart_attach failed");
+    ESP_RETURN_ON_ERROR(mirroruart.init(), "emulator", "mirror uart init failed");
+
+    wbl::Sprites::display.on_flush = mirror_frame;
+    mirror.start();
+    return ESP_OK;
+}
+
+esp_err_t trace_sensor(const wbl::ISensor &sensor, int32_t *values, esp_err_t result) {
+    return emu_trace_sensor(sensor.name, sensor.channels, values, result);
+}
+
+// Set by SIGINT and SIGQUIT, the frame thread quits after its next frame
+volatile sig_atomic_t quit_requested = 0;
+bool tracing = false;
+
+/*
+    Tasks are stopped and joined first. One that never blocks, or the task
+    that reached the headless limit, may still be running, exit() would
+    destroy what it uses and hang. Flush what was written and leave
+    without running destructors.
+*/
+void quit() {
+    emu_tasks_stop();
+    emu_trace_close();
     console::cons.~constructor();
     //wbl::dpad.~Dpad();
-    exit(0);
+    fflush(stdout);
+    fflush(stderr);
+    _exit(0);
+}
+
+// Nothing but the flag is safe in a handler, a second signal while the first waits for a frame leaves at once
+void handle_signal(int signal) {
+    if (quit_requested)
+        _exit(1);
+    quit_requested = 1;
 }
 
-int main() {
+// Runs on the frame thread after each frame's delay
+void on_frame() {
+    if (quit_requested)
+        quit();
+    if (tracing)
+        emu_trace_poll();
+}
+
+// The terminal reflowed, the next frame clears it and draws every cell
+void handle_resize(int signal) {
+    wbl::Sprites::display.invalidate(true);
+}
+
+void headless_report() {
+    const EmuClockStats stats = emu_clock_stats();
+    const float simulated = micros() * 1e-6f, wall = stats.wall_us * 1e-6f;
+
+    printf("simulated %.0fs in %.2fs (%.0fx)\n", simulated, wall, wall > 0 ? simulated / wall : 0.0f);
+    printf("frames %llu, render avg %.1fus max %lldus\n",
+        (unsigned long long)stats.frames, stats.frames ? float(stats.render_us_total) / stats.frames : 0.0f, (long long)stats.render_us_max);
+    if (emu_trace_mode() == EMU_TRACE_REPLAY)
+        printf("replay %s\n", emu_trace_finished() ? "finished" : "still running");
+    sampler.print_stats();
+
+    quit();
+}
+
+/*
+    --headless [seconds] runs on the virtual clock without terminal output,
+    stopping after the given simulated time (default one hour)
+    --record <file> writes inputs, GPS fixes and sensor reads to a trace
+    --replay <file> plays a trace back instead of reading the keyboard
+    --shm [file] publishes every frame to a shared memory file for viewers
+    --mirror <device> streams frame deltas to a serial device or pseudo-terminal
+    --sdcard <file> backs the SD card with an image file, created if missing
+*/
+int main(int argc, char **argv) {
     signal(SIGINT, handle_signal);
     signal(SIGQUIT, handle_signal);
+    signal(SIGWINCH, handle_resize);
+
+    const char *record = nullptr, *replay = nullptr;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--headless") == 0) {
+            const int64_t duration = (i + 1 < argc && argv[i + 1][0] != '-') ? atoll(argv[++i]) : 3600;
+            wbl::Sprites::display.headless = true;
+            #ifdef USE_EVENT_DBG
+            wbl::UI::event_log = false;
+            #endif
+            emu_clock_set_virtual(true);
+            emu_clock_set_limit(micros() + duration * 1000000, headless_report);
+        } else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) {
+            record = argv[++i];
+        } else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc) {
+            replay = argv[++i];
+        } else if (strcmp(argv[i], "--shm") == 0) {
+            const char *path = (i + 1 < argc && argv[i + 1][0] != '-') ? argv[++i] : wbl::SharedFramebuffer::DEFAULT_PATH;
+            wbl::DisplayBuffer &buffer = wbl::Sprites::display;
+            if (buffer.shared.create(path, buffer.WIDTH, buffer.HEIGHT, buffer.BPP) != ESP_OK) {
+                fprintf(stderr, "Failed to create %s\n", path);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--sdcard") == 0 && i + 1 < argc) {
+            sdcard.path = argv[++i];
+            sdcard.block_count = SDLOG_FIRST_BLOCK + SDLOG_BLOCK_COUNT;
+        } else if (strcmp(argv[i], "--mirror") == 0 && i + 1 < argc) {
+            if (mirror_open(argv[++i]) != ESP_OK) {
+                fprintf(stderr, "Failed to open %s\n", argv[i]);
+                return 1;
+            }
+        }
+    }
+
+    // After the clock is chosen, replay times count from here
+    if (record && emu_trace_record(record) != ESP_OK) {
+        fprintf(stderr, "Failed to open trace %s\n", record);
+        return 1;
+    }
+    if (replay && emu_trace_replay(replay) != ESP_OK) {
+        fprintf(stderr, "Failed to load trace %s\n", replay);
+        return 1;
+    }
+    if (record || replay) {
+        sampler.tap = trace_sensor;
+        tracing = true;
+    }
+
+    // Text is held until the next frame, which sees it pending and redraws around it
+    if (!wbl::Sprites::display.headless) {
+        setvbuf(stdout, nullptr, _IOFBF, BUFSIZ);
+        setvbuf(stderr, nullptr, _IOFBF, BUFSIZ);
+    }
+
+    emu_clock_set_frame_thread();
+    emu_clock_on_frame(on_frame);
     app_main();
     return 0;
-}
\ No newline at end of file
+}
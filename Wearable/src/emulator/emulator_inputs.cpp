@@ -1,5 +1,6 @@
 #include "user_inputs.h"
 #include "console.h"
+#include "emu_trace.h"
 
 #include <thread>
 #include <mutex>
@@ -39,10 +40,14 @@ void input_loop() {
             default: continue;
         }
 
-        if (!action)
+        // Replays drive the dpad on their own, only quitting still works
+        if (!action || emu_trace_mode() == EMU_TRACE_REPLAY)
             continue;
 
+        const uint8_t button = action - wbl::dpad.buttons;
+        emu_trace_dpad(button, true);
         action->rising_edge();
+        emu_trace_dpad(button, false);
         action->falling_edge();
     }
     }
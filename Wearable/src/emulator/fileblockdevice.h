@@ -0,0 +1,69 @@
+#pragma once
+
+#include "esp_system.h"
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <inttypes.h>
+
+namespace wbl {
+
+/*
+    @brief Block device backed by an image file, stands in for the SD card
+
+    Without a path init() fails like a missing card.
+*/
+struct FileBlockDevice {
+    static constexpr const uint32_t BLOCK_SIZE = 512;
+
+    const char *path;
+    uint32_t block_count;
+    bool sync_writes = false;
+    int fd = -1;
+
+    FileBlockDevice(const char *path = nullptr, const uint32_t &block_count = 8192)
+        :path(path),block_count(block_count) { }
+
+    ~FileBlockDevice() {
+        if (fd >= 0)
+            close(fd);
+    }
+
+    inline esp_err_t init() {
+        if (fd >= 0)
+            return ESP_OK;
+        if (!path)
+            return ESP_ERR_NOT_FOUND;
+
+        fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0)
+            return ESP_FAIL;
+
+        if (lseek(fd, 0, SEEK_END) < off_t(block_count) * BLOCK_SIZE && ftruncate(fd, off_t(block_count) * BLOCK_SIZE))
+            return ESP_FAIL;
+
+        return ESP_OK;
+    }
+
+    inline uint32_t get_block_count() const { return block_count; }
+
+    inline esp_err_t read_blocks(const uint32_t &block, void *dst, const uint32_t &count) {
+        if (block + count > block_count)
+            return ESP_ERR_INVALID_SIZE;
+        const ssize_t length = count * BLOCK_SIZE;
+        return pread(fd, dst, length, off_t(block) * BLOCK_SIZE) == length ? ESP_OK : ESP_FAIL;
+    }
+
+    inline esp_err_t write_blocks(const uint32_t &block, const void *src, const uint32_t &count) {
+        if (block + count > block_count)
+            return ESP_ERR_INVALID_SIZE;
+        const ssize_t length = count * BLOCK_SIZE;
+        if (pwrite(fd, src, length, off_t(block) * BLOCK_SIZE) != length)
+            return ESP_FAIL;
+        if (sync_writes && fdatasync(fd))
+            return ESP_FAIL;
+        return ESP_OK;
+    }
+};
+
+}
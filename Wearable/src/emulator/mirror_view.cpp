@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <termios.h>
+#include <time.h>
+
+#include "screen_mirror.h"
+
+/*
+    Host side of the screen mirror, decodes the stream from a serial device
+
+    MirrorView <device> [frame.pbm]
+
+    Prints frame and link statistics and, if given, rewrites the PBM after
+    every completed frame.
+*/
+
+using namespace wbl;
+
+static ScreenMirrorDecoderT<2048> decoder;
+
+static double now() {
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static void write_pbm(const char *path) {
+    char temp[4096];
+    snprintf(temp, sizeof(temp), "%s.tmp", path);
+
+    FILE *f = fopen(temp, "wb");
+    if (!f)
+        return;
+
+    const int w = decoder.width(), h = decoder.height();
+    fprintf(f, "P4\n%i %i\n", w, h);
+    for (int y = 0; y < h; y++) {
+        for (int x = 0; x < w; x += 8) {
+            uint8_t byte = 0;
+            for (int b = 0; b < 8 && x + b < w; b++)
+                byte |= decoder.getPixel(x + b, y) << (7 - b);
+            fputc(byte, f);
+        }
+    }
+
+    fclose(f);
+    rename(temp, path);
+}
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <device> [frame.pbm]\n", argv[0]);
+        return 1;
+    }
+
+    const int fd = open(argv[1], O_RDONLY | O_NOCTTY);
+    if (fd < 0) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    termios tio;
+    if (isatty(fd) && tcgetattr(fd, &tio) == 0) {
+        cfmakeraw(&tio);
+        cfsetispeed(&tio, B921600);
+        tcsetattr(fd, TCSANOW, &tio);
+    }
+
+    uint8_t data[512];
+    uint64_t bytes = 0;
+    double window = now();
+
+    for (;;) {
+        const ssize_t n = read(fd, data, sizeof(data));
+        if (n <= 0)
+            break;
+        bytes += n;
+
+        if (!decoder.feed(data, n))
+            continue;
+
+        if (argc > 2)
+            write_pbm(argv[2]);
+
+        const double t = now();
+        const MirrorInfo &info = decoder.info;
+        printf("\rframe %u seq %u %s skipped %u encode %uus | %.1f kB/s lost %u errors %u   ",
+            info.frame, info.sequence, info.flags & MIRROR_KEYFRAME ? "key  " : "delta", info.skipped, info.encode_us,
+            bytes / 1024.0 / (t - window > 0.001 ? t - window : 0.001), decoder.lost, decoder.errors);
+        fflush(stdout);
+
+        if (t - window > 2.0) {
+            window = t;
+            bytes = 0;
+        }
+    }
+
+    printf("\n");
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,151 @@
+#pragma once
+
+#include "driver/i2c_master.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+/*
+    @brief Emulated SH1107 controller, decodes the I2C command/data stream into GRAM
+
+    Each transfer starts with a control byte. Co=0 makes the rest of the
+    transfer a single command or data stream, Co=1 (0x80/0xC0) covers one
+    byte and is followed by another control byte. D/C selects data over
+    commands.
+*/
+struct SH1107Model : public EmuI2CDevice {
+    static constexpr const int WIDTH = 128;
+    static constexpr const int HEIGHT = 128;
+    static constexpr const int PAGES = HEIGHT / 8;
+
+    enum AddressMode : uint8_t {
+        PAGE_ADDRESSING = 0,
+        VERTICAL_ADDRESSING = 1,
+    };
+
+    uint8_t gram[PAGES][WIDTH];
+
+    uint8_t page = 0, column = 0;
+    AddressMode address_mode = PAGE_ADDRESSING;
+
+    uint8_t contrast = 0x80;
+    uint8_t start_line = 0, offset = 0, mux = 0x7f;
+    uint8_t clock_div = 0x50, precharge = 0x22, vcom = 0x35, dcdc = 0x81;
+    bool remap = false, scan_reverse = false;
+    bool inverted = false, all_on = false, on = false;
+
+    uint32_t commands = 0, data_bytes = 0, unknown_commands = 0;
+
+    // Command byte waiting for its argument
+    uint8_t pending = 0;
+
+    SH1107Model() {
+        memset(gram, 0, sizeof(gram));
+    }
+
+    static constexpr inline bool has_argument(const uint8_t &c) {
+        switch (c) {
+            case 0x81: case 0xA8: case 0xAD: case 0xD3: case 0xD5:
+            case 0xD9: case 0xDA: case 0xDB: case 0xDC:
+                return true;
+        }
+        return false;
+    }
+
+    inline void argument(const uint8_t &c, const uint8_t &v) {
+        switch (c) {
+            case 0x81: contrast = v; break;
+            case 0xA8: mux = v; break;
+            case 0xAD: dcdc = v; break;
+            case 0xD3: offset = v; break;
+            case 0xD5: clock_div = v; break;
+            case 0xD9: precharge = v; break;
+            case 0xDB: vcom = v; break;
+            case 0xDC: start_line = v & 0x7f; break;
+        }
+    }
+
+    inline void command(const uint8_t &c) {
+        commands++;
+
+        if (pending) {
+            argument(pending, c);
+            pending = 0;
+            return;
+        }
+
+        if (has_argument(c)) {
+            pending = c;
+            return;
+        }
+
+        if (c <= 0x0F)
+            column = (column & 0x70) | c;
+        else if (c <= 0x17)
+            column = ((c & 0x07) << 4) | (column & 0x0F);
+        else if (c == 0x20 || c == 0x21)
+            address_mode = AddressMode(c & 1);
+        else if (c == 0xA0 || c == 0xA1)
+            remap = c & 1;
+        else if (c == 0xA4 || c == 0xA5)
+            all_on = c & 1;
+        else if (c == 0xA6 || c == 0xA7)
+            inverted = c & 1;
+        else if (c == 0xAE || c == 0xAF)
+            on = c & 1;
+        else if (c >= 0xB0 && c <= 0xBF)
+            page = c & 0x0F;
+        else if (c >= 0xC0 && c <= 0xCF)
+            scan_reverse = c & 0x08;
+        else if (c != 0xE3)
+            unknown_commands++;
+    }
+
+    inline void data(const uint8_t &d) {
+        data_bytes++;
+        gram[page][column] = d;
+
+        if (address_mode == PAGE_ADDRESSING)
+            column = (column + 1) % WIDTH;
+        else
+            page = (page + 1) % PAGES;
+    }
+
+    esp_err_t on_transmit(const uint8_t *bytes, const size_t &size) override {
+        size_t i = 0;
+
+        while (i < size) {
+            const uint8_t control = bytes[i++];
+            const bool continuation = control & 0x80;
+            const bool is_data = control & 0x40;
+
+            if (control & 0x3f)
+                return ESP_FAIL;
+
+            const size_t end = continuation ? (i + 1 < size ? i + 1 : size) : size;
+            for (; i < end; i++) {
+                if (is_data)
+                    data(bytes[i]);
+                else
+                    command(bytes[i]);
+            }
+        }
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Visible pixel after remap, scan direction, start line and inversion
+    */
+    inline bool pixel(const int &x, const int &y) const {
+        if (!on)
+            return false;
+        if (all_on)
+            return true;
+
+        const int col = remap ? WIDTH - 1 - x : x;
+        const int row = ((scan_reverse ? HEIGHT - 1 - y : y) + start_line + offset) % HEIGHT;
+
+        return bool((gram[row / 8][col] >> (row & 7)) & 1) != inverted;
+    }
+};
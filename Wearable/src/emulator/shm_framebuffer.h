@@ -0,0 +1,186 @@
+#pragma once
+
+#include "esp_system.h"
+
+#include <atomic>
+#include <new>
+#include <inttypes.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+namespace wbl {
+
+/*
+    @brief Emulator only, frames published into a memory-mapped file
+
+    The file starts with SharedFrameHeader, followed by the framebuffer
+    exactly as the emulator holds it: rows top to bottom, 8 / bpp pixels per
+    byte with the leftmost pixel in the lowest bits.
+
+    The header's sequence is a seqlock. It is odd while a frame is being
+    written. Readers copy the pixels and retry whenever the sequence was odd
+    or changed underneath them. The writer never waits for readers.
+*/
+struct SharedFrameHeader {
+    static constexpr const uint32_t MAGIC = 0x42464257; // "WBFB"
+    static constexpr const uint16_t VERSION = 1;
+
+    uint32_t magic;
+    uint16_t version;
+    uint16_t header_size;
+    uint16_t width, height;
+    uint16_t bpp;
+    uint16_t stride;
+    uint32_t size;
+    std::atomic<uint32_t> sequence;
+    uint64_t frame;
+    int64_t time_us;
+};
+
+static_assert(std::atomic<uint32_t>::is_always_lock_free, "The seqlock is shared across processes");
+
+struct SharedFramebuffer {
+    static constexpr const char *DEFAULT_PATH = "/dev/shm/wearable_fb";
+
+    SharedFrameHeader *header = nullptr;
+    uint8_t *pixels = nullptr;
+    size_t mapped = 0;
+
+    inline bool is_open() const { return header; }
+
+    /*
+        @brief Creates or replaces the file at path, sized for one frame
+    */
+    inline esp_err_t create(const char *path, const uint16_t &width, const uint16_t &height, const uint16_t &bpp) {
+        if (header)
+            return ESP_ERR_INVALID_STATE;
+
+        const uint32_t size = uint32_t(width) * height * bpp / 8;
+        const size_t length = sizeof(SharedFrameHeader) + size;
+
+        const int fd = ::open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            return ESP_ERR_NOT_FOUND;
+
+        void *map = ftruncate(fd, length) == 0 ? mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+
+        if (map == MAP_FAILED)
+            return ESP_ERR_NO_MEM;
+
+        header = new (map) SharedFrameHeader();
+        pixels = (uint8_t*)map + sizeof(SharedFrameHeader);
+        mapped = length;
+
+        header->header_size = sizeof(SharedFrameHeader);
+        header->width = width;
+        header->height = height;
+        header->bpp = bpp;
+        header->stride = width * bpp / 8;
+        header->size = size;
+        header->version = SharedFrameHeader::VERSION;
+
+        // Readers check the magic last
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = SharedFrameHeader::MAGIC;
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Maps an existing file read-only, for viewers and test harnesses
+    */
+    inline esp_err_t attach(const char *path) {
+        if (header)
+            return ESP_ERR_INVALID_STATE;
+
+        const int fd = ::open(path, O_RDONLY);
+        if (fd < 0)
+            return ESP_ERR_NOT_FOUND;
+
+        const off_t length = lseek(fd, 0, SEEK_END);
+        void *map = length >= off_t(sizeof(SharedFrameHeader)) ? mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+        ::close(fd);
+
+        if (map == MAP_FAILED)
+            return ESP_ERR_INVALID_SIZE;
+
+        SharedFrameHeader *h = (SharedFrameHeader*)map;
+        if (h->magic != SharedFrameHeader::MAGIC || h->version != SharedFrameHeader::VERSION || h->header_size + size_t(h->size) > size_t(length)) {
+            munmap(map, length);
+            return ESP_ERR_INVALID_VERSION;
+        }
+
+        header = h;
+        pixels = (uint8_t*)map + h->header_size;
+        mapped = length;
+
+        return ESP_OK;
+    }
+
+    inline void close() {
+        if (header)
+            munmap(header, mapped);
+        header = nullptr;
+        pixels = nullptr;
+        mapped = 0;
+    }
+
+    /*
+        @brief Writer side, never blocks
+    */
+    inline void publish(const uint8_t *frame, const int64_t &time_us) {
+        if (!header)
+            return;
+
+        const uint32_t sequence = header->sequence.load(std::memory_order_relaxed);
+
+        header->sequence.store(sequence + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        memcpy(pixels, frame, header->size);
+        header->frame++;
+        header->time_us = time_us;
+
+        header->sequence.store(sequence + 2, std::memory_order_release);
+    }
+
+    /*
+        @brief Reader side, copies the latest complete frame into dest
+
+        Returns false if no frame was published yet or the writer kept
+        overlapping the copy for every attempt.
+    */
+    inline bool read(uint8_t *dest, uint64_t *frame = nullptr, int64_t *time_us = nullptr, const int &attempts = 100) const {
+        if (!header)
+            return false;
+
+        for (int i = 0; i < attempts; i++) {
+            const uint32_t before = header->sequence.load(std::memory_order_acquire);
+            if (before & 1)
+                continue;
+            if (!before)
+                return false;
+
+            memcpy(dest, pixels, header->size);
+            const uint64_t f = header->frame;
+            const int64_t t = header->time_us;
+
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (header->sequence.load(std::memory_order_relaxed) != before)
+                continue;
+
+            if (frame)
+                *frame = f;
+            if (time_us)
+                *time_us = t;
+            return true;
+        }
+
+        return false;
+    }
+};
+
+}
@@ -0,0 +1,154 @@
+#pragma once
+
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "ssd1351_defs.h"
+
+#include <inttypes.h>
+#include <string.h>
+
+/*
+    @brief Emulated SSD1351 controller, decodes the SPI stream into GRAM
+
+    D/C low marks a command byte, D/C high its arguments or, after
+    WRITE_RAM, pixel data. In 65k colour mode every pixel is two bytes,
+    high byte first, written left to right inside the column/row window.
+*/
+struct SSD1351Model : public EmuSPIDevice {
+    static constexpr const int WIDTH = 128;
+    static constexpr const int HEIGHT = 128;
+
+    gpio_num_t dc;
+
+    uint16_t gram[HEIGHT][WIDTH];
+
+    uint8_t column_start = 0, column_end = WIDTH - 1, row_start = 0, row_end = HEIGHT - 1;
+    uint8_t column = 0, row = 0;
+    uint8_t remap = 0, start_line = 0, offset = 0, mux = 0x7f;
+    uint8_t master_contrast = 0x0f;
+    uint8_t lock = 0x12;
+    bool inverted = false, all_on = false, all_off = false, on = false;
+    bool writing = false;
+
+    uint32_t commands = 0, pixels = 0, unknown_commands = 0;
+
+    // Command waiting for arguments, and the ones received so far
+    uint8_t pending = 0, received = 0, expected = 0;
+    uint8_t args[4];
+
+    // High byte of a pixel waiting for its low byte
+    int high = -1;
+
+    SSD1351Model(const gpio_num_t &dc) : dc(dc) {
+        memset(gram, 0, sizeof(gram));
+    }
+
+    inline void execute(const uint8_t &c) {
+        using namespace wbl;
+        switch (c) {
+            case SSD1351::SET_COLUMN:
+                column_start = column = args[0] & 0x7f;
+                column_end = args[1] & 0x7f;
+                break;
+            case SSD1351::SET_ROW:
+                row_start = row = args[0] & 0x7f;
+                row_end = args[1] & 0x7f;
+                break;
+            case SSD1351::SET_REMAP: remap = args[0]; break;
+            case SSD1351::SET_STARTLINE: start_line = args[0] & 0x7f; break;
+            case SSD1351::SET_OFFSET: offset = args[0] & 0x7f; break;
+            case SSD1351::SET_MUX: mux = args[0]; break;
+            case SSD1351::SET_CONTRAST_MASTER: master_contrast = args[0] & 0x0f; break;
+            case SSD1351::SET_LOCK: lock = args[0]; break;
+        }
+    }
+
+    inline void command(const uint8_t &c) {
+        using namespace wbl;
+        commands++;
+        writing = false;
+        high = -1;
+
+        expected = SSD1351::arguments(c);
+        if (expected) {
+            pending = c;
+            received = 0;
+            return;
+        }
+        pending = 0;
+
+        switch (c) {
+            case SSD1351::WRITE_RAM:
+                writing = true;
+                column = column_start;
+                row = row_start;
+                break;
+            case SSD1351::ALL_OFF: all_off = true; all_on = false; break;
+            case SSD1351::ALL_ON: all_on = true; all_off = false; break;
+            case SSD1351::NORMAL: inverted = false; all_on = all_off = false; break;
+            case SSD1351::INVERT: inverted = true; all_on = all_off = false; break;
+            case SSD1351::OFF: on = false; break;
+            case SSD1351::ON: on = true; break;
+            default: unknown_commands++; break;
+        }
+    }
+
+    inline void data(const uint8_t &d) {
+        if (pending) {
+            args[received++] = d;
+            if (received == expected) {
+                execute(pending);
+                pending = 0;
+            }
+            return;
+        }
+
+        if (!writing)
+            return;
+
+        if (high < 0) {
+            high = d;
+            return;
+        }
+
+        gram[row][column] = (high << 8) | d;
+        high = -1;
+        pixels++;
+
+        if (column == column_end) {
+            column = column_start;
+            row = row == row_end ? row_start : row + 1;
+        } else
+            column++;
+    }
+
+    esp_err_t on_transfer(const uint8_t *bytes, const size_t &size) override {
+        const bool is_data = gpio_get_level(dc);
+
+        for (size_t i = 0; i < size; i++) {
+            if (is_data)
+                data(bytes[i]);
+            else
+                command(bytes[i]);
+        }
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Visible RGB565 pixel, relative to the upright REMAP_DEFAULT orientation
+    */
+    inline uint16_t pixel(const int &x, const int &y) const {
+        using namespace wbl;
+        if (!on || all_off)
+            return 0;
+        if (all_on)
+            return 0xffff;
+
+        const uint8_t flips = remap ^ SSD1351::REMAP_DEFAULT;
+        const int col = flips & SSD1351::REMAP_COLUMN ? WIDTH - 1 - x : x;
+        const int r = ((flips & SSD1351::REMAP_COM_SCAN ? HEIGHT - 1 - y : y) + start_line + offset) % HEIGHT;
+
+        return inverted ? ~gram[r][col] : gram[r][col];
+    }
+};
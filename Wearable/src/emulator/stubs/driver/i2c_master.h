@@ -0,0 +1,77 @@
+#pragma once
+
+#include "esp_system.h"
+#include "driver/gpio.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+typedef int i2c_port_num_t;
+
+typedef enum {
+    I2C_NUM_0 = 0,
+    I2C_NUM_1 = 1,
+    I2C_NUM_MAX,
+} i2c_port_t;
+
+typedef enum {
+    I2C_CLK_SRC_DEFAULT = 0,
+} i2c_clock_source_t;
+
+typedef enum {
+    I2C_ADDR_BIT_LEN_7 = 0,
+    I2C_ADDR_BIT_LEN_10 = 1,
+} i2c_addr_bit_len_t;
+
+typedef struct {
+    i2c_port_num_t i2c_port;
+    gpio_num_t sda_io_num;
+    gpio_num_t scl_io_num;
+    i2c_clock_source_t clk_source;
+    uint8_t glitch_ignore_cnt;
+    int intr_priority;
+    size_t trans_queue_depth;
+    struct {
+        uint32_t enable_internal_pullup:1;
+    } flags;
+} i2c_master_bus_config_t;
+
+typedef struct {
+    i2c_addr_bit_len_t dev_addr_length;
+    uint16_t device_address;
+    uint32_t scl_speed_hz;
+    uint32_t scl_wait_us;
+} i2c_device_config_t;
+
+typedef struct EmuI2CBus *i2c_master_bus_handle_t;
+typedef struct EmuI2CDev *i2c_master_dev_handle_t;
+
+esp_err_t i2c_new_master_bus(const i2c_master_bus_config_t *config, i2c_master_bus_handle_t *bus);
+esp_err_t i2c_del_master_bus(i2c_master_bus_handle_t bus);
+esp_err_t i2c_master_probe(i2c_master_bus_handle_t bus, uint16_t address, int timeout_ms);
+esp_err_t i2c_master_bus_add_device(i2c_master_bus_handle_t bus, const i2c_device_config_t *config, i2c_master_dev_handle_t *dev);
+esp_err_t i2c_master_bus_rm_device(i2c_master_dev_handle_t dev);
+esp_err_t i2c_master_transmit(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size, int timeout_ms);
+esp_err_t i2c_master_receive(i2c_master_dev_handle_t dev, uint8_t *read_buffer, size_t read_size, int timeout_ms);
+esp_err_t i2c_master_transmit_receive(i2c_master_dev_handle_t dev, const uint8_t *write_buffer, size_t write_size, uint8_t *read_buffer, size_t read_size, int timeout_ms);
+
+/*
+    @brief Emulator only, a device model answering on an emulated bus
+*/
+struct EmuI2CDevice {
+    virtual esp_err_t on_transmit(const uint8_t *data, const size_t &size) = 0;
+
+    virtual esp_err_t on_receive(uint8_t *data, const size_t &size) { return ESP_FAIL; }
+};
+
+struct EmuI2CStats {
+    uint32_t transactions = 0;
+    uint64_t bytes = 0;
+
+    // SCL time at each device's clock, 9 clocks per byte including the address
+    double bus_us = 0;
+};
+
+esp_err_t emu_i2c_attach(const i2c_port_num_t &port, const uint16_t &address, EmuI2CDevice *device);
+EmuI2CStats emu_i2c_stats(const i2c_port_num_t &port);
+void emu_i2c_reset_stats(const i2c_port_num_t &port);
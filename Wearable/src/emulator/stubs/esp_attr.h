@@ -0,0 +1,5 @@
+#pragma once
+
+#include "esp_system.h"
+
+#define IRAM_ATTR
@@ -0,0 +1,20 @@
+#pragma once
+
+#include "esp_system.h"
+
+#include <stdio.h>
+
+#define ESP_RETURN_ON_ERROR(x, log_tag, format, ...) do {                      \
+        const esp_err_t err_rc_ = (x);                                          \
+        if (err_rc_ != ESP_OK) {                                                \
+            fprintf(stderr, "%s: " format "\n", log_tag, ##__VA_ARGS__);        \
+            return err_rc_;                                                     \
+        }                                                                       \
+    } while(0)
+
+#define ESP_RETURN_ON_FALSE(a, err_code, log_tag, format, ...) do {            \
+        if (!(a)) {                                                             \
+            fprintf(stderr, "%s: " format "\n", log_tag, ##__VA_ARGS__);        \
+            return err_code;                                                    \
+        }                                                                       \
+    } while(0)
@@ -0,0 +1,5 @@
+#pragma once
+
+#include <inttypes.h>
+
+int64_t esp_timer_get_time();
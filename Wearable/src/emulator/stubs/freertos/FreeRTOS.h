@@ -6,6 +6,10 @@
 
 typedef uint32_t TickType_t;
 #define portTICK_PERIOD_MS 1
+#define portMAX_DELAY 0xffffffffu
+#define configMAX_PRIORITIES 25
+#define pdTRUE 1
+#define pdFALSE 0
 
 void vTaskDelay(TickType_t delay);
 void vPortYield();
\ No newline at end of file
@@ -0,0 +1,10 @@
+#pragma once
+
+#include  <inttypes.h>
+
+#include "esp_system.h"
+
+namespace wbl {
+    esp_err_t init();
+    int64_t getGPSTime();
+}
\ No newline at end of file
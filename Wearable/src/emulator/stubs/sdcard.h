@@ -0,0 +1,9 @@
+#pragma once
+
+#include "fileblockdevice.h"
+
+namespace wbl {
+
+using SDCard = FileBlockDevice;
+
+}
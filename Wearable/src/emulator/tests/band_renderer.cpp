@@ -0,0 +1,108 @@
+#include "../../display/ssd1351_buffer.h"
+#include "ssd1351_model.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+
+/*
+    Draws the same trees into a full frame and band by band, the results must
+    match. Runs once on 1bpp frames captured in memory and once on the SSD1351
+    model, where the bands are streamed through the DMA chunks.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+using MonoFrame = FramebufferT<StaticbufferT<128, 128, 1>>;
+
+// Copies every finished band into a full frame
+struct BandCapture : public BandT<FramebufferT<StaticbufferT<128, 8, 1>>, 128> {
+    MonoFrame frame;
+    uint32_t bands_sent = 0;
+
+    inline esp_err_t begin_band(const fb &band) {
+        this->setBand(band);
+        return ESP_OK;
+    }
+
+    inline esp_err_t end_band() {
+        for (fb y = band_y; y < getClipBottom(); y++)
+            for (fb x = 0; x < WIDTH; x++)
+                frame.putPixel(x, y, this->getPixel(x, y));
+        bands_sent++;
+        return ESP_OK;
+    }
+};
+
+using FullTexture = TextureT<MonoFrame>;
+using BandTexture = TextureT<BandCapture>;
+using Full565 = TextureT<SSD1351Buffer>;
+using Band565 = TextureT<SSD1351BandBuffer>;
+
+static const char *names[] = { "text", "plot", "clock" };
+
+FullTexture full;
+BandTexture band;
+SceneT<FullTexture> fullscene(full);
+SceneT<BandTexture> bandscene(band);
+
+SSD1351Model model(SPI_SSD1351::DC);
+Full565 full565;
+Band565 band565;
+SceneT<Full565> full565scene(full565);
+SceneT<Band565> band565scene(band565);
+uint16_t gram[128][128];
+
+int main() {
+    fill_plot(512);
+
+    for (int s = 0; s < 3; s++) {
+        fullscene.show(s);
+        bandscene.show(s);
+
+        full.clear();
+        const int64_t full_us = fullscene.draw();
+        band.bands_sent = 0;
+        const int64_t band_us = bandscene.draw();
+
+        const int bad = compare(full, band.frame);
+
+        printf("mono %-6s full %5lldus, %u bands %5lldus, %i pixels differ\n", names[s], (long long)full_us, band.bands_sent, (long long)band_us, bad);
+        CHECK(bad == 0);
+        CHECK(band.bands_sent == BandCapture::BANDS);
+    }
+
+    // The header is binned to the bands it covers and skipped in the others
+    CHECK(bandscene.header.bands != 0 && bandscene.header.bands != ~0u);
+    CHECK(!(bandscene.header.bands & (1u << (BandCapture::BANDS - 1))));
+
+    CHECK(emu_spi_attach(SPI2_HOST, 40, &model) == ESP_OK);
+    CHECK(full565.init() == ESP_OK);
+    CHECK(band565.init() == ESP_OK);
+
+    for (int s = 0; s < 3; s++) {
+        full565scene.show(s);
+        band565scene.show(s);
+
+        full565.clear();
+        const int64_t full_us = full565scene.draw();
+        memcpy(gram, model.gram, sizeof(gram));
+
+        emu_spi_reset_stats(SPI2_HOST);
+        const int64_t band_us = band565scene.draw();
+        const EmuSPIStats stats = emu_spi_stats(SPI2_HOST);
+
+        const int bad = memcmp(gram, model.gram, sizeof(gram)) != 0;
+        printf("rgb565 %-6s full %5lldus, banded %5lldus, %u chunks queued, %llu bytes\n", names[s], (long long)full_us, (long long)band_us, stats.queued, (unsigned long long)stats.bytes);
+
+        CHECK(!bad);
+        CHECK(stats.queued == SSD1351BandBuffer::BANDS);
+        CHECK(stats.bytes == 128 * 128 * 2 + 7);
+        CHECK(model.unknown_commands == 0);
+    }
+
+    printf("band frame %u bytes, full frame %u bytes\n", (unsigned)sizeof(SSD1351Band::buffer), (unsigned)sizeof(SSD1351Frame::buffer));
+
+    return test_result();
+}
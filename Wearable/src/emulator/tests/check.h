@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdio.h>
+
+/*
+    @brief Checks shared by the emulator tests
+
+    A failed CHECK prints where and what failed and the test carries on,
+    test_result prints OK or FAILED and is the exit status ctest reads.
+*/
+
+inline int failures = 0;
+
+#define CHECK(cond) do { if (!(cond)) { fprintf(stderr, "FAIL %s:%i: %s\n", __FILE__, __LINE__, #cond); failures++; } } while(0)
+
+inline int test_result() {
+    printf("%s\n", failures ? "FAILED" : "OK");
+
+    return failures ? 1 : 0;
+}
\ No newline at end of file
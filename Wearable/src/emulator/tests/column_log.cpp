@@ -0,0 +1,173 @@
+#include "column_log.h"
+#include "check.h"
+#include <stdio.h>
+#include <vector>
+
+/*
+    Columns pushed together share one time column, each view reads its own
+    values at the same positions. Lookups through every column's DataLogT
+    must agree with a linear search before and after the buffer wraps, also
+    when cached times go stale or share a slot. Regular timestamps must
+    spread over the search cache.
+*/
+
+using namespace wbl;
+
+using Columns = ColumnLogT<int, 100, unsigned short, uint8_t, int>;
+
+static uint32_t seed = 4321;
+
+uint32_t next_random() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+struct Sample {
+    int time;
+    unsigned short a;
+    uint8_t b;
+    int c;
+};
+
+static Columns columns;
+static std::vector<Sample> samples;
+
+void push(const int &time) {
+    const Sample s = { time, (unsigned short)(next_random() & 0xffff), uint8_t(next_random()), int(next_random()) - (1 << 23) };
+    samples.push_back(s);
+    columns.push_back(s.time, s.a, s.b, s.c);
+}
+
+int expected_index(const int &time) {
+    const int offset = int(samples.size()) - columns.size();
+    int expected = 0;
+    for (int i = 0; i < columns.size(); i++)
+        if (samples[offset + i].time <= time)
+            expected = i;
+    return expected;
+}
+
+// Every column against the samples, positions counted from the oldest kept
+int check_columns() {
+    Columns::log_type<0> a(columns.column<0>());
+    Columns::log_type<1> b(columns.column<1>());
+    Columns::log_type<2> c(columns.column<2>());
+
+    const int offset = int(samples.size()) - columns.size();
+    int wrong = 0;
+    for (int i = 0; i < columns.size(); i++) {
+        const Sample &s = samples[offset + i];
+        wrong += a.get(i).time != s.time || b.get(i).time != s.time || c.get(i).time != s.time;
+        wrong += a.get(i).value != s.a || b.get(i).value != s.b || c.get(i).value != s.c;
+    }
+
+    // Negative positions count from the newest
+    wrong += a.get(-1).time != samples.back().time || c.get(-1).value != samples.back().c;
+    return wrong;
+}
+
+int check_lookups(const int &count) {
+    Columns::log_type<0> a(columns.column<0>());
+    Columns::log_type<1> b(columns.column<1>());
+    Columns::log_type<2> c(columns.column<2>());
+
+    const int first = samples[samples.size() - columns.size()].time, last = samples.back().time;
+    int wrong = 0;
+    for (int n = 0; n < count; n++) {
+        const int t = first - 50 + int(next_random() % uint32_t(last - first + 100));
+        const int expected = expected_index(t);
+
+        // The second and third column hit the entry the first one cached
+        wrong += a.binary_index(t) != expected;
+        wrong += b.binary_index(t) != expected;
+        wrong += c.binary_index(t) != expected;
+    }
+    return wrong;
+}
+
+void shared_time() {
+    CHECK(columns.size() == 0 && columns.capacity() == 100);
+    CHECK(!columns.column<1>().has(0));
+
+    for (int i = 0; i < 60; i++)
+        push(i * 10 + int(next_random() % 10));
+
+    CHECK(columns.size() == 60);
+    CHECK(columns.column<0>().size() == 60 && columns.column<2>().size() == 60);
+    CHECK(check_columns() == 0);
+    CHECK(check_lookups(500) == 0);
+
+    // Before the first point there is nothing earlier, the first is returned
+    CHECK(columns.index_of_time(samples.front().time - 1) == 0);
+    CHECK(columns.index_of_time(samples.back().time + 1000) == 59);
+}
+
+void stale_cache() {
+    // A cached time is searched again once a push changes the answer
+    const int t = samples.back().time + 5;
+    CHECK(columns.index_of_time(t) == columns.size() - 1);
+    push(t - 1);
+    CHECK(columns.index_of_time(t) == columns.size() - 1);
+    push(t + 20);
+    CHECK(columns.index_of_time(t) == columns.size() - 2);
+
+    // Times sharing a slot replace each other's entry and are still found
+    const uint32_t slot = Columns::cache_slot(t);
+    int twin = t + 1;
+    while (Columns::cache_slot(twin) != slot)
+        twin++;
+    for (int n = 0; n < 4; n++) {
+        CHECK(columns.index_of_time(t) == expected_index(t));
+        CHECK(columns.index_of_time(twin) == expected_index(twin));
+    }
+
+    // Clearing one column clears them all
+    columns.column<1>().clear();
+    samples.clear();
+    CHECK(columns.size() == 0 && !columns.column<2>().has(0));
+}
+
+void wraparound() {
+    // Two and a half times around, checked at every stage of the last pass
+    int time = 0;
+    for (int i = 0; i < 250; i++) {
+        time += 1 + next_random() % 30;
+        push(time);
+        if (i >= 200 && i % 7 == 0) {
+            CHECK(check_columns() == 0);
+            CHECK(check_lookups(50) == 0);
+        }
+    }
+
+    CHECK(columns.size() == 100);
+    CHECK(columns.get_time(0) == samples[150].time);
+    CHECK(columns.get_time(-1) == samples.back().time);
+    CHECK(check_columns() == 0);
+    CHECK(check_lookups(2000) == 0);
+}
+
+void slots() {
+    // Timestamps on a regular grid, e.g. every second in ms, must not pile into a few slots.
+    // The low bits of the product put every multiple of the cache size in one.
+    for (const int step : { 1, 10, 64, 1000, 1024, 65536 }) {
+        bool used[Columns::cache_size] = {};
+        int distinct = 0;
+        for (int i = 0; i < Columns::cache_size; i++) {
+            const uint32_t slot = Columns::cache_slot(i * step);
+            CHECK(slot < uint32_t(Columns::cache_size));
+            distinct += !used[slot];
+            used[slot] = true;
+        }
+        printf("step %6i: %2i of %i slots\n", step, distinct, Columns::cache_size);
+        CHECK(distinct >= Columns::cache_size / 4);
+    }
+}
+
+int main() {
+    shared_time();
+    stale_cache();
+    wraparound();
+    slots();
+
+    return test_result();
+}
\ No newline at end of file
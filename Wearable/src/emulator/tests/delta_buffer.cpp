@@ -0,0 +1,218 @@
+#include "delta_buffer.h"
+#include "check.h"
+#include <stdio.h>
+#include <vector>
+
+/*
+    Points go through the bit packed blocks and must come back unchanged,
+    read in order, at random and in order again after a random read. Steps
+    are picked to land in every code width, values wrap past their sign
+    and the oldest blocks roll over. binary_index through DataLogT must
+    agree with a linear search, a steady series must stay in one block as
+    a run, and capacity() must follow what the blocks actually hold.
+*/
+
+using namespace wbl;
+
+using Point = DataPointT<int, unsigned short>;
+using Buffer = DeltaBufferT<Point, 48, 12>;
+using Log = DataLogT<Point, Buffer>;
+
+using WidePoint = DataPointT<int, int32_t>;
+using WideBuffer = DeltaBufferT<WidePoint, 48, 4>;
+
+static uint32_t seed = 12345;
+
+uint32_t next_random() {
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+template<typename Buffer, typename Point>
+void check_round_trip(const char *name, Buffer &buffer, const std::vector<Point> &points) {
+    const int count = buffer.size();
+    const int offset = int(points.size()) - count;
+    CHECK(offset >= 0);
+
+    int wrong = 0;
+    for (int i = 0; i < count; i++) {
+        const Point p = buffer.get(i);
+        wrong += p.time != points[offset + i].time || p.value != points[offset + i].value;
+    }
+
+    // Random reads, then a sequential pass that starts from wherever the cursor was left
+    for (int n = 0; n < 2000; n++) {
+        const int i = next_random() % count;
+        const Point p = buffer.get(i);
+        wrong += p.time != points[offset + i].time || p.value != points[offset + i].value;
+
+        if (n % 100 == 0) {
+            for (int j = i; j < count && j < i + 50; j++) {
+                const Point q = buffer.get(j);
+                wrong += q.time != points[offset + j].time || q.value != points[offset + j].value;
+            }
+        }
+    }
+
+    // Negative positions count from the end
+    const Point last = buffer.get(-1);
+    CHECK(last.time == points.back().time && last.value == points.back().value);
+
+    printf("%-10s %6i points in %2i blocks, capacity %i, %i wrong\n", name, count, buffer.block_count(), buffer.capacity(), wrong);
+    CHECK(wrong == 0);
+}
+
+void widths() {
+    // Nothing stored yet, a point per block at worst
+    static Buffer empty;
+    CHECK(empty.capacity() == 12);
+
+    // Prefix plus payload for each width, zero is one bit
+    CHECK(Buffer::code_bits(0, Buffer::time_widths) == 1);
+    CHECK(Buffer::code_bits(Buffer::zigzag(-4), Buffer::time_widths) == 2 + 3);
+    CHECK(Buffer::code_bits(Buffer::zigzag(200), Buffer::time_widths) == 3 + 9);
+    CHECK(Buffer::code_bits(Buffer::zigzag(-30000), Buffer::time_widths) == 4 + 16);
+    CHECK(Buffer::code_bits(Buffer::zigzag(1000000000), Buffer::time_widths) == 4 + 32);
+    CHECK(Buffer::code_bits(Buffer::zigzag(int64_t(1) << 32), Buffer::time_widths) == -1);
+
+    for (const int64_t v : { int64_t(0), int64_t(-1), int64_t(1), int64_t(INT32_MIN), int64_t(INT32_MAX), INT64_MIN, INT64_MAX })
+        CHECK(Buffer::unzigzag(Buffer::zigzag(v)) == v);
+
+    // Steps from every width class in turn, times and values
+    static Buffer buffer;
+    std::vector<Point> points;
+    const int steps[] = { 0, 3, -4, 200, -250, 30000, -32000, 1000000, -1000000 };
+    int time = 0, delta = 10;
+    unsigned short value = 100;
+    for (int i = 0; i < 600; i++) {
+        delta += steps[next_random() % 9];
+        if (delta < 1 || delta > 100000000)
+            delta = 10;
+        time += delta;
+        value += steps[next_random() % 9];
+        points.push_back(Point(time, value));
+        buffer.push_back(points.back());
+    }
+    check_round_trip("widths", buffer, points);
+}
+
+void sign_wrap() {
+    // Values around zero and the ends of the type, including jumps too wide for any code
+    static WideBuffer buffer;
+    std::vector<WidePoint> points;
+    const int32_t values[] = { 0, -1, 1, -2, INT32_MIN, INT32_MAX, -100000, 100000, INT32_MIN + 1, INT32_MAX - 1 };
+    for (int i = 0; i < 200; i++) {
+        points.push_back(WidePoint(i * 7, values[i % 10] + int32_t(next_random() % 3) - 1 + (values[i % 10] == INT32_MIN) * 2 - (values[i % 10] == INT32_MAX) * 2));
+        buffer.push_back(points.back());
+    }
+    check_round_trip("sign wrap", buffer, points);
+
+    // An unsigned value wrapping past zero either way
+    static Buffer wrapped;
+    std::vector<Point> unsigned_points;
+    unsigned short value = 65530;
+    for (int i = 0; i < 100; i++) {
+        value += (i & 8) ? -3 : 3;
+        unsigned_points.push_back(Point(i, value));
+        wrapped.push_back(unsigned_points.back());
+    }
+    check_round_trip("unsigned", wrapped, unsigned_points);
+}
+
+void rollover() {
+    // Far more than fits, the oldest blocks go and the rest keep their positions
+    static Buffer buffer;
+    std::vector<Point> points;
+    int time = 0;
+    for (int i = 0; i < 20000; i++) {
+        time += 900 + next_random() % 200;
+        points.push_back(Point(time, (unsigned short)(2000 + next_random() % 64)));
+        buffer.push_back(points.back());
+
+        if (i % 997 == 0 && buffer.size()) {
+            const int j = next_random() % buffer.size();
+            const Point p = buffer.get(j);
+            CHECK(p.time == points[points.size() - buffer.size() + j].time);
+        }
+    }
+    CHECK(buffer.block_count() == 12);
+    check_round_trip("rollover", buffer, points);
+
+    // Full, the estimate is what is held plus the unwritten part of the newest block
+    CHECK(buffer.capacity() >= buffer.size() && buffer.capacity() <= buffer.size() * 12 / 11);
+
+    // binary_index agrees with a linear search, including before the first and after the last point
+    Log log(buffer);
+    const int offset = int(points.size()) - buffer.size();
+    int wrong = 0;
+    for (int n = 0; n < 2000; n++) {
+        const int first = points[offset].time, last = points.back().time;
+        const int t = first - 500 + int(next_random() % uint32_t(last - first + 1000));
+
+        int expected = 0;
+        for (int i = 0; i < buffer.size(); i++)
+            if (points[offset + i].time <= t)
+                expected = i;
+
+        wrong += log.binary_index(t) != expected;
+    }
+    CHECK(wrong == 0);
+
+    // Reads after a search continue from its cursor
+    const int middle = buffer.size() / 2;
+    CHECK(log.binary_index(points[offset + middle].time) == middle);
+    CHECK(buffer.get(middle + 1).time == points[offset + middle + 1].time);
+    CHECK(buffer.get(middle - 1).time == points[offset + middle - 1].time);
+}
+
+void runs() {
+    // Three hours of a steady 1 Hz series fit one block
+    static Buffer steady;
+    std::vector<Point> points;
+    for (int i = 0; i < 3 * 3600; i++) {
+        points.push_back(Point(i, 4000));
+        steady.push_back(points.back());
+    }
+    CHECK(steady.block_count() == 1);
+    CHECK(steady.capacity() == 12 * UINT16_MAX);
+    check_round_trip("steady", steady, points);
+
+    // Runs broken by changes, while a cursor sits inside the run being extended
+    static Buffer broken;
+    points.clear();
+    int time = 0;
+    unsigned short value = 3000;
+    for (int i = 0; i < 30000; i++) {
+        const uint32_t r = next_random() % 1000;
+        if (r < 5)
+            value += 1;
+        time += r < 8 ? 2 : 1;
+        points.push_back(Point(time, value));
+        broken.push_back(points.back());
+
+        if (i % 37 == 0) {
+            const Point p = broken.get(-1);
+            CHECK(p.time == time && p.value == value);
+        }
+    }
+    check_round_trip("runs", broken, points);
+
+    // A run reaching the count limit starts a new block
+    static Buffer limit;
+    points.clear();
+    for (int i = 0; i < UINT16_MAX + 10; i++) {
+        points.push_back(Point(i * 2, 7));
+        limit.push_back(points.back());
+    }
+    CHECK(limit.block_count() == 2);
+    check_round_trip("limit", limit, points);
+}
+
+int main() {
+    widths();
+    sign_wrap();
+    rollover();
+    runs();
+
+    return test_result();
+}
\ No newline at end of file
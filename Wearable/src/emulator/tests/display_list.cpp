@@ -0,0 +1,160 @@
+#include "display_list.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+
+/*
+    Draws the same trees with plain and recorded elements, the frames must
+    match while damage is repaired by replaying the lists instead of drawing.
+    A serialized list replayed into another frame type must match as well.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+using Frame = TextureT<FramebufferT<StaticbufferT<128, 128, 1>>>;
+using Recorder = DisplayRecorderT<Frame>;
+
+template<typename Buffer, typename Counter, typename Clock, typename Log>
+struct Scene {
+    ElementRootT<Buffer> root;
+    ScreenBaseT<> screen { "Display list" };
+    Counter counter;
+    Clock clock;
+    Log log;
+
+    template<typename ...Args>
+    Scene(Buffer &frame, Args&... args):root(frame),counter(frame, args...),clock(frame, args...),log(frame, args..., plotbuffer) {
+        counter << StyleInfo { .width = { 40 }, .height = { 40 } };
+        clock << StyleInfo { .width = { 60 }, .height = { 60 } };
+        log << StyleInfo { .width = { 128 }, .height = { 28 } };
+        screen << counter;
+        screen << clock;
+        screen << log;
+        root.set_screen(screen);
+    }
+
+    void draw(const bool &dirty = false, const Size *damage = nullptr) {
+        root.layout_dirty = dirty;
+        root.redraw_needed = true;
+        root.damage = damage;
+        root.once();
+    }
+};
+
+using PlainScene = Scene<Frame, ElementCounterT<Frame>, ScreenClockT<Frame>, ElementLogT<Frame>>;
+using RecordedScene = Scene<Frame, RecordedT<Frame, ElementCounterT<Recorder>>, RecordedT<Frame, ScreenClockT<Recorder>>, RecordedT<Frame, ElementLogT<Recorder>>>;
+
+Frame plain, recorded;
+SurfacePoolT<> pool;
+PlainScene plainscene(plain);
+RecordedScene recordedscene(recorded, pool);
+
+void damage(const Size &area) {
+    plain.fill(area, 1);
+    recorded.fill(area, 1);
+}
+
+int main() {
+    // Sprite sources are indexed in registration order, a reader registers the same ones first
+    CHECK(DisplayReplayT<Recorder::Target>::source_index(Sprites::minifont.getCharacter('0').src) == 0);
+
+    fill_plot(512);
+
+    // The clock records with the second it drew, draw both within one
+    int64_t second = 0;
+    for (int attempt = 0; attempt < 3; attempt++) {
+        second = seconds();
+        plainscene.draw(true);
+        recordedscene.draw(true);
+        if (seconds() == second)
+            break;
+    }
+
+    CHECK(compare(plain, recorded) == 0);
+    CHECK(recordedscene.counter.records == 1);
+    CHECK(recordedscene.clock.records == 1);
+    CHECK(recordedscene.log.records == 1);
+
+    printf("lists counter %u, clock %u, log %u bytes\n",
+        recordedscene.counter.list_bytes, recordedscene.clock.list_bytes, recordedscene.log.list_bytes);
+
+    // Damage is repaired from the lists without drawing
+    const Size area(0, 20, 128, 60);
+    for (int i = 0; i < 4 && seconds() == second; i++) {
+        damage(area);
+        plainscene.draw();
+        recordedscene.draw(false, &area);
+    }
+
+    if (seconds() == second) {
+        CHECK(compare(plain, recorded) == 0);
+        CHECK(recordedscene.counter.renders == 1);
+        CHECK(plainscene.counter.renders == 5);
+        CHECK(recordedscene.counter.replays == 4);
+        CHECK(recordedscene.clock.records == 1);
+    }
+
+    // A damage rect keeps the replay inside it
+    {
+        const Size rect(8, 8, 16, 16);
+        recorded.fill(0, 0, 40, 40, 1);
+
+        Event event(Event::DRAW, Event::REDRAW);
+        event.damage = &rect;
+        recordedscene.counter.handle_event(&event);
+        CHECK(recordedscene.counter.renders == 1);
+
+        int inside = 0, outside = 0;
+        for (fb y = 0; y < 40; y++)
+            for (fb x = 0; x < 40; x++) {
+                if (rect.isBound(x, y))
+                    inside += plain.getPixel(x, y) != recorded.getPixel(x, y);
+                else
+                    outside += recorded.getPixel(x, y) != 1;
+            }
+        CHECK(inside == 0);
+        CHECK(outside == 0);
+    }
+
+    // Content changes record again
+    plainscene.counter.value = recordedscene.counter.value = 6;
+    plainscene.draw(true);
+    recordedscene.draw(true);
+    CHECK(compare(plain, recorded, recordedscene.counter) == 0);
+    CHECK(recordedscene.counter.records == 2);
+    CHECK(recordedscene.counter.renders == 2);
+
+    // Serialized lists replay into a different frame type
+    {
+        using Other = TextureT<FramebufferT<StaticbufferT<128, 128, 2>>>;
+        using Target = TextureT<DamageT<Other>>;
+        static Other other;
+
+        static pixel wire[4096], list[4096];
+        const fb sent = DisplayReplayT<Recorder::Target>::serialize(pool.get(recordedscene.log.handle), recordedscene.log.list_bytes, wire, sizeof(wire));
+        CHECK(sent == recordedscene.log.list_bytes + 4);
+
+        CHECK(DisplayReplayT<Target>::source_index(Sprites::minifont.getCharacter('0').src) == 0);
+
+        const fb received = DisplayReplayT<Target>::deserialize(wire, sent, list, sizeof(list));
+        CHECK(received == recordedscene.log.list_bytes);
+
+        const Size full(0, 0, 128, 128);
+        Target target(other, full);
+        DisplayReplayT<Target>::replay(target, list, received, full);
+
+        int bad = 0;
+        const Size &box = recordedscene.log;
+        for (fb y = box.y; y < box.getBottom(); y++)
+            for (fb x = box.x; x < box.getRight(); x++)
+                bad += (other.getPixel(x, y) != 0) != (recorded.getPixel(x, y) != 0);
+        CHECK(bad == 0);
+
+        wire[0] = 'X';
+        CHECK(!DisplayReplayT<Target>::deserialize(wire, sent, list, sizeof(list)));
+    }
+
+    return test_result();
+}
@@ -0,0 +1,225 @@
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+/*
+    Renders fixed scenarios into an in-memory framebuffer and compares them
+    against 1bpp PBM goldens in GOLDEN_DIR. Each scenario also has a budget
+    for pixel writes. Host render time (best of several runs) is only
+    reported, it depends on the host's load. The clock shows a fixed time.
+
+    Run with --update to rewrite the goldens after an intended visual change.
+    Mismatches write <name>.actual.pbm to the working directory.
+*/
+
+#ifndef GOLDEN_DIR
+#define GOLDEN_DIR "tests/golden"
+#endif
+
+using namespace wbl;
+using namespace UI;
+
+// Counts every pixel written, including the ones that do not change the buffer
+template<typename Buffer>
+struct CountingBufferT : public FramebufferT<Buffer> {
+    using Base = FramebufferT<Buffer>;
+
+    uint32_t writes = 0;
+
+    inline constexpr void putPixel(const fb &x, const fb &y, const pixel &px) {
+        writes++;
+        Base::putPixel(x, y, px);
+    }
+
+    inline constexpr void putPixel(const Origin &pos, const pixel &px) {
+        putPixel(pos.x, pos.y, px);
+    }
+
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        for (fb y = y0; y <= y1; y++)
+            putPixel(x, y, px);
+    }
+};
+
+using GoldenTexture = TextureT<CountingBufferT<StaticbufferT<128, 128, 1>>>;
+
+GoldenTexture frame;
+
+static const int W = GoldenTexture::WIDTH, H = GoldenTexture::HEIGHT;
+static const int runs = 5;
+
+struct Scenario {
+    const char *name;
+    uint32_t max_writes;
+    void (*setup)();
+    void (*render)();
+};
+
+static bool write_pbm(const char *path, const GoldenTexture &t) {
+    FILE *f = fopen(path, "wb");
+    if (!f)
+        return false;
+
+    fprintf(f, "P4\n%i %i\n", W, H);
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x += 8) {
+            uint8_t byte = 0;
+            for (int b = 0; b < 8; b++)
+                byte |= (t.getPixel(x + b, y) ? 1 : 0) << (7 - b);
+            fputc(byte, f);
+        }
+    }
+
+    fclose(f);
+    return true;
+}
+
+static bool read_pbm(const char *path, uint8_t (&bits)[H][W]) {
+    FILE *f = fopen(path, "rb");
+    if (!f)
+        return false;
+
+    int w = 0, h = 0;
+    const bool ok = fscanf(f, "P4 %i %i", &w, &h) == 2 && fgetc(f) != EOF && w == W && h == H;
+
+    for (int y = 0; ok && y < H; y++) {
+        for (int x = 0; x < W; x += 8) {
+            const int byte = fgetc(f);
+            for (int b = 0; b < 8; b++)
+                bits[y][x + b] = (byte >> (7 - b)) & 1;
+        }
+    }
+
+    fclose(f);
+    return ok;
+}
+
+/*
+    Prints the differing region, '+' is lit only in the render, '-' only in the golden
+*/
+static int diff_report(const char *name, const uint8_t (&golden)[H][W]) {
+    int count = 0, x0 = W, y0 = H, x1 = -1, y1 = -1;
+
+    for (int y = 0; y < H; y++) {
+        for (int x = 0; x < W; x++) {
+            if (bool(frame.getPixel(x, y)) == bool(golden[y][x]))
+                continue;
+            count++;
+            x0 = x < x0 ? x : x0; x1 = x > x1 ? x : x1;
+            y0 = y < y0 ? y : y0; y1 = y > y1 ? y : y1;
+        }
+    }
+
+    if (!count)
+        return 0;
+
+    fprintf(stderr, "%s: %i pixels differ in %i,%i %ix%i\n", name, count, x0, y0, x1 - x0 + 1, y1 - y0 + 1);
+
+    for (int y = y0; y <= y1 && y < y0 + 32; y++) {
+        char line[W + 2];
+        int n = 0;
+        for (int x = x0; x <= x1; x++) {
+            const bool a = frame.getPixel(x, y), g = golden[y][x];
+            line[n++] = a == g ? (a ? '#' : '.') : (a ? '+' : '-');
+        }
+        line[n++] = '\n';
+        line[n] = 0;
+        fputs(line, stderr);
+    }
+
+    return count;
+}
+
+// Scenarios
+
+SceneT<GoldenTexture> scene(frame);
+ElementRootT<GoldenTexture> &root = scene.root;
+
+static void text_setup() {
+    scene.show(scene.textscreen);
+}
+
+static void draw() {
+    root.layout_dirty = true;
+    root.once(true);
+}
+
+static void overlay() {
+    draw();
+    root.overlay_tree_positions(false, true);
+}
+
+static void plot_setup(const int &points, const SeriesStyle &style) {
+    fill_plot(points);
+    scene.plot.plot_style = style;
+    scene.show(scene.plotscreen);
+}
+
+// 10:08:37
+static int64_t fixed_time() {
+    return (10 * 3600 + 8 * 60 + 37) * 1000000ll;
+}
+
+static void clock_setup() {
+    scene.clock.clock = fixed_time;
+    scene.show(scene.clockscreen);
+}
+
+static const Scenario scenarios[] = {
+    { "text", 1000, text_setup, draw },
+    { "overlay", 2200, nullptr, overlay },
+    { "plot_64", 11000, []() { plot_setup(64, SERIES_LINE); }, draw },
+    { "plot_fill_512", 14500, []() { plot_setup(512, SERIES_FILL); }, draw },
+    { "plot_envelope_1024", 11000, []() { plot_setup(1024, SERIES_ENVELOPE); }, draw },
+    { "clock", 12500, clock_setup, draw },
+};
+
+int main(int argc, char **argv) {
+    const bool update = argc > 1 && strcmp(argv[1], "--update") == 0;
+
+    for (const Scenario &s : scenarios) {
+        // Scenarios without a setup draw on the previous one's tree
+        if (s.setup)
+            s.setup();
+
+        int64_t best = INT64_MAX;
+        for (int i = 0; i < runs; i++) {
+            frame.clear();
+            frame.writes = 0;
+
+            const int64_t start = micros();
+            s.render();
+            const int64_t elapsed = micros() - start;
+
+            best = elapsed < best ? elapsed : best;
+        }
+
+        printf("%-20s %6lldus %7u writes (max %u)\n", s.name, (long long)best, frame.writes, s.max_writes);
+
+        const std::string golden = std::string(GOLDEN_DIR) + "/" + s.name + ".pbm";
+
+        if (update) {
+            CHECK(write_pbm(golden.c_str(), frame));
+            continue;
+        }
+
+        static uint8_t bits[H][W];
+        if (!read_pbm(golden.c_str(), bits)) {
+            fprintf(stderr, "%s: missing golden %s, run with --update\n", s.name, golden.c_str());
+            failures++;
+            continue;
+        }
+
+        if (diff_report(s.name, bits)) {
+            write_pbm((std::string(s.name) + ".actual.pbm").c_str(), frame);
+            failures++;
+        }
+
+        CHECK(frame.writes <= s.max_writes);
+    }
+
+    return test_result();
+}
@@ -0,0 +1,160 @@
+#include "lazy_screen.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+    Screens build their elements on first visit into arenas from a governor
+    with fewer arenas than screens. Visiting more screens than that releases
+    the one visited longest ago, its elements are destroyed and built again
+    on the next visit from data kept outside them, drawing what a screen
+    that was never released draws.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+using Frame = TextureT<FramebufferT<StaticbufferT<128, 128, 1>>>;
+
+// App state, outlives the elements showing it
+int data[5] = { 1, 2, 3, 4, 5 };
+int alive = 0, destroyed = 0;
+
+// Draws a disc sized by the value it points at, counted while it exists
+template<typename Buffer>
+struct ElementValueT : public ElementBaseT<Buffer> {
+    const int &value;
+
+    ElementValueT(Buffer &frame, const int &value):ElementBaseT<Buffer>(frame),value(value) { alive++; }
+    ~ElementValueT() { alive--; destroyed++; }
+
+    void on_draw(Event *event) override {
+        if (!(event->value & Event::REDRAW))
+            return;
+
+        const Size &box = *this;
+        this->clear();
+        this->buffer.border(box, 1);
+        this->buffer.circle(Origin(box.x + box.width / 2, box.y + box.height / 2), 2 + value, 1);
+    }
+};
+
+using Value = ElementValueT<Frame>;
+
+Frame frame, reference;
+ElementRootT<Frame> root(frame);
+ScreenGovernorT<512, 2> governor;
+SurfacePoolT<UI_PRERENDER_BYTES, UI_PRERENDERS + 1> pool;
+
+bool build(LazyScreen &screen, ScreenArena &arena);
+
+LazyScreen screens[4] {
+    { "A", governor, build }, { "B", governor, build }, { "C", governor, build }, { "D", governor, build }
+};
+
+// Two elements per screen, the last screen asks for more than an arena holds
+bool build(LazyScreen &screen, ScreenArena &arena) {
+    const int index = &screen - screens;
+    const int count = index == 3 ? 64 : 2;
+
+    for (int i = 0; i < count; i++) {
+        Value *value = arena.make<Value>(frame, data[index + i]);
+        if (!value)
+            return false;
+
+        *value << StyleInfo { .width = { 60 }, .height = { 40 + 8 * i }, .margin = { 1 } };
+        screen << *value;
+    }
+
+    return true;
+}
+
+// The frame must not differ from drawing the active screen from scratch
+bool matches_repaint() {
+    memcpy(reference.buffer, frame.buffer, sizeof(frame.buffer));
+    root.layout_dirty = true;
+    root.once();
+    return memcmp(reference.buffer, frame.buffer, sizeof(frame.buffer)) == 0;
+}
+
+int main() {
+    root << StyleInfo { .width = { 128 }, .height = { 128 } };
+    screens[0].set_right(screens[1]);
+    screens[1].set_right(screens[2]);
+    screens[2].set_right(screens[3]);
+
+    // Nothing exists before a screen is visited
+    CHECK(alive == 0 && governor.builds == 0);
+
+    root.set_screen(screens[0]);
+    root.once();
+    CHECK(screens[0].built() && alive == 2);
+    CHECK(matches_repaint());
+
+    // Built as the switch happens and laid out on the next frame
+    press(root, Event::DPAD_RIGHT);
+    root.once();
+    CHECK(root.active_screen == &screens[1] && screens[1].built() && alive == 4);
+    CHECK(matches_repaint());
+
+    // Both arenas are taken, the screen visited longest ago is released
+    press(root, Event::DPAD_RIGHT);
+    root.once();
+    CHECK(root.active_screen == &screens[2] && screens[2].built());
+    CHECK(!screens[0].built() && screens[1].built());
+    CHECK(alive == 4 && destroyed == 2);
+    CHECK(!screens[0].child);
+    CHECK(matches_repaint());
+
+    // A build that runs out of arena leaves the screen empty and destroys what it made
+    press(root, Event::DPAD_RIGHT);
+    root.once();
+    CHECK(root.active_screen == &screens[3] && !screens[3].built());
+    CHECK(!screens[3].child && alive == 2);
+    CHECK(screens[2].built());
+
+    // Released screens come back with data that changed meanwhile
+    data[0] = 9;
+    press(root, Event::DPAD_LEFT);
+    press(root, Event::DPAD_LEFT);
+    root.once();
+    press(root, Event::DPAD_LEFT);
+    root.once();
+    CHECK(root.active_screen == &screens[0] && screens[0].built());
+    CHECK(!screens[2].built());
+    CHECK(alive == 4);
+    CHECK(matches_repaint());
+
+    // RAM is the arenas however many screens are visited
+    CHECK(governor.failed == 0);
+    CHECK(governor.builds - governor.releases == 2);
+
+    // Idle frames leave a released neighbour unbuilt and take no arena for it
+    screens[1].release();
+    root.prerender_pool = &pool;
+    const uint32_t builds = governor.builds, releases = governor.releases;
+    root.once();
+    root.once();
+    CHECK(!screens[1].built() && !root.find_prerender(&screens[1]));
+    CHECK(governor.builds == builds && governor.releases == releases);
+    CHECK(screens[0].built());
+
+    // Visiting builds it, then only its built neighbour is prerendered and shows as the screen would
+    press(root, Event::DPAD_RIGHT);
+    root.once();
+    CHECK(root.active_screen == &screens[1] && screens[1].built());
+    CHECK(matches_repaint());
+    root.once();
+    CHECK(root.find_prerender(&screens[0]) && !root.find_prerender(&screens[2]));
+    CHECK(!screens[2].built());
+    press(root, Event::DPAD_LEFT);
+    root.once();
+    CHECK(root.active_screen == &screens[0]);
+    CHECK(matches_repaint());
+
+    printf("%i screens in %i arenas of %i bytes, %u builds, %u releases\n", 4, 2, 512, governor.builds, governor.releases);
+
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,143 @@
+#include "ui_list.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+    A list renders only the rows in view and after a scroll only the rows
+    that came into view, whatever the number of entries. Every frame must
+    match the list drawn from scratch, on a row major frame and on a paged
+    frame with the list on and off page boundaries.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+// Entry i is its number and a bar i % 64 wide
+template<typename Buffer>
+struct NumberSource : public IListSourceT<Buffer> {
+    uu entries = 0;
+    int renders = 0;
+
+    uu count() override {
+        return entries;
+    }
+
+    fb row_height() override {
+        return 8;
+    }
+
+    void render(ListRowT<Buffer> &row, const uu &index) override {
+        char text[8];
+        snprintf(text, sizeof(text), "%u", unsigned(index));
+        row.draw_text(text, Sprites::minifont);
+        row.buffer.fill(Size(row.x + 40, row.y + 2, index % 64 + 1, 4), 1);
+        renders++;
+    }
+};
+
+template<typename Frame>
+struct Scene {
+    Frame frame, reference;
+    ElementRootT<Frame> root;
+    ElementBaseT<Frame> header;
+    ScreenBaseT<> screen { "List" }, below { "Below" };
+    NumberSource<Frame> source;
+    ElementListT<Frame> list;
+
+    Scene(const fb &header_height):root(frame),header(frame),list(frame, source) {
+        root << StyleInfo { .width = { 128 }, .height = { 128 } };
+        header << StyleInfo { .width = { 128 }, .height = { header_height } };
+        list << StyleInfo { .width = { 128 }, .height = { 128 - header_height } };
+        root.set_header(header);
+        screen << list;
+        screen.set_down(below);
+        root.set_screen(screen);
+    }
+
+    void press(const Event::Value &direction) {
+        ::press(root, direction);
+    }
+
+    // Rows rendered by the next frame, which must match a full repaint
+    int frame_renders() {
+        const int before = source.renders;
+        root.once();
+        const int rendered = source.renders - before;
+
+        memcpy(reference.buffer, frame.buffer, sizeof(frame.buffer));
+        root.layout_dirty = true;
+        root.once();
+        CHECK(memcmp(reference.buffer, frame.buffer, sizeof(frame.buffer)) == 0);
+
+        return rendered;
+    }
+
+    void run(const char *name, const uu &entries) {
+        source.entries = entries;
+        list.scroll_to(0);
+        root.layout_dirty = true;
+        root.once();
+
+        const fb visible = list.getVisible();
+        CHECK(visible == list.getViewport().height / 8);
+
+        // Idle frames render nothing, scrolls render the rows that came into view
+        CHECK(frame_renders() == 0);
+        list.scroll_by(1);
+        CHECK(frame_renders() == 1);
+        list.scroll_by(3);
+        CHECK(frame_renders() == 3);
+        list.scroll_by(-2);
+        CHECK(frame_renders() == 2);
+        list.scroll_by(visible);
+        CHECK(frame_renders() == visible);
+
+        const int64_t start = micros();
+        for (int i = 0; i < 32; i++) {
+            list.scroll_by(1);
+            root.once();
+        }
+        const int64_t scroll_us = micros() - start;
+
+        // Scrolling stops at the end and the root switches screens from there
+        list.scroll_to(entries);
+        CHECK(list.top == entries - visible);
+        frame_renders();
+        press(Event::DPAD_UP);
+        CHECK(list.top == entries - visible - 1 && root.active_screen == &screen);
+        CHECK(frame_renders() == 1);
+        press(Event::DPAD_DOWN);
+        CHECK(frame_renders() == 1);
+        press(Event::DPAD_DOWN);
+        CHECK(root.active_screen == &below);
+        root.set_screen(screen);
+        root.once();
+
+        // Entries rendered again when they change or appear
+        list.invalidate(list.top + 2);
+        CHECK(frame_renders() == 1);
+        source.entries += 3;
+        list.scroll_by(visible);
+        CHECK(frame_renders() == 3);
+        source.entries -= 3;
+        CHECK(frame_renders() == 3);
+
+        printf("%-10s %6u entries, %2u rows, 32 scrolls %lldus\n", name, unsigned(entries), unsigned(visible), (long long)scroll_us);
+    }
+};
+
+Scene<TextureT<FramebufferT<StaticbufferT<128, 128, 1>>>> rowmajor(16);
+Scene<TextureT<PagedFrame>> paged(16), unaligned(12);
+
+int main() {
+    rowmajor.run("row major", 100);
+    rowmajor.run("row major", 60000);
+    paged.run("paged", 100);
+    paged.run("paged", 60000);
+    unaligned.run("unaligned", 100);
+
+    return test_result();
+}
\ No newline at end of file
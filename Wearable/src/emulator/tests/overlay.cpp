@@ -0,0 +1,166 @@
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+    Shows and dismisses overlays over a tree, the frame must come back to
+    what the tree drew without repainting it, on paged and row major frames.
+    Overlays draw when shown and when the tree drew under them, which only
+    repaints the elements they cover.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+// A filled notification, counting renders
+template<typename Buffer>
+struct ElementNoticeT : public ElementBaseT<Buffer> {
+    using ElementBaseT<Buffer>::ElementBaseT;
+
+    int renders = 0;
+
+    void on_draw(Event *event) override {
+        if (!(event->value & Event::REDRAW))
+            return;
+
+        renders++;
+        this->clear(1);
+        this->draw_text("NOTICE", Sprites::minifont, { 2, 2 });
+    }
+};
+
+template<typename Frame>
+struct Scene {
+    Frame frame, reference;
+    ElementRootT<Frame> root;
+    ScreenBaseT<> screen { "Overlay" };
+    ElementCounterT<Frame> first, second;
+    ElementNoticeT<Frame> notice, toast;
+
+    Scene():root(frame),first(frame),second(frame),notice(frame),toast(frame) {
+        root << StyleInfo { .width = { 128 }, .height = { 128 } };
+        first << StyleInfo { .width = { 60 }, .height = { 60 } };
+        second << StyleInfo { .width = { 60 }, .height = { 60 } };
+        screen << first;
+        screen << second;
+        root.set_screen(screen);
+    }
+
+    void draw() {
+        root.once(true);
+    }
+
+    void snapshot() {
+        memcpy(reference.buffer, frame.buffer, sizeof(frame.buffer));
+    }
+
+    int compare(const Size &area = { 0, 0, 128, 128 }) {
+        return ::compare(frame, reference, area);
+    }
+
+    void run(const char *name, ISurfacePool *pool) {
+        root.overlay_pool = pool;
+
+        draw();
+        snapshot();
+        const int renders = first.renders + second.renders;
+
+        // Covers parts of both counters, unaligned to pages
+        const Size box(10, 50, 70, 19), box2(40, 60, 50, 30);
+        CHECK(root.show_overlay(notice, box));
+        CHECK(root.show_overlay(toast, box2));
+        draw();
+        CHECK(frame.getPixel(box.x, box.y) == 1);
+        CHECK(frame.getPixel(box2.getRight() - 1, box2.getBottom() - 1) == 1);
+        CHECK(compare({ 0, 100, 128, 28 }) == 0);
+
+        // Frames under a live overlay keep drawing only what changed, the overlays are left alone
+        draw();
+        draw();
+        CHECK(frame.getPixel(box.x, box.y) == 1);
+        CHECK(notice.renders == 1 && toast.renders == 1);
+
+        // Dismissal puts the tree back at once, the remaining overlay draws again next frame
+        root.dismiss_overlay(toast);
+        CHECK((compare() == 0) == bool(pool));
+        draw();
+        CHECK(frame.getPixel(box.x, box.y) == 1);
+        CHECK(frame.getPixel(box2.getRight() - 1, box2.getBottom() - 1) == reference.getPixel(box2.getRight() - 1, box2.getBottom() - 1));
+
+        root.dismiss_overlay(notice);
+        draw();
+        CHECK(compare() == 0);
+
+        const int repainted = first.renders + second.renders - renders;
+        printf("%-10s %s, %i renders after overlays\n", name, pool ? "saved under" : "repainted", repainted);
+
+        // Without a pool every frame after one with overlays is a full repaint
+        CHECK(pool ? repainted == 0 : repainted > 0);
+
+        // Only the elements under an overlay the tree drew into are repaired
+        const Size inside(second.x + 8, second.y + 8, 24, 20);
+        CHECK(root.show_overlay(notice, inside));
+        draw();
+        snapshot();
+        int shown = notice.renders, firsts = first.renders, seconds = second.renders;
+        first.value = 2;
+        draw();
+        CHECK(notice.renders == shown);
+        CHECK(compare(inside) == 0);
+        second.value = 2;
+        draw();
+        CHECK(notice.renders == shown + 1);
+        // Without a pool the lost save repaints the whole tree
+        CHECK(first.renders == firsts + (pool ? 1 : 2));
+        CHECK(second.renders == seconds + 2);
+        CHECK(compare(inside) == 0);
+        root.dismiss_overlay(notice);
+        first.value = second.value = 0;
+        draw();
+
+        // Content that changed under an overlay shows once it goes away
+        CHECK(root.show_overlay(notice, { 0, 0, 128, 128 }));
+        draw();
+        snapshot();
+        second.value = 3;
+        draw();
+        CHECK(compare() == 0);
+        root.dismiss_overlay(notice);
+        draw();
+        CHECK(frame.getPixel(second.getMidpoint().x + 6, second.getMidpoint().y) == 1);
+    }
+};
+
+using Paged = TextureT<PagedFrame>;
+using RowMajor = TextureT<FramebufferT<StaticbufferT<128, 128, 1>>>;
+
+SurfacePoolT<> pool, rowpool;
+Scene<Paged> paged, unsaved;
+Scene<RowMajor> rowmajor;
+
+int main() {
+    paged.run("paged", &pool);
+    rowmajor.run("row major", &rowpool);
+    unsaved.run("no pool", nullptr);
+
+    // Debug overlays are saved under too, outside the pool
+    {
+        const uint32_t acquired = pool.stats.acquired;
+        paged.root.debug = true;
+        paged.root.debug_details = 1;
+        paged.draw();
+        CHECK(pool.stats.acquired == acquired);
+        paged.root.debug = false;
+        paged.draw();
+        paged.snapshot();
+        paged.root.redraw_needed = true;
+        paged.draw();
+        CHECK(paged.compare() == 0);
+    }
+
+    CHECK(pool.stats.failed == 0);
+
+    return test_result();
+}
@@ -0,0 +1,199 @@
+#include "parallel_draw.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string>
+
+/*
+    Draws the same trees serially and split across the draw task, the frames
+    must match. Then times both, the worker is a std::thread on the host so
+    the speedup only hints at the one between the two ESP32-S3 cores. The
+    switch between serial and split frames runs on a fake clock that only
+    the elements drawn advance, so it does not depend on the host's load.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+using Texture = TextureT<ClippedT<FramebufferT<StaticbufferT<128, 128, 1>>>>;
+
+// Two plots and a taller clock, both screens straddle the split
+struct Scene : public SceneT<Texture> {
+    ElementLogT<Texture> plot2;
+
+    Scene(Texture &frame):SceneT<Texture>(frame),plot2(frame, plotbuffer) {
+        plot << StyleInfo { .width = { 128 }, .height = { 56 } };
+        plot2 << StyleInfo { .width = { 128 }, .height = { 56 } };
+        plotscreen << plot2;
+
+        clock << StyleInfo { .width = { 128 }, .height = { 120 } };
+    }
+};
+
+static const char *names[] = { "text", "plot", "clock" };
+
+Texture serial;
+Texture split;
+Scene serialscene(serial);
+Scene splitscene(split);
+ParallelDrawT<Texture> parallel(splitscene.root);
+
+// Advances the clock of the thread drawing it by what it costs, split or not
+thread_local int64_t fake_now = 0;
+
+int64_t fake_clock() {
+    return fake_now;
+}
+
+struct ElementCost : public ElementBaseT<Texture> {
+    int64_t cost = 0, split_cost = 0;
+
+    ElementCost(Texture &buffer):ElementBaseT<Texture>(buffer) {}
+
+    void on_draw(Event *event) override {
+        fake_now += event->shared ? split_cost : cost;
+        this->buffer.fill(*this, 1);
+    }
+};
+
+// Two halves, one on each side of the split, the gap between keeps their padded boxes apart
+struct CostScene {
+    Texture frame;
+    ElementRootT<Texture> root;
+    ScreenBaseT<> screen { "Cost" };
+    ElementCost top, bottom;
+    ElementBaseT<Texture> gap;
+    ParallelDrawT<Texture> pass;
+
+    CostScene():root(frame),top(frame),bottom(frame),gap(frame),pass(root) {
+        top << StyleInfo { .width = { 128 }, .height = { 62 } };
+        gap << StyleInfo { .width = { 128 }, .height = { 4 } };
+        bottom << StyleInfo { .width = { 128 }, .height = { 62 } };
+        screen << top;
+        screen << gap;
+        screen << bottom;
+        root.set_screen(screen);
+        root.dispatch(EventTypes::CONTENT_SIZE);
+        root.resolve_layout();
+        pass.clock = fake_clock;
+        pass.remeasure = 4;
+    }
+
+    void set_cost(const int64_t &cost, const int64_t &split_cost) {
+        top.cost = bottom.cost = cost;
+        top.split_cost = bottom.split_cost = split_cost;
+    }
+
+    // S for a serial frame, P for a split one
+    char frame_mode() {
+        const uint32_t frames = pass.total.frames;
+        root.layout_dirty = true;
+        root.once();
+        return pass.total.frames != frames ? 'P' : 'S';
+    }
+
+    std::string run(const int &count) {
+        std::string modes;
+        for (int i = 0; i < count; i++)
+            modes += frame_mode();
+        return modes;
+    }
+};
+
+CostScene costscene;
+
+void adaptive() {
+    CHECK(costscene.pass.start(1) == ESP_OK);
+
+    // Cheap frames stay serial
+    costscene.set_cost(500, 500);
+    CHECK(costscene.run(8) == "SSSSSSSS");
+
+    // Costly ones split, checked against a serial frame every remeasure frames
+    costscene.set_cost(1500, 1500);
+    const std::string costly = costscene.run(10);
+    printf("costly split %s\n", costly.c_str());
+    CHECK(costly == "SPPPPSPPPP");
+    CHECK(costscene.pass.split_us == 1500 && costscene.pass.serial_us == 3000);
+
+    // One slow frame splits for at most remeasure frames, then a serial one finds it cheap again
+    costscene.set_cost(500, 500);
+    const std::string settled = costscene.run(6);
+    CHECK(settled.back() == 'S');
+    costscene.top.cost = 2500;
+    CHECK(costscene.run(1) == "S");
+    costscene.top.cost = 500;
+    CHECK(costscene.run(10) == "PPPPSSSSSS");
+
+    // A split slower than serial backs off for remeasure frames before trying again
+    costscene.set_cost(1500, 3000);
+    const std::string losing = costscene.run(16);
+    printf("losing split %s\n", losing.c_str());
+    CHECK(losing == "SPSSSSPSSSSPSSSS");
+
+    // Not adaptive, every frame splits whatever it costs
+    costscene.pass.adaptive = false;
+    costscene.set_cost(0, 0);
+    CHECK(costscene.run(4) == "PPPP");
+
+    costscene.pass.stop();
+}
+
+int main() {
+    fill_plot(512);
+
+    // Without the task the pass falls back to drawing serially
+    CHECK(!parallel.task);
+    CHECK(parallel.start(1) == ESP_OK);
+    CHECK(splitscene.root.draw_pass == &parallel);
+
+    // Split every frame
+    parallel.adaptive = false;
+
+    constexpr int RUNS = 200;
+
+    for (int s = 0; s < 3; s++) {
+        serialscene.show(s);
+        splitscene.show(s);
+
+        serialscene.draw();
+        splitscene.draw();
+        const int bad = compare(serial, split);
+
+        // Undirtied frames only redraw what changed, straddling elements included
+        serialscene.draw(false);
+        splitscene.draw(false);
+        const int bad_undirtied = compare(serial, split);
+
+        int64_t serial_us = 0, split_us = 0;
+        for (int i = 0; i < RUNS; i++) {
+            serial_us += serialscene.draw();
+            split_us += splitscene.draw();
+        }
+
+        printf("%-6s serial %5lldus, split %5lldus (%.2fx), split at page %u, %i/%i pixels differ\n",
+            names[s], (long long)(serial_us / RUNS), (long long)(split_us / RUNS), float(serial_us) / float(split_us), parallel.split, bad, bad_undirtied);
+
+        CHECK(bad == 0);
+        CHECK(bad_undirtied == 0);
+        CHECK(parallel.split > 0 && parallel.split < ParallelDrawT<Texture>::PAGES);
+    }
+
+    printf("%u frames, main %lldus, worker %lldus, waited %lldus\n",
+        parallel.total.frames, (long long)parallel.total.main_us, (long long)parallel.total.worker_us, (long long)parallel.total.wait_us);
+    CHECK(parallel.total.frames == 3 * (RUNS + 2));
+    CHECK(parallel.total.worker_us > 0);
+    CHECK(parallel.total.serial_frames == 0);
+
+    // Each clip stays on its own side of the split
+    CHECK(Texture::clip.top == 0 && Texture::clip.bottom == 128);
+
+    parallel.stop();
+    CHECK(!parallel.task);
+    CHECK(!splitscene.root.draw_pass);
+
+    adaptive();
+
+    return test_result();
+}
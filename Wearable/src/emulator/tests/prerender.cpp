@@ -0,0 +1,135 @@
+#include "transition.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+    Idle frames prerender the neighbours of the active screen, navigating to
+    one must show it without drawing it again and match a full repaint. Both
+    the neighbour and the screen left behind come from the pool.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+using Frame = TextureT<FramebufferT<StaticbufferT<128, 128, 1>>>;
+
+Frame frame, reference;
+SurfacePoolT<UI_PRERENDER_BYTES, UI_PRERENDERS + 1> pool;
+ElementRootT<Frame> root(frame);
+ScreenTransitionT<Frame> transition(frame);
+ElementCounterT<Frame> header(frame);
+ScreenBaseT<> center { "Center" }, right { "Right" }, left { "Left" };
+ElementCounterT<Frame> counters[3] { { frame }, { frame }, { frame } };
+
+int renders() {
+    return counters[0].renders + counters[1].renders + counters[2].renders;
+}
+
+// The frame must not differ from drawing the active screen from scratch
+bool matches_repaint() {
+    memcpy(reference.buffer, frame.buffer, sizeof(frame.buffer));
+    root.layout_dirty = true;
+    root.once();
+    return memcmp(reference.buffer, frame.buffer, sizeof(frame.buffer)) == 0;
+}
+
+int main() {
+    root << StyleInfo { .width = { 128 }, .height = { 128 } };
+    header << StyleInfo { .width = { 128 }, .height = { 16 } };
+    root.set_header(header);
+
+    IScreen *screens[] = { &center, &right, &left };
+    for (int i = 0; i < 3; i++) {
+        counters[i].value = i;
+        counters[i] << StyleInfo { .width = { 64 + 16 * i }, .height = { 40 + 20 * i } };
+        *screens[i] << counters[i];
+    }
+    center.set_right(right);
+    center.set_left(left);
+
+    root.prerender_pool = &pool;
+    root.set_screen(center);
+
+    // The first frame repaints, the next ones prerender a neighbour each without touching the frame
+    root.once();
+    memcpy(reference.buffer, frame.buffer, sizeof(frame.buffer));
+    root.once();
+    CHECK(root.find_prerender(&right) || root.find_prerender(&left));
+    root.once();
+    CHECK(root.find_prerender(&right) && root.find_prerender(&left));
+    CHECK(memcmp(reference.buffer, frame.buffer, sizeof(frame.buffer)) == 0);
+    CHECK(counters[1].renders == 1 && counters[2].renders == 1);
+
+    // Fresh prerenders are left alone
+    root.once();
+    CHECK(counters[1].renders == 1 && counters[2].renders == 1);
+
+    // Navigation swaps the prerender in, what changed since redraws on the next frame
+    header.value = 5;
+    counters[1].value = 4;
+    int before = renders();
+    int64_t start = micros();
+    press(root, Event::DPAD_RIGHT);
+    root.once();
+    const int64_t swapped_us = micros() - start;
+    CHECK(root.active_screen == &right);
+    CHECK(renders() - before == 1);
+    CHECK(root.find_prerender(&center));
+    CHECK(matches_repaint());
+
+    // Back to the screen left behind, nothing on it changed
+    before = renders();
+    press(root, Event::DPAD_LEFT);
+    root.once();
+    CHECK(root.active_screen == &center);
+    CHECK(renders() == before);
+    CHECK(matches_repaint());
+
+    // Without a prerender the switch draws the screen
+    root.prerender_pool = nullptr;
+    start = micros();
+    press(root, Event::DPAD_LEFT);
+    root.once();
+    const int64_t drawn_us = micros() - start;
+    CHECK(root.active_screen == &left);
+    CHECK(matches_repaint());
+
+    printf("switch from prerender %lldus, drawn %lldus\n", (long long)swapped_us, (long long)drawn_us);
+
+    // A slide takes its target from the prerender as well
+    root.prerender_pool = &pool;
+    root.transition = &transition;
+    root.once();
+    root.once();
+    before = renders();
+    press(root, Event::DPAD_RIGHT);
+    do
+        root.once();
+    while (root.transitioning);
+    CHECK(root.active_screen == &center);
+    CHECK(renders() == before);
+    CHECK(matches_repaint());
+
+    // A frame with no budget left prerenders nothing
+    for (auto &prerender : root.prerenders) {
+        pool.release(prerender.handle);
+        prerender.screen = nullptr;
+    }
+    root.frame_budget_us = 0;
+    before = renders();
+    root.once();
+    root.once();
+    CHECK(!root.find_prerender(&left) && !root.find_prerender(&right));
+    CHECK(renders() == before);
+    root.frame_budget_us = UI_FRAME_BUDGET_US;
+    root.once();
+    CHECK(root.find_prerender(&left) || root.find_prerender(&right));
+    printf("last prerender %lldus\n", (long long)root.prerender_us);
+
+    CHECK(pool.stats.failed == 0);
+
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,144 @@
+#include "sampler.h"
+#include "i2c_arbiter.h"
+#include "emu_clock.h"
+#include "check.h"
+#include <stdio.h>
+
+/*
+    The filters are checked on known sequences. On the virtual clock every
+    sensor must be read once per period, and sensors due together on a
+    shared bus must be read under one acquire of that bus, here the I2C
+    arbiter's.
+*/
+
+using namespace wbl;
+
+template<typename Filter>
+int run_filter(Filter &filter, const int32_t *in, const int &count, int32_t *out) {
+    int outputs = 0;
+    for (int i = 0; i < count; i++)
+        if (filter.push(in[i], out[outputs]))
+            outputs++;
+    return outputs;
+}
+
+void filters() {
+    const int32_t ramp[12] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12 };
+    int32_t out[64];
+
+    DecimateT<3> decimate;
+    CHECK(run_filter(decimate, ramp, 12, out) == 4);
+    CHECK(out[0] == 3 && out[1] == 6 && out[2] == 9 && out[3] == 12);
+
+    BoxcarT<4> boxcar;
+    CHECK(run_filter(boxcar, ramp, 12, out) == 3);
+    CHECK(out[0] == 2 && out[1] == 6 && out[2] == 10);
+
+    // Settles on a constant within STAGES outputs, negative values survive the unsigned integrators
+    const int32_t level[40] = { -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700,
+        -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700, -700 };
+    CICT<4, 3> cic;
+    CHECK(run_filter(cic, level, 40, out) == 10);
+    for (int i = 2; i < 10; i++)
+        CHECK(out[i] == -700);
+
+    // A ramp comes out as a ramp R times as steep once settled
+    CICT<4, 3> cic_ramp;
+    int32_t long_ramp[64];
+    for (int i = 0; i < 64; i++)
+        long_ramp[i] = i * 4;
+    CHECK(run_filter(cic_ramp, long_ramp, 64, out) == 16);
+    for (int i = 2; i < 16; i++)
+        CHECK(out[i] - out[i - 1] == 16);
+
+    FilterChainT<DecimateT<2>, BoxcarT<3>> chain;
+    CHECK(run_filter(chain, ramp, 12, out) == 2);
+    CHECK(out[0] == 4 && out[1] == 10);
+}
+
+I2CArbiter arbiter;
+int acquires = 0, unheld_reads = 0;
+
+esp_err_t acquire(void *ctx) {
+    acquires++;
+    return I2CArbiter::acquire_bus(ctx);
+}
+
+esp_err_t read_shared(int32_t *values) {
+    if (!arbiter.held_by_caller())
+        unheld_reads++;
+    values[0] = int32_t(micros() / 1000);
+    return ESP_OK;
+}
+
+esp_err_t read_local(int32_t *values) {
+    values[0] = 1;
+    return ESP_OK;
+}
+
+int stored = 0;
+
+void store(const int64_t &time, const int32_t *values) {
+    stored++;
+}
+
+int main() {
+    filters();
+
+    // Main joins the clock first, time only moves while it waits too
+    emu_clock_set_virtual(true);
+    emu_clock_set_frame_thread();
+    CHECK(arbiter.start() == ESP_OK);
+
+    // Two sensors on bus 1 due together every 10ms, one 2ms later every 20ms, one on its own every 25ms
+    SensorT<1> fast("fast", 10000, 1, read_shared, store), twin("twin", 10000, 1, read_shared, store);
+    SensorT<1, BoxcarT<5>> slow("slow", 20000, 1, read_shared, store);
+    SensorT<1> local("local", 25000, read_local, store);
+
+    Sampler sampler;
+    sampler.set_bus(1, acquire, I2CArbiter::release_bus, &arbiter);
+    CHECK(sampler.add(fast) == ESP_OK && sampler.add(twin) == ESP_OK && sampler.add(slow) == ESP_OK && sampler.add(local) == ESP_OK);
+
+    // Start the slow sensor off the others' grid, inside the coalescing window
+    slow.next = micros() + 1000;
+    CHECK(sampler.start() == ESP_OK);
+
+    const int64_t start = micros();
+    for (int i = 0; i < 100; i++) {
+        delay(10);
+        sampler.drain();
+    }
+    const int64_t elapsed = micros() - start;
+    sampler.stop();
+    delay(20);
+    sampler.drain();
+
+    sampler.print_stats();
+    printf("%lld simulated us, %i acquires\n", (long long)elapsed, acquires);
+
+    // One read per period from the start, the read due as the sampler stops may or may not run
+    const uint32_t periods = uint32_t(elapsed / 10000);
+    CHECK(fast.stats.samples >= periods && fast.stats.samples <= periods + 1);
+    CHECK(twin.stats.samples == fast.stats.samples);
+    CHECK(slow.stats.samples >= periods / 2 && slow.stats.samples <= periods / 2 + 1);
+    CHECK(local.stats.samples >= uint32_t(elapsed / 25000) && local.stats.samples <= uint32_t(elapsed / 25000) + 1);
+    CHECK(slow.stats.outputs == slow.stats.samples / 5);
+    for (const ISensor *sensor : { (ISensor*)&fast, (ISensor*)&twin, (ISensor*)&slow, (ISensor*)&local }) {
+        CHECK(sensor->stats.missed == 0 && sensor->stats.errors == 0 && sensor->stats.dropped == 0);
+        CHECK(sensor->stats.jitter_us_max <= 1000);
+    }
+
+    // Every output reached its store
+    CHECK(stored == int(fast.stats.outputs + twin.stats.outputs + slow.stats.outputs + local.stats.outputs));
+
+    // The slow sensor joins the batch of the other two, one acquire per 10ms
+    CHECK(sampler.bus_batches == uint32_t(acquires));
+    CHECK(sampler.bus_batches == fast.stats.samples);
+    CHECK(unheld_reads == 0);
+    CHECK(!arbiter.holder.load());
+
+    arbiter.stop();
+    emu_tasks_stop();
+
+    return test_result();
+}
\ No newline at end of file
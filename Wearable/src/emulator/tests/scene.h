@@ -0,0 +1,144 @@
+#pragma once
+
+#include "framebuffer.h"
+#include "ui.h"
+#include "ui_log.h"
+#include "sprites.h"
+#include "wbl_func.h"
+#include <math.h>
+
+/*
+    @brief Trees and data shared by the emulator's rendering tests
+
+    SceneT holds the text, plot and clock screens the tests draw, its plots
+    read plotbuffer once fill_plot() has filled it. Tests that need other
+    sizes restyle the elements after construction. compare() counts the
+    pixels two frames differ in, ElementCounterT shows when an element
+    rendered and PagedFrame lays pixels out like the SH1107.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+inline LoopBuffer plotbuffer;
+
+// A noisy sine, one point per second
+inline void fill_plot(const int &points) {
+    plotbuffer.clear();
+    for (int i = 0; i < points; i++)
+        plotbuffer.push_back({ i * 1000, int(sinf(i * 0.05f) * 400.0f + ((i * 7919) % 97)) + 1000 });
+}
+
+// The SH1107 layout, a byte holds a column of 8 rows
+struct PagedFrame : public FramebufferT<StaticbufferT<128, 128, 1>> {
+    static constexpr fb PAGE_ROWS = 8;
+
+    inline constexpr fb getOffset(const fb &x, const fb &y) const {
+        return (y / 8) * WIDTH + x;
+    }
+
+    inline constexpr void putPixel(const fb &x, const fb &y, const pixel &px) {
+        buffer[getOffset(x, y)] = (buffer[getOffset(x, y)] & ~(1 << (y & 7))) | (px << (y & 7));
+    }
+
+    inline constexpr pixel getPixel(const fb &x, const fb &y) const {
+        return (buffer[getOffset(x, y)] >> (y & 7)) & 1;
+    }
+
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        for (fb y = y0; y <= y1; y++)
+            putPixel(x, y, px);
+    }
+};
+
+// A button released on the tree
+template<typename Root>
+void press(Root &root, const Event::Value &direction) {
+    Event input(Event::USER_INPUT, Event::Value(Event::RELEASED | direction), Event::CHILDREN, Event::NORMAL);
+    root.dispatch_event(&input);
+}
+
+// Pixels that differ between two frames inside area
+template<typename A, typename B>
+int compare(const A &a, const B &b, const Size &area = { 0, 0, 128, 128 }) {
+    int bad = 0;
+    for (fb y = area.y; y < area.getBottom(); y++)
+        for (fb x = area.x; x < area.getRight(); x++)
+            bad += a.getPixel(x, y) != b.getPixel(x, y);
+    return bad;
+}
+
+// Clears its box and draws a disc sized by value, counting renders
+template<typename Buffer>
+struct ElementCounterT : public ElementBaseT<Buffer> {
+    using ElementBaseT<Buffer>::ElementBaseT;
+
+    int value = 0, drawn_value = -1, renders = 0;
+
+    void on_draw(Event *event) override {
+        if (value == drawn_value && !(event->value & Event::REDRAW))
+            return;
+
+        drawn_value = value;
+        renders++;
+
+        const Size &box = *this;
+        this->clear();
+        this->buffer.border(box, 1);
+        this->buffer.circle(Origin(box.x + box.width / 2, box.y + box.height / 2), 4 + value, 1);
+        this->draw_text("42", Sprites::minifont, { 2, 2 });
+    }
+};
+
+template<typename Texture>
+struct SceneT {
+    ElementRootT<Texture> root;
+    ElementBaseT<Texture> header;
+    ElementBatteryT<Texture> battery;
+    ScreenBaseT<> textscreen { "Text" };
+    ElementInlineTextT<Texture, Sprites::MinifontProvider> minitext;
+    ElementInlineTextT<Texture> text;
+    ScreenBaseT<> plotscreen { "Plot" };
+    ElementLogT<Texture> plot;
+    ScreenBaseT<> clockscreen { "Clock" };
+    ScreenClockT<Texture> clock;
+
+    SceneT(Texture &frame)
+        :root(frame),header(frame),battery(frame),minitext(frame, Sprites::minifont),text(frame, Sprites::font),plot(frame, plotbuffer),clock(frame) {
+        battery.set_battery_level(73);
+        header << battery;
+
+        minitext.text = "MINIFONT 0123456789 !?%";
+        text.text = "Wearable";
+        textscreen << minitext;
+        textscreen << text;
+
+        plot << StyleInfo { .width = { 128 }, .height = { 64 } };
+        plotscreen << plot;
+
+        clock << StyleInfo { .width = { 100 }, .height = { 100 } };
+        clockscreen << clock;
+
+        root.set_header(header);
+    }
+
+    void show(IScreen &screen) {
+        root.set_screen(screen);
+        root.dispatch(EventTypes::CONTENT_SIZE);
+        root.resolve_layout();
+    }
+
+    // 0 text, 1 plot, 2 clock
+    void show(const int &index) {
+        IScreen *screens[] = { &textscreen, &plotscreen, &clockscreen };
+        show(*screens[index]);
+    }
+
+    // Host time of one frame
+    int64_t draw(const bool &dirty = true) {
+        root.layout_dirty = dirty;
+        const int64_t start = micros();
+        root.once();
+        return micros() - start;
+    }
+};
\ No newline at end of file
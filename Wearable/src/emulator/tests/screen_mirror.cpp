@@ -0,0 +1,170 @@
+#include "screen_mirror.h"
+#include "uart.h"
+#include "wbl_func.h"
+#include "check.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <atomic>
+#include <mutex>
+#include <thread>
+
+using namespace wbl;
+
+static const int PAGES = 16, PAGE_BYTES = 128, SIZE = PAGES * PAGE_BYTES;
+static const int frames = 400;
+
+using TestMirror = ScreenMirrorT<MirrorUart, PAGES, PAGE_BYTES>;
+using Decoder = ScreenMirrorDecoderT<SIZE>;
+
+// Every frame offered to the mirror, indexed by its frame number
+static uint8_t history[frames + 2][SIZE];
+
+static void put_pixel(uint8_t *frame, const int &x, const int &y, const bool &on) {
+    uint8_t &byte = frame[(y >> 3) * PAGE_BYTES + x];
+    byte = on ? byte | (1 << (y & 7)) : byte & ~(1 << (y & 7));
+}
+
+// A moving box and a counter strip, small changes like the UI makes
+static void render(uint8_t *frame, const int &i) {
+    for (int y = 0; y < 16; y++)
+        for (int x = 0; x < 16; x++) {
+            put_pixel(frame, (i + x) % 128, 40 + y, false);
+            put_pixel(frame, (i + 1 + x) % 128, 40 + y, true);
+        }
+    for (int x = 0; x < 32; x++)
+        put_pixel(frame, 96 + x, 120, (i >> (x & 15)) & 1);
+}
+
+static void rle_roundtrip() {
+    uint8_t src[600], packed[700], out[600];
+    for (int pattern = 0; pattern < 4; pattern++) {
+        for (int i = 0; i < int(sizeof(src)); i++) {
+            switch (pattern) {
+                case 0: src[i] = 0; break;
+                case 1: src[i] = rand(); break;
+                case 2: src[i] = (i / 3) & 1 ? 0xff : i; break;
+                case 3: src[i] = (i % 5) < 2 ? 0x55 : i; break;
+            }
+        }
+        const size_t size = Mirror::rle_encode(src, sizeof(src), packed);
+        CHECK(size <= sizeof(src) + sizeof(src) / 128 + 1);
+        CHECK(Mirror::rle_decode(packed, size, out, sizeof(out)) == size);
+        CHECK(memcmp(src, out, sizeof(src)) == 0);
+        CHECK(Mirror::rle_decode(packed, size - 1, out, sizeof(out)) == 0);
+    }
+}
+
+int main() {
+    rle_roundtrip();
+
+    // The emulated UART writes into the terminal side, the host reads the other end
+    const int host = posix_openpt(O_RDWR | O_NOCTTY);
+    CHECK(host >= 0 && grantpt(host) == 0 && unlockpt(host) == 0);
+    const int device = open(ptsname(host), O_RDWR | O_NOCTTY);
+    CHECK(device >= 0);
+
+    termios tio;
+    tcgetattr(device, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(device, TCSANOW, &tio);
+
+    MirrorUart uart;
+    CHECK(emu_uart_attach(MirrorUart::PORT, device) == ESP_OK);
+    CHECK(uart.init() == ESP_OK);
+
+    static TestMirror mirror(uart, MIRROR_LAYOUT_PAGES, 0, 20);
+    static Decoder decoder;
+
+    std::mutex lock;
+    std::atomic<bool> done(false);
+    int mismatches = 0;
+    uint64_t received = 0;
+
+    std::thread reader([&]() {
+        uint8_t data[256];
+        while (!done) {
+            pollfd p = { host, POLLIN, 0 };
+            if (poll(&p, 1, 10) <= 0)
+                continue;
+            const ssize_t n = read(host, data, sizeof(data));
+            if (n <= 0)
+                continue;
+
+            std::lock_guard<std::mutex> guard(lock);
+            received += n;
+            if (decoder.feed(data, n) && memcmp(decoder.frame, history[decoder.info.frame], SIZE) != 0)
+                mismatches++;
+        }
+    });
+
+    mirror.update(history[0]);
+    CHECK(mirror.messages == 0);
+
+    mirror.start();
+
+    // As fast as possible, the port can not keep up and frames are skipped instead of waited for
+    int64_t slowest = 0;
+    for (int i = 1; i <= frames; i++) {
+        memcpy(history[i], history[i - 1], SIZE);
+        render(history[i], i);
+
+        const int64_t start = micros();
+        CHECK(mirror.update(history[i]) == ESP_OK);
+        const int64_t elapsed = micros() - start;
+        slowest = elapsed > slowest ? elapsed : slowest;
+
+        if (i == frames / 2) {
+            // Line noise between messages
+            const uint8_t noise[] = { 'W', 'M', 0xff, 0xff, 'W', 0, 1, 2, 'M' };
+            write(device, noise, sizeof(noise));
+        }
+    }
+
+    CHECK(mirror.frames_busy > 0);
+    CHECK(slowest < 20000);
+
+    // Once the port drained, the last frame gets through as a delta
+    delay(100);
+    memcpy(history[frames + 1], history[frames], SIZE);
+    mirror.update(history[frames]);
+    delay(100);
+
+    done = true;
+    reader.join();
+
+    printf("%u frames, %u messages, %u skipped busy, %llu bytes, slowest update %lldus\n",
+        mirror.frames, mirror.messages, mirror.frames_busy, (unsigned long long)received, (long long)slowest);
+    printf("decoded %u frames, %u lost, %u errors\n", decoder.frames, decoder.lost, decoder.errors);
+
+    CHECK(received == mirror.bytes + 9);
+    CHECK(decoder.frames == mirror.messages);
+    CHECK(decoder.lost == 0);
+    CHECK(decoder.errors > 0);
+    CHECK(mismatches == 0);
+    CHECK(decoder.synced);
+    CHECK(decoder.info.frame == mirror.frames);
+    CHECK(memcmp(decoder.frame, history[frames], SIZE) == 0);
+    CHECK(decoder.width() == 128 && decoder.height() == 128);
+
+    // A corrupted message is dropped
+    {
+        static Decoder fresh;
+        const size_t length = mirror.encode(history[frames], true);
+        CHECK(length > 0);
+        Mirror::put16(mirror.message + length - 2, Mirror::fletcher16(mirror.message + 4, length - 6));
+        CHECK(fresh.feed(mirror.message, length) == 1);
+
+        mirror.message[length / 2] ^= 0x40;
+        CHECK(fresh.feed(mirror.message, length) == 0);
+        CHECK(fresh.errors > 0);
+    }
+
+    uart_driver_delete(MirrorUart::PORT);
+    close(device);
+    close(host);
+
+    return test_result();
+}
@@ -0,0 +1,193 @@
+#include "ui_list.h"
+#include "ui_scroll.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+    A scroll container draws its children through its viewport. After a
+    scroll it moves what is drawn and repaints only the strip that came
+    into view, and every frame must match the container drawn from scratch.
+    Checked on a row major frame and on a paged frame, with the viewport on
+    and off page boundaries and a list scrolling inside the container.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+// A numbered box, counts the rows it was asked to paint
+template<typename Buffer>
+struct ElementBlockT : public ElementBaseT<Buffer> {
+    int number = 0;
+    int painted = 0;
+
+    ElementBlockT(Buffer &buffer):ElementBaseT<Buffer>(buffer) {}
+
+    void on_draw(Event *event) override {
+        if (!(event->value & Event::REDRAW))
+            return;
+
+        const Size &box = *this;
+        const fb top = box.y > this->buffer.getClipTop() ? box.y : this->buffer.getClipTop();
+        const fb bottom = box.getBottom() < this->buffer.getClipBottom() ? box.getBottom() : this->buffer.getClipBottom();
+        if (bottom > top)
+            painted += bottom - top;
+
+        char text[8];
+        snprintf(text, sizeof(text), "%i", number);
+        this->buffer.border(box, 1);
+        this->draw_text(text, Sprites::minifont, Origin(2, 2));
+        this->buffer.fill(Size(box.x + 20, box.y + 3, number * 7 % 90 + 1, box.height - 6), 1);
+    }
+};
+
+template<typename Buffer>
+struct NumberSource : public IListSourceT<Buffer> {
+    uu count() override {
+        return 50;
+    }
+
+    fb row_height() override {
+        return 8;
+    }
+
+    void render(ListRowT<Buffer> &row, const uu &index) override {
+        char text[8];
+        snprintf(text, sizeof(text), "%u", unsigned(index));
+        row.draw_text(text, Sprites::minifont);
+    }
+};
+
+template<typename Frame>
+struct Scene {
+    using Block = ElementBlockT<Frame>;
+
+    static constexpr int BLOCKS = 8;
+
+    Frame frame, reference;
+    ElementRootT<Frame> root;
+    ElementBaseT<Frame> header;
+    ScreenBaseT<> screen { "Scroll" }, above { "Above" };
+    ElementScrollT<Frame> scroller;
+    Block blocks[BLOCKS] { Block(frame), Block(frame), Block(frame), Block(frame), Block(frame), Block(frame), Block(frame), Block(frame) };
+    NumberSource<Frame> source;
+    ElementListT<Frame> list;
+
+    Scene(const fb &header_height, const fb &height):root(frame),header(frame),scroller(frame),list(frame, source) {
+        root << StyleInfo { .width = { 128 }, .height = { 128 } };
+        header << StyleInfo { .width = { 128 }, .height = { header_height } };
+        scroller << StyleInfo { .width = { 128 }, .height = { height }, .overflow = { AUTO } };
+        for (int i = 0; i < BLOCKS; i++) {
+            blocks[i].number = i;
+            blocks[i] << StyleInfo { .width = { 120 }, .height = { fb(16 + i % 3 * 5) }, .margin = { 2 } };
+            scroller << blocks[i];
+        }
+        list << StyleInfo { .width = { 120 }, .height = { 40 } };
+        scroller << list;
+        root.set_header(header);
+        screen << scroller;
+        screen.set_up(above);
+        root.set_screen(screen);
+    }
+
+    void press(const Event::Value &direction) {
+        ::press(root, direction);
+    }
+
+    int painted() {
+        int rows = 0;
+        for (Block &block : blocks)
+            rows += block.painted;
+        return rows;
+    }
+
+    // Block rows painted by the next frame, which must match a full repaint
+    int frame_painted() {
+        const int before = painted();
+        root.once();
+        const int rows = painted() - before;
+
+        memcpy(reference.buffer, frame.buffer, sizeof(frame.buffer));
+        root.layout_dirty = true;
+        root.once();
+        CHECK(memcmp(reference.buffer, frame.buffer, sizeof(frame.buffer)) == 0);
+
+        return rows;
+    }
+
+    void run(const char *name) {
+        root.layout_dirty = true;
+        root.once();
+
+        const fb view = scroller.getViewport().height;
+        const fb last = scroller.getLastScroll();
+        CHECK(last > view);
+
+        // Idle frames paint nothing, a scroll paints the strip it uncovered
+        CHECK(frame_painted() == 0);
+        scroller.scroll_by(4);
+        const int strip = frame_painted();
+        CHECK(strip > 0 && strip <= 4);
+        scroller.scroll_by(9);
+        CHECK(frame_painted() <= 9 + 4);
+        scroller.scroll_by(-5);
+        CHECK(frame_painted() <= 5 + 4);
+
+        // A jump past the viewport paints it all
+        scroller.scroll_by(view);
+        CHECK(frame_painted() > view / 2);
+
+        // Scrolling the list inside moves its rows within the clip
+        scroller.scroll_to(last);
+        frame_painted();
+        list.scroll_by(3);
+        frame_painted();
+        scroller.scroll_by(-3);
+        frame_painted();
+        list.scroll_by(-1);
+        frame_painted();
+
+        const int64_t start = micros();
+        scroller.scroll_to(0);
+        root.once();
+        for (fb i = 0; i < last; i++) {
+            scroller.scroll_by(1);
+            root.once();
+        }
+        const int64_t scroll_us = micros() - start;
+
+        // The DPAD goes to the list first, then scrolls by a step, and switches screens only from the top
+        scroller.scroll_to(0);
+        list.scroll_to(source.count());
+        frame_painted();
+        press(Event::DPAD_DOWN);
+        CHECK(scroller.scroll == scroller.step && root.active_screen == &screen);
+        CHECK(frame_painted() <= scroller.step);
+        press(Event::DPAD_UP);
+        // Five rows of the list in view
+        CHECK(scroller.scroll == scroller.step && list.top == 44);
+        list.scroll_to(0);
+        press(Event::DPAD_UP);
+        CHECK(scroller.scroll == 0 && root.active_screen == &screen);
+        frame_painted();
+        press(Event::DPAD_UP);
+        CHECK(root.active_screen == &above);
+        root.set_screen(screen);
+        root.once();
+
+        printf("%-10s %3u of %3u rows in view, %u scrolls %lldus\n", name, unsigned(view), unsigned(scroller.getContentHeight()), unsigned(last), (long long)scroll_us);
+    }
+};
+
+Scene<TextureT<ClippedT<FramebufferT<StaticbufferT<128, 128, 1>>>>> rowmajor(16, 96);
+Scene<TextureT<ClippedT<PagedFrame>>> paged(16, 96), unaligned(12, 90);
+
+int main() {
+    rowmajor.run("row major");
+    paged.run("paged");
+    unaligned.run("unaligned");
+
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,124 @@
+#include "segment_log.h"
+#include "fileblockdevice.h"
+#include "check.h"
+#include <stdio.h>
+#include <unistd.h>
+
+using namespace wbl;
+
+using Device = FileBlockDevice;
+using SegmentLog = SegmentLogT<Device>;
+
+static const char *image_path = "segment_log_test.img";
+static const uint32_t image_blocks = 2048;
+
+void print_stats(const char *name, const SegmentLog &log, const int64_t &elapsed_us) {
+    const SegmentLog::Stats &s = log.stats;
+    printf("%s:\n", name);
+    printf("  pages %u, flushes %u, dropped %u, errors %u\n", s.pages, s.flushes, s.dropped, s.errors);
+    printf("  throughput %.2f MB/s (%.0f points/s)\n",
+        s.bytes / (elapsed_us * 1e-6) / 1e6, s.pages * SegmentLog::POINTS_PER_PAGE / (elapsed_us * 1e-6));
+    printf("  flush latency avg %.1fus max %lldus\n",
+        s.flushes ? float(s.flush_us_total) / s.flushes : 0.0f, (long long)s.flush_us_max);
+}
+
+/*
+    Writes points as fast as possible, flushing every PAGE_BUFFERS-1 pages
+*/
+void sustained(Device &device, const char *name, const int &points) {
+    SegmentLog log(device, 0, image_blocks);
+    CHECK(log.recover() == ESP_OK);
+
+    const int64_t start = micros();
+    for (int i = 0; i < points; i++) {
+        log.push_back(i * 1000, i & 0xfff);
+        if (log.queued - log.flushed >= SDLOG_PAGE_BUFFERS - 1)
+            CHECK(log.flush() == ESP_OK);
+    }
+    CHECK(log.sync() == ESP_OK);
+
+    print_stats(name, log, micros() - start);
+    CHECK(log.stats.dropped == 0);
+}
+
+int main() {
+    unlink(image_path);
+
+    Device device(image_path, image_blocks);
+    CHECK(device.init() == ESP_OK);
+
+    const int points = SegmentLog::POINTS_PER_PAGE * image_blocks * 3 / 2;
+
+    // Wraps the ring once
+    sustained(device, "buffered", points);
+
+    SegmentLog log(device, 0, image_blocks);
+    CHECK(log.recover() == ESP_OK);
+    const uint32_t sequence = log.sequence;
+    printf("recovered sequence %u, last index page %u\n", sequence, log.last_index_page);
+
+    // A log needs a block range that fits the device
+    SegmentLog unreserved(device, 0, 0), oversized(device, 1, image_blocks);
+    CHECK(unreserved.recover() == ESP_ERR_INVALID_ARG);
+    CHECK(unreserved.start() == ESP_ERR_INVALID_ARG);
+    CHECK(oversized.recover() == ESP_ERR_INVALID_SIZE);
+
+    // Recovering a second time finds the same head
+    SegmentLog again(device, 0, image_blocks);
+    CHECK(again.recover() == ESP_OK);
+    CHECK(again.sequence == sequence);
+
+    // Tear the newest page, recovery falls back to the page before it
+    SegmentLog::Page page;
+    CHECK(log.read_page(log.page_of(sequence - 1), page) == ESP_OK);
+    page.payload[7] ^= 0x5a;
+    CHECK(device.write_blocks(log.page_of(sequence - 1), &page, 1) == ESP_OK);
+
+    SegmentLog torn(device, 0, image_blocks);
+    CHECK(torn.recover() == ESP_OK);
+    CHECK(torn.sequence == sequence - 1);
+
+    // Index lookup lands on a data page at or before the time
+    const SegmentLog::time_type time = (points - 5000) * 1000;
+    const uint32_t found = torn.find_page(time);
+    CHECK(found != SegmentLog::NO_PAGE);
+    if (found != SegmentLog::NO_PAGE) {
+        CHECK(torn.read_valid(found, page));
+        CHECK(page.header.type == SegmentLog::PAGE_DATA);
+        CHECK(page.header.time_first <= time);
+    }
+
+    // New points continue after the torn page
+    torn.push_back(points * 1000, 1);
+    CHECK(torn.sync() == ESP_OK);
+    CHECK(torn.read_valid(torn.page_of(sequence - 1), page));
+
+    // The flush task keeps up with a steady producer
+    SegmentLog tasked(device, 0, image_blocks);
+    CHECK(tasked.recover() == ESP_OK);
+    CHECK(tasked.start(1) == ESP_OK);
+    const int64_t start = micros();
+    for (int i = 0; i < 20000; i++) {
+        tasked.push_back(i * 1000, i);
+        if (i % 16 == 0)
+            delay(1);
+    }
+    CHECK(tasked.stop() == ESP_OK);
+    print_stats("flush task", tasked, micros() - start);
+    CHECK(tasked.stats.dropped == 0);
+    CHECK(!tasked.task);
+
+    // Points pushed just before a clean stop reach the device, down to the last
+    SegmentLog reopened(device, 0, image_blocks);
+    CHECK(reopened.recover() == ESP_OK);
+    CHECK(reopened.sequence == tasked.sequence);
+    CHECK(reopened.read_valid(reopened.page_of(reopened.sequence - 1), page));
+    CHECK(page.header.type == SegmentLog::PAGE_DATA && page.points()[page.header.count - 1].time == 19999 * 1000);
+
+    device.sync_writes = true;
+    sustained(device, "buffered fdatasync", points / 8);
+
+    unlink(image_path);
+
+    return test_result();
+}
@@ -0,0 +1,193 @@
+#include "../../display/displaybuffer.h"
+#include "sh1107_model.h"
+#include "wbl_func.h"
+#include "check.h"
+#include <stdio.h>
+
+using namespace wbl;
+
+SH1107Model model;
+DisplayBuffer display;
+
+int mismatches() {
+    int bad = 0;
+    for (int y = 0; y < GME128128::HEIGHT; y++)
+        for (int x = 0; x < GME128128::WIDTH; x++)
+            bad += model.pixel(x, y) != bool(display.getPixel(x, y));
+    return bad;
+}
+
+// GRAM byte for byte against a frame, independent of remap and start line
+int gram_mismatches(const uint8_t *frame) {
+    int bad = 0;
+    for (int page = 0; page < GME128128::PAGES; page++)
+        for (int x = 0; x < GME128128::WIDTH; x++)
+            bad += model.gram[page][x] != frame[page * GME128128::BYTES_PER_PAGE + x];
+    return bad;
+}
+
+void wait_flush() {
+    while (display.flush_busy())
+        delay(1);
+}
+
+void print_stats(const char *name, const int64_t &elapsed_us) {
+    const EmuI2CStats stats = emu_i2c_stats(I2C_NUM_0);
+    printf("%s: %u transactions, %llu bytes, %.0fus on the bus at %u Hz, %lldus host\n",
+        name, stats.transactions, (unsigned long long)stats.bytes, stats.bus_us, I2C_DISPLAY_FREQ, (long long)elapsed_us);
+}
+
+int main() {
+    CHECK(emu_i2c_attach(I2C_NUM_0, I2C_SH1107_ADDR, &model) == ESP_OK);
+    CHECK(display.init() == ESP_OK);
+
+    CHECK(model.on);
+    CHECK(model.contrast == 0x7f);
+    CHECK(model.unknown_commands == 0);
+    CHECK(mismatches() == 0);
+
+    for (int y = 0; y < GME128128::HEIGHT; y++)
+        for (int x = 0; x < GME128128::WIDTH; x++)
+            display.putPixel(x, y, (x * 7 + y * 3) % 5 == 0);
+
+    // Blocking flush, used before the arbiter runs
+    DisplayBuffer::arbiter().stop();
+    while (DisplayBuffer::arbiter().task)
+        delay(10);
+
+    emu_i2c_reset_stats(I2C_NUM_0);
+    int64_t start = micros();
+    CHECK(display.flush() == ESP_OK);
+    print_stats("blocking flush", micros() - start);
+    CHECK(mismatches() == 0);
+    CHECK(emu_i2c_stats(I2C_NUM_0).transactions == 80);
+    CHECK(emu_i2c_stats(I2C_NUM_0).bytes == 2176);
+
+    // Queued flush through the arbiter
+    CHECK(DisplayBuffer::arbiter().start() == ESP_OK);
+    memset(model.gram, 0, sizeof(model.gram));
+    emu_i2c_reset_stats(I2C_NUM_0);
+    start = micros();
+    CHECK(display.flush() == ESP_OK);
+    const int64_t queued_us = micros() - start;
+    wait_flush();
+    print_stats("queued flush", micros() - start);
+    printf("queued flush returned after %lldus\n", (long long)queued_us);
+    CHECK(mismatches() == 0);
+    CHECK(gram_mismatches(display.buffer) == 0);
+    CHECK(emu_i2c_stats(I2C_NUM_0).transactions == 32);
+    CHECK(emu_i2c_stats(I2C_NUM_0).bytes == 2128);
+
+    // A second frame while the first is on the bus is skipped, the bus is held so the first cannot finish
+    uint8_t first[sizeof(display.buffer)];
+    display.putPixel(0, 0, !display.getPixel(0, 0));
+    memcpy(first, display.buffer, sizeof(first));
+    CHECK(DisplayBuffer::arbiter().acquire() == ESP_OK);
+    CHECK(display.flush() == ESP_OK);
+    CHECK(display.flush_busy());
+    display.putPixel(1, 0, !display.getPixel(1, 0));
+    CHECK(display.flush() == ESP_OK);
+    DisplayBuffer::arbiter().release();
+    wait_flush();
+    CHECK(display.frames_skipped == 1);
+    CHECK(gram_mismatches(first) == 0);
+
+    // The skipped change goes out with the next frame
+    CHECK(display.flush() == ESP_OK);
+    wait_flush();
+    CHECK(display.frames_skipped == 1);
+    CHECK(gram_mismatches(display.buffer) == 0);
+    CHECK(mismatches() == 0);
+
+    // A scroll sends the pages it brings into view and moves the start line after them
+    for (int y = 0; y < 16; y++)
+        for (int x = 0; x < GME128128::WIDTH; x++)
+            display.putPixel(x, y, (x + y) % 3 == 0);
+    emu_i2c_reset_stats(I2C_NUM_0);
+    start = micros();
+    CHECK(display.flush_scroll(0, 2, 16) == ESP_OK);
+    wait_flush();
+    print_stats("scroll", micros() - start);
+    CHECK(model.start_line == 16);
+    CHECK(emu_i2c_stats(I2C_NUM_0).transactions == 5);
+    CHECK(emu_i2c_stats(I2C_NUM_0).bytes == 2 * 133 + 3);
+
+    int scrolled = 0;
+    for (int y = 0; y < GME128128::HEIGHT; y++)
+        for (int x = 0; x < GME128128::WIDTH; x++)
+            scrolled += model.pixel(x, y) != bool(display.getPixel(x, (y + 16) % GME128128::HEIGHT));
+    CHECK(scrolled == 0);
+    CHECK(gram_mismatches(display.buffer) == 0);
+
+    CHECK(display.flush_scroll(0, 0, 0) == ESP_OK);
+    wait_flush();
+    CHECK(model.start_line == 0);
+    CHECK(mismatches() == 0);
+    CHECK(gram_mismatches(display.buffer) == 0);
+
+    // Controls queue behind a frame still on the bus instead of cutting in
+    CHECK(display.flush() == ESP_OK);
+    CHECK(display.setContrast(0x40) == ESP_OK);
+    while (display.flush_busy() || display.control_busy())
+        delay(1);
+    CHECK(model.contrast == 0x40);
+    CHECK(mismatches() == 0);
+    CHECK(gram_mismatches(display.buffer) == 0);
+    CHECK(display.frames_skipped == 1);
+
+    // The rest of the controls queue too, the UI task never waits on the bus
+    CHECK(display.setOrientation(GME128128::FLIP_VERTICAL | GME128128::FLIP_HORIZONTAL) == ESP_OK);
+    CHECK(display.setInverted(true) == ESP_OK);
+    CHECK(display.setStartLine(8) == ESP_OK);
+    while (display.control_busy())
+        delay(1);
+    CHECK(model.remap && model.scan_reverse);
+    CHECK(model.inverted);
+    CHECK(model.start_line == 8);
+
+    CHECK(display.setStartLine(0) == ESP_OK);
+    CHECK(display.setInverted(false) == ESP_OK);
+    while (display.control_busy())
+        delay(1);
+    CHECK(model.pixel(0, 0) == bool(display.getPixel(127, 127)));
+
+    CHECK(display.setState(false) == ESP_OK);
+    while (display.control_busy())
+        delay(1);
+    CHECK(!model.on);
+    CHECK(model.unknown_commands == 0);
+
+    // A transfer that times out in the queue is taken out of it, the caller's copy may go
+    I2CArbiter &arbiter = DisplayBuffer::arbiter();
+    const uint8_t on[] = { 0x00, SH1107::ON }, dim[] = { 0x00, SH1107::SET_CONTRAST, 0x10 };
+    I2CTransaction taken;
+    taken.dev = display.dev;
+    taken.write_data = on;
+    taken.write_size = sizeof(on);
+    CHECK(arbiter.acquire() == ESP_OK);
+    CHECK(arbiter.submit(taken) == ESP_OK);
+    // Taken by the arbiter, which now waits for the bus
+    while (uxQueueMessagesWaiting(arbiter.queues[taken.priority]))
+        delay(1);
+    {
+        I2CTransaction stuck;
+        stuck.dev = display.dev;
+        stuck.write_data = dim;
+        stuck.write_size = sizeof(dim);
+        CHECK(arbiter.transfer(stuck, 20 / portTICK_PERIOD_MS) == ESP_ERR_TIMEOUT);
+        CHECK(!stuck.busy() && !stuck.done());
+        CHECK(uxQueueMessagesWaiting(arbiter.queues[stuck.priority]) == 0);
+    }
+    arbiter.release();
+    while (taken.busy())
+        delay(1);
+    CHECK(taken.result == ESP_OK && model.on);
+    delay(20);
+    CHECK(model.contrast == 0x40);
+
+    const I2CArbiter::Stats &stats = DisplayBuffer::arbiter().stats;
+    printf("arbiter: %u completed, %u errors, display queue avg %.0fus max %lldus, utilization %.2f\n",
+        stats.completed, stats.errors, stats.queue_us_avg(I2C_PRIORITY_DISPLAY), (long long)stats.queue_us_max[I2C_PRIORITY_DISPLAY], stats.utilization(esp_timer_get_time()));
+
+    return test_result();
+}
@@ -0,0 +1,77 @@
+#include "shm_framebuffer.h"
+#include "check.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+#include <chrono>
+
+using namespace wbl;
+
+static const char *path = "shm_test.fb";
+static const int frames = 200000;
+static const int size = 128 * 128 / 8;
+
+int main() {
+    SharedFramebuffer writer, reader;
+
+    CHECK(reader.attach(path) == ESP_ERR_NOT_FOUND);
+    CHECK(writer.create(path, 128, 128, 1) == ESP_OK);
+    CHECK(writer.create(path, 128, 128, 1) == ESP_ERR_INVALID_STATE);
+
+    // A separate mapping, like a viewer in another process
+    CHECK(reader.attach(path) == ESP_OK);
+    CHECK(reader.header->width == 128 && reader.header->height == 128 && reader.header->bpp == 1);
+    CHECK(reader.header->stride == 16 && reader.header->size == size);
+
+    static uint8_t frame[size], copy[size];
+    CHECK(!reader.read(copy));
+
+    std::atomic<bool> done(false);
+    int reads = 0, torn = 0, backwards = 0;
+
+    // Every byte of a frame holds its frame number, a torn copy mixes two
+    std::thread viewer([&]() {
+        uint64_t last = 0;
+        while (!done) {
+            uint64_t f;
+            int64_t t;
+            if (!reader.read(copy, &f, &t))
+                continue;
+            reads++;
+            for (int i = 0; i < size; i++)
+                if (copy[i] != uint8_t(f)) {
+                    torn++;
+                    break;
+                }
+            if (t != int64_t(f) * 10)
+                torn++;
+            if (f < last)
+                backwards++;
+            last = f;
+        }
+    });
+
+    const auto start = std::chrono::steady_clock::now();
+    for (int i = 1; i <= frames; i++) {
+        memset(frame, uint8_t(i), size);
+        writer.publish(frame, int64_t(i) * 10);
+    }
+    const double elapsed = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    done = true;
+    viewer.join();
+
+    uint64_t f;
+    CHECK(reader.read(copy, &f));
+    CHECK(f == frames);
+    CHECK(torn == 0);
+    CHECK(backwards == 0);
+
+    printf("%i frames published, %.2fus each, %i consistent reads\n", frames, elapsed / frames, reads);
+
+    writer.close();
+    reader.close();
+    remove(path);
+
+    return test_result();
+}
@@ -0,0 +1,79 @@
+#include "spsc_buffer.h"
+#include "check.h"
+#include <stdio.h>
+#include <atomic>
+#include <thread>
+
+using namespace wbl;
+
+using Point = DataPointT<int, uint32_t>;
+using Buffer = SPSCLoopBufferT<Point>;
+using Log = DataLogT<Point, Buffer>;
+
+static const int total = 1000000;
+
+// Any torn or reordered point breaks the time/value pairing
+constexpr inline uint32_t value_of(const int &time) {
+    return uint32_t(time) * 2654435761u;
+}
+
+int main() {
+    static Buffer buffer;
+    Log log(buffer);
+
+    std::atomic<bool> done(false);
+
+    std::thread producer([&]() {
+        // A full queue drops the point, retry so every point is accounted for
+        for (int i = 1; i <= total; i++)
+            while (!buffer.push_back(Point(i, value_of(i))))
+                std::this_thread::yield();
+        done.store(true, std::memory_order_release);
+    });
+
+    int received = 0, snapshots = 0, last_time = 0;
+
+    const auto consume = [&]() {
+        const int count = log.snapshot();
+        received += count;
+        snapshots++;
+
+        if (!count) {
+            std::this_thread::yield();
+            return;
+        }
+
+        // Every point in history stays ordered and untorn
+        for (int i = 0; i < log.size(); i++) {
+            const Point &p = log.get(i);
+            if (p.value != value_of(p.time) || (i && log.get(i - 1).time >= p.time)) {
+                failures++;
+                break;
+            }
+        }
+
+        if (log.size()) {
+            const int end = log.get(-1).time;
+            CHECK(end == last_time + count);
+            CHECK(log.get(log.binary_index(end)).time == end);
+            last_time = end;
+        }
+    };
+
+    while (!done.load(std::memory_order_acquire))
+        consume();
+
+    consume();
+
+    producer.join();
+
+    const uint32_t dropped = buffer.dropped.load();
+
+    printf("received %i, full queue retries %u, snapshots %i\n", received, dropped, snapshots);
+
+    CHECK(buffer.pending() == 0);
+    CHECK(received == total);
+    CHECK(last_time == total);
+
+    return test_result();
+}
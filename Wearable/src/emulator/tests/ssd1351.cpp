@@ -0,0 +1,140 @@
+#include "../../display/ssd1351_buffer.h"
+#include "texture.h"
+#include "ssd1351_model.h"
+#include "wbl_func.h"
+#include "check.h"
+#include <stdio.h>
+
+using namespace wbl;
+
+using Display565 = TextureT<SSD1351Buffer>;
+using Display332 = TextureT<SSD1351BufferT<OLED128128RGB, ColorFramebufferT<ColorbufferT<128, 128, FormatRGB332>>>>;
+using DisplayMono = TextureT<SSD1351BufferT<OLED128128RGB, FramebufferT<StaticbufferT<128, 128, 1>>>>;
+using Icon = TextureT<FramebufferT<StaticbufferT<16, 16, 1>>>;
+
+SSD1351Model model(SPI_SSD1351::DC);
+Display565 display565;
+Display332 display332;
+DisplayMono displaymono;
+Icon icon;
+
+template<typename Display, typename TO565>
+int mismatches(const Display &display, TO565 to565) {
+    int bad = 0;
+    for (int y = 0; y < OLED128128RGB::HEIGHT; y++)
+        for (int x = 0; x < OLED128128RGB::WIDTH; x++)
+            bad += model.pixel(x, y) != to565(display, x, y);
+    return bad;
+}
+
+template<typename Display>
+void draw(Display &display) {
+    display.clear(0);
+    display.fill(10, 10, 60, 40, 2);
+    display.circle(Origin(90, 30), 20, 3);
+    display.line(Origin(0, 127), Origin(127, 60), 1);
+    display.vspan(5, 50, 120, 2);
+    display.putTexture(icon, Size(0, 0, 16, 16), Origin(100, 100));
+}
+
+template<typename Display>
+void print_stats(const char *name, Display &display) {
+    emu_spi_reset_stats(SPI2_HOST);
+    const int64_t start = micros();
+    CHECK(display.flush() == ESP_OK);
+    const int64_t elapsed = micros() - start;
+
+    const EmuSPIStats stats = emu_spi_stats(SPI2_HOST);
+    printf("%s: %u transactions (%u queued), %llu bytes, %.0fus on the bus at %u Hz, %lldus host\n",
+        name, stats.transactions, stats.queued, (unsigned long long)stats.bytes, stats.bus_us, SPI_DISPLAY_FREQ, (long long)elapsed);
+
+    // Window and write commands, then one transfer per chunk
+    CHECK(stats.queued == OLED128128RGB::HEIGHT / SSD1351_CHUNK_ROWS);
+    CHECK(stats.bytes == 128 * 128 * 2 + 7);
+}
+
+int main() {
+    CHECK(emu_spi_attach(SPI2_HOST, 40, &model) == ESP_OK);
+
+    for (int y = 0; y < 16; y++)
+        for (int x = 0; x < 16; x++)
+            icon.putPixel(x, y, (x ^ y) & 1);
+
+    // RGB565, rows go out as stored
+    CHECK(display565.init() == ESP_OK);
+    CHECK(model.on);
+    CHECK(model.unknown_commands == 0);
+    CHECK(model.remap == SSD1351::REMAP_DEFAULT);
+
+    display565.palette.set(2, 0xF800);
+    display565.palette.set(3, 0x07FF);
+    draw(display565);
+    CHECK(display565.getPixel(20, 20) == 2);
+    CHECK(display565.getPixel(5, 100) == 2);
+    CHECK(display565.getPixel(101, 100) == 1);
+    CHECK(display565.getPixel(100, 100) == 0);
+    print_stats("rgb565 flush", display565);
+
+    auto color565 = [](const Display565 &d, const int &x, const int &y) { return FormatRGB565::to565(d.getColor(x, y)); };
+    CHECK(mismatches(display565, color565) == 0);
+    CHECK(model.pixel(20, 20) == 0xF800);
+
+    // The colour kernels match drawing pixel by pixel
+    {
+        static Display565 reference, kernel;
+        reference.palette = kernel.palette = display565.palette;
+
+        for (int y = 0; y < 128; y++)
+            for (int x = 0; x < 128; x++)
+                reference.putPixel(x, y, (x >= 10 && x < 60 && y >= 10 && y < 40) ? 2 : 0);
+
+        kernel.clear(0);
+        kernel.fill(10, 10, 60, 40, 2);
+        CHECK(memcmp(reference.buffer, kernel.buffer, sizeof(kernel.buffer)) == 0);
+    }
+
+    // RGB332 through the lookup table
+    CHECK(display332.init() == ESP_OK);
+    display332.palette.set(2, 0xF800);
+    display332.palette.set(3, 0x07FF);
+    draw(display332);
+    print_stats("rgb332 flush", display332);
+
+    auto color332 = [](const Display332 &d, const int &x, const int &y) { return FormatRGB332::to565(d.getColor(x, y)); };
+    CHECK(mismatches(display332, color332) == 0);
+    CHECK(model.pixel(20, 20) == 0xF800);
+
+    // 1bpp frames are expanded through mono_palette
+    CHECK(displaymono.init() == ESP_OK);
+    displaymono.mono_palette.set(1, 0x07E0);
+    draw(displaymono);
+    print_stats("mono flush", displaymono);
+
+    auto colormono = [](const DisplayMono &d, const int &x, const int &y) { return d.getPixel(x, y) ? uint16_t(0x07E0) : uint16_t(0); };
+    CHECK(mismatches(displaymono, colormono) == 0);
+
+    // Partial update, only the band's rows change
+    const uint16_t below = model.pixel(0, 72);
+    display565.fill(0, 64, 128, 72, 3);
+    display565.fill(0, 72, 128, 80, 2);
+    CHECK(display565.write_rows(64, 8) == ESP_OK);
+    CHECK(display565.wait_all() == ESP_OK);
+    CHECK(model.pixel(0, 64) == 0x07FF);
+    CHECK(model.pixel(0, 72) == below);
+
+    CHECK(display565.setContrast(0x40) == ESP_OK);
+    CHECK(model.master_contrast == 0x04);
+
+    const uint16_t upright = model.pixel(20, 20);
+    CHECK(display565.setOrientation(OLED128128RGB::FLIP_VERTICAL) == ESP_OK);
+    CHECK(model.pixel(127 - 20, 20) == upright);
+    CHECK(display565.flush() == ESP_OK);
+    CHECK(model.pixel(127 - 20, 20) == 0xF800);
+    CHECK(display565.setOrientation() == ESP_OK);
+
+    CHECK(display565.setState(false) == ESP_OK);
+    CHECK(!model.on);
+    CHECK(model.pixel(20, 20) == 0);
+
+    return test_result();
+}
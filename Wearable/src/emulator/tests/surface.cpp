@@ -0,0 +1,159 @@
+#include "surface.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+
+/*
+    Draws the same trees with plain and retained elements, the frames must
+    match while the retained ones render only when their content changes.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+using Frame = TextureT<FramebufferT<StaticbufferT<128, 128, 1>>>;
+using Surface = SurfaceTextureT<Frame>;
+
+template<typename Counter>
+struct Scene {
+    ElementRootT<Frame> root;
+    ScreenBaseT<> screen { "Surface" };
+    ElementBaseT<Frame> spacer;
+    Counter first, second;
+
+    template<typename ...Args>
+    Scene(Frame &frame, Args&... args):root(frame),spacer(frame),first(frame, args...),second(frame, args...) {
+        spacer << StyleInfo { .width = { 128 }, .height = { 0 } };
+        first << StyleInfo { .width = { 40 }, .height = { 40 } };
+        second << StyleInfo { .width = { 40 }, .height = { 40 } };
+        screen << spacer;
+        screen << first;
+        screen << second;
+        root.set_screen(screen);
+    }
+
+    void draw(const bool &dirty = false) {
+        root.layout_dirty = dirty;
+        root.redraw_needed = true;
+        root.once();
+    }
+};
+
+Frame plain, retained, evicting;
+SurfacePoolT<> pool;
+SurfacePoolT<300, 4> small_pool;
+Scene<ElementCounterT<Frame>> plainscene(plain);
+Scene<RetainedT<Frame, ElementCounterT<Surface>>> retainedscene(retained, pool);
+Scene<RetainedT<Frame, ElementCounterT<Surface>>> evictingscene(evicting, small_pool);
+
+void draw_all(const bool &dirty = false) {
+    plainscene.draw(dirty);
+    retainedscene.draw(dirty);
+    evictingscene.draw(dirty);
+}
+
+int main() {
+    // Pool, least recently used surfaces go first and their handles go stale
+    {
+        SurfacePoolT<100, 4> p;
+        SurfaceHandle a, b, c;
+        CHECK(p.acquire(40, a) == p.memory);
+        CHECK(p.acquire(40, b) == p.memory + 40);
+        CHECK(p.get(a));
+        CHECK(p.acquire(40, c) == p.memory + 40);
+        CHECK(!p.get(b));
+        CHECK(p.get(a) == p.memory);
+        CHECK(p.stats.evicted == 1);
+
+        SurfaceHandle big;
+        CHECK(!p.acquire(101, big));
+        CHECK(p.stats.failed == 1);
+
+        p.release(a);
+        CHECK(!p.get(a));
+        CHECK(p.acquire(30, a) == p.memory);
+    }
+
+    draw_all(true);
+    CHECK(compare(plain, retained) == 0);
+    CHECK(compare(plain, evicting) == 0);
+    CHECK(retainedscene.first.renders == 1);
+
+    // Damage under the elements is repaired from the surfaces
+    for (int i = 0; i < 4; i++) {
+        plain.fill(0, 0, 128, 64, 1);
+        retained.fill(0, 0, 128, 64, 1);
+        evicting.fill(0, 0, 128, 64, 1);
+        draw_all();
+    }
+    CHECK(compare(plain, retained) == 0);
+    CHECK(compare(plain, evicting) == 0);
+    CHECK(retainedscene.first.renders == 1);
+    CHECK(plainscene.first.renders == 5);
+
+    // Content changes render again
+    plainscene.second.value = retainedscene.second.value = evictingscene.second.value = 6;
+    draw_all();
+    CHECK(compare(plain, retained) == 0);
+    CHECK(compare(plain, evicting) == 0);
+    CHECK(retainedscene.second.renders == 2);
+
+    // Layout moves blit at the new position without rendering
+    plainscene.spacer << StyleInfo { .width = { 128 }, .height = { 24 } };
+    retainedscene.spacer << StyleInfo { .width = { 128 }, .height = { 24 } };
+    evictingscene.spacer << StyleInfo { .width = { 128 }, .height = { 24 } };
+    draw_all(true);
+    CHECK(retainedscene.first.getTop() == 24);
+    CHECK(compare(plain, retained) == 0);
+    CHECK(compare(plain, evicting) == 0);
+    CHECK(retainedscene.first.renders == 1);
+    CHECK(retainedscene.second.renders == 2);
+
+    // Two surfaces do not fit the small pool, they take turns
+    CHECK(small_pool.stats.evicted > 0);
+    CHECK(evictingscene.first.renders > 1);
+
+    printf("renders plain %i/%i, retained %i/%i, evicting %i/%i, %u evictions\n",
+        plainscene.first.renders, plainscene.second.renders,
+        retainedscene.first.renders, retainedscene.second.renders,
+        evictingscene.first.renders, evictingscene.second.renders, small_pool.stats.evicted);
+
+    // The clock matches its plain counterpart
+    {
+        static Frame plainclock, retainedclock;
+        static SurfacePoolT<> clockpool;
+        static ScreenClockT<Frame> clock(plainclock);
+        static RetainedT<Frame, ScreenClockT<Surface>> rclock(retainedclock, clockpool);
+        static ElementRootT<Frame> root(plainclock), rroot(retainedclock);
+        static ScreenBaseT<> screen { "Clock" }, rscreen { "Clock" };
+
+        clock << StyleInfo { .width = { 100 }, .height = { 100 } };
+        rclock << StyleInfo { .width = { 100 }, .height = { 100 } };
+        screen << clock;
+        rscreen << rclock;
+        root.set_screen(screen);
+        rroot.set_screen(rscreen);
+
+        int bad = 0;
+        for (int attempt = 0; attempt < 3; attempt++) {
+            const int64_t second = seconds();
+            root.layout_dirty = rroot.layout_dirty = true;
+            root.once();
+            rroot.once();
+            if (seconds() != second)
+                continue;
+
+            // The clock strays a pixel past its box, the surface crops that
+            bad = 0;
+            for (int y = 0; y < 100; y++)
+                for (int x = 0; x < 100; x++)
+                    bad += plainclock.getPixel(x, y) != retainedclock.getPixel(x, y);
+            break;
+        }
+        CHECK(bad == 0);
+        CHECK(rclock.getSurface().backed());
+    }
+
+    return test_result();
+}
@@ -0,0 +1,87 @@
+#include "emu_trace.h"
+#include "emu_clock.h"
+#include "user_inputs.h"
+#include "wbl_func.h"
+#include "gps.h"
+#include "check.h"
+#include <stdio.h>
+
+using namespace wbl;
+
+static const char *path = "trace_test.bin";
+
+int main() {
+    emu_clock_set_virtual(true);
+    emu_clock_set_frame_thread();
+    emu_clock_on_frame(emu_trace_poll);
+
+    CHECK(emu_trace_record(path) == ESP_OK);
+    CHECK(emu_trace_record(path) == ESP_ERR_INVALID_STATE);
+
+    int32_t values[3];
+    for (int i = 0; i < 100; i++) {
+        values[0] = 1500 + i * 3;
+        values[1] = -i;
+        values[2] = i & 1 ? 1 << 30 : -(1 << 30);
+        CHECK(emu_trace_sensor("waves", 3, values, ESP_OK) == ESP_OK);
+
+        values[0] = 4000 + i;
+        CHECK(emu_trace_sensor("volts", 1, values, i == 50 ? ESP_FAIL : ESP_OK) == (i == 50 ? ESP_FAIL : ESP_OK));
+
+        delay(10);
+    }
+
+    delay(100);
+    emu_trace_dpad(3, true);
+    emu_trace_dpad(3, false);
+    emu_trace_gps_fix(1700000000000000ll);
+    delay(200);
+    emu_trace_dpad(0, true);
+    emu_trace_dpad(0, false);
+
+    emu_trace_close();
+
+    FILE *f = fopen(path, "rb");
+    fseek(f, 0, SEEK_END);
+    printf("trace: %li bytes for 400 sensor values and 5 events\n", ftell(f));
+    fclose(f);
+
+    CHECK(emu_trace_replay(path) == ESP_OK);
+    CHECK(emu_trace_mode() == EMU_TRACE_REPLAY);
+
+    // Recorded reads come back in order, failed reads stay live
+    for (int i = 0; i < 100; i++) {
+        values[0] = values[1] = values[2] = 0;
+        CHECK(emu_trace_sensor("waves", 3, values, ESP_FAIL) == ESP_OK);
+        CHECK(values[0] == 1500 + i * 3);
+        CHECK(values[1] == -i);
+        CHECK(values[2] == (i & 1 ? 1 << 30 : -(1 << 30)));
+    }
+    for (int i = 0; i < 99; i++) {
+        CHECK(emu_trace_sensor("volts", 1, values, ESP_FAIL) == ESP_OK);
+        CHECK(values[0] == 4000 + (i < 50 ? i : i + 1));
+    }
+    CHECK(emu_trace_sensor("volts", 1, values, ESP_FAIL) == ESP_FAIL);
+    CHECK(emu_trace_sensor("other", 1, values, ESP_ERR_TIMEOUT) == ESP_ERR_TIMEOUT);
+
+    // Events arrive at the first frame boundary at or after their time
+    CHECK(getGPSTime() == -1);
+    delay(1000);
+    CHECK(!dpad.down.is_pressed());
+    delay(100);
+    CHECK(dpad.down.is_pressed() && dpad.down.is_released());
+    CHECK(!dpad.enter.is_pressed());
+    CHECK(getGPSTime() == 1700000000000000ll);
+    CHECK(getGPSTime() == -1);
+    dpad.update();
+    CHECK(!emu_trace_finished());
+    delay(200);
+    CHECK(dpad.enter.is_pressed());
+    CHECK(emu_trace_finished());
+
+    emu_trace_close();
+    CHECK(emu_trace_mode() == EMU_TRACE_OFF);
+    remove(path);
+
+    return test_result();
+}
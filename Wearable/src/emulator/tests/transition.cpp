@@ -0,0 +1,195 @@
+#include "transition.h"
+#include "wbl_func.h"
+#include "check.h"
+#include "scene.h"
+#include <stdio.h>
+#include <string.h>
+
+/*
+    Slides from a screen to each of its neighbours and back. Every animation
+    frame must show the expected mix of both screens and the last must match
+    the new screen drawn alone. Vertical slides on a frame with a start line
+    must send each page once and never the whole frame.
+*/
+
+using namespace wbl;
+using namespace UI;
+
+// Fills its box with a pattern picked by seed
+template<typename Buffer>
+struct ElementPatternT : public ElementBaseT<Buffer> {
+    int seed = 0;
+
+    ElementPatternT(Buffer &frame, const int &seed):ElementBaseT<Buffer>(frame),seed(seed) { }
+
+    void on_draw(Event *event) override {
+        if (!(event->value & Event::REDRAW))
+            return;
+
+        const Size &box = *this;
+        this->clear();
+        for (fb y = box.y; y < box.getBottom(); y++)
+            for (fb x = box.x; x < box.getRight(); x++)
+                this->buffer.putPixel(x, y, (x * (seed + 1) + y * (seed + 3)) % (seed + 5) == 0);
+        this->buffer.border(box, 1);
+    }
+};
+
+// A paged frame in front of GRAM with a display start line, like DisplayBufferT
+struct ScrollingFrame : public PagedFrame {
+    pixel gram[SIZE];
+    fb start_line = 0;
+    int flushes = 0, pages_sent = 0;
+
+    inline void flush() {
+        memcpy(gram, buffer, SIZE);
+        flushes++;
+    }
+
+    inline esp_err_t flush_scroll(const ub &first, const ub &count, const ub &line) {
+        for (ub i = 0; i < count; i++) {
+            const fb page = (first + i) % (HEIGHT / 8);
+            memcpy(&gram[page * WIDTH], &buffer[page * WIDTH], WIDTH);
+        }
+        pages_sent += count;
+        start_line = line;
+        return ESP_OK;
+    }
+
+    inline pixel getVisible(const fb &x, const fb &y) const {
+        const fb row = (y + start_line) % HEIGHT;
+        return (gram[(row / 8) * WIDTH + x] >> (row & 7)) & 1;
+    }
+};
+
+template<typename Buffer>
+pixel visible(const Buffer &frame, const fb &x, const fb &y) {
+    if constexpr (requires { frame.getVisible(x, y); })
+        return frame.getVisible(x, y);
+    else
+        return frame.getPixel(x, y);
+}
+
+template<typename Frame>
+struct Scene {
+    Frame frame, screens[5];
+    ElementRootT<Frame> root;
+    ScreenTransitionT<Frame> transition;
+    ScreenBaseT<> center { "Center" }, up { "Up" }, right { "Right" }, down { "Down" }, left { "Left" };
+    ElementPatternT<Frame> patterns[5] {
+        { frame, 0 }, { frame, 1 }, { frame, 2 }, { frame, 3 }, { frame, 4 }
+    };
+
+    IScreen *all[5] = { &center, &up, &right, &down, &left };
+
+    Scene():root(frame),transition(frame) {
+        root << StyleInfo { .width = { 128 }, .height = { 128 } };
+        for (int i = 0; i < 5; i++) {
+            patterns[i] << StyleInfo { .width = { 128 }, .height = { 128 } };
+            *all[i] << patterns[i];
+        }
+
+        center.set_up(up);
+        center.set_right(right);
+        center.set_down(down);
+        center.set_left(left);
+    }
+
+    void press(const Event::Value &direction) {
+        ::press(root, direction);
+    }
+
+    // What a slide toward direction shows after done of FRAMES frames
+    pixel expected(const Frame &from, const Frame &to, const Event::Value &direction, const int &done, const fb &x, const fb &y) {
+        const fb dx = 128 * done / UI_TRANSITION_FRAMES, dy = 128 * done / UI_TRANSITION_FRAMES;
+        switch (direction) {
+            case Event::DPAD_RIGHT: return x < 128 - dx ? from.getPixel(x + dx, y) : to.getPixel(x - (128 - dx), y);
+            case Event::DPAD_LEFT: return x < dx ? to.getPixel(x + 128 - dx, y) : from.getPixel(x - dx, y);
+            case Event::DPAD_DOWN: return y < 128 - dy ? from.getPixel(x, y + dy) : to.getPixel(x, y - (128 - dy));
+            default: return y < dy ? to.getPixel(x, y + 128 - dy) : from.getPixel(x, y - dy);
+        }
+    }
+
+    int mismatches(const Frame &from, const Frame &to, const Event::Value &direction, const int &done) {
+        int bad = 0;
+        for (fb y = 0; y < 128; y++)
+            for (fb x = 0; x < 128; x++)
+                bad += visible(frame, x, y) != expected(from, to, direction, done, x, y);
+        return bad;
+    }
+
+    // Slides from screen index from to index to, checking each frame
+    void slide(const int &from, const int &to, const Event::Value &direction) {
+        if constexpr (requires { frame.pages_sent; })
+            frame.pages_sent = frame.flushes = 0;
+
+        press(direction);
+        CHECK(root.active_screen == all[to]);
+
+        int frames = 0;
+        do {
+            root.once();
+            frames++;
+            CHECK(mismatches(screens[from], screens[to], direction, frames) == 0);
+        } while (root.transitioning && frames < 2 * UI_TRANSITION_FRAMES);
+
+        CHECK(frames == UI_TRANSITION_FRAMES);
+        CHECK(memcmp(frame.buffer, screens[to].buffer, sizeof(frame.buffer)) == 0);
+
+        if constexpr (requires { frame.pages_sent; }) {
+            const bool vertical = direction & (Event::DPAD_UP | Event::DPAD_DOWN);
+            CHECK(frame.pages_sent == (vertical ? 16 : 0));
+            CHECK(frame.flushes == (vertical ? 0 : UI_TRANSITION_FRAMES));
+            CHECK(frame.start_line == 0);
+        }
+
+        // The tree carries on from the new screen
+        root.once();
+        CHECK(memcmp(frame.buffer, screens[to].buffer, sizeof(frame.buffer)) == 0);
+    }
+
+    void run(const char *name) {
+        // Each screen drawn alone
+        for (int i = 0; i < 5; i++) {
+            root.set_screen(all[i]);
+            root.once();
+            memcpy(screens[i].buffer, frame.buffer, sizeof(frame.buffer));
+        }
+
+        root.set_screen(center);
+        root.once();
+
+        root.transition = &transition;
+        const int64_t start = micros();
+        slide(0, 1, Event::DPAD_UP);
+        slide(1, 0, Event::DPAD_DOWN);
+        slide(0, 2, Event::DPAD_RIGHT);
+        slide(2, 0, Event::DPAD_LEFT);
+        slide(0, 3, Event::DPAD_DOWN);
+        slide(3, 0, Event::DPAD_UP);
+        slide(0, 4, Event::DPAD_LEFT);
+        slide(4, 0, Event::DPAD_RIGHT);
+
+        printf("%-10s 8 slides of %i frames in %lldus\n", name, UI_TRANSITION_FRAMES, (long long)(micros() - start));
+    }
+};
+
+Scene<TextureT<FramebufferT<StaticbufferT<128, 128, 1>>>> rowmajor;
+Scene<TextureT<PagedFrame>> paged;
+Scene<TextureT<ScrollingFrame>> scrolling;
+
+int main() {
+    rowmajor.run("row major");
+    paged.run("paged");
+    scrolling.run("scrolling");
+
+    // Screen changes wait for a running slide
+    scrolling.press(Event::DPAD_UP);
+    scrolling.root.once();
+    scrolling.press(Event::DPAD_DOWN);
+    CHECK(scrolling.root.active_screen == &scrolling.up);
+    while (scrolling.root.transitioning)
+        scrolling.root.once();
+
+    return test_result();
+}
\ No newline at end of file
@@ -0,0 +1,182 @@
+#pragma once
+
+#include "config.h"
+#include "log.h"
+
+#include <inttypes.h>
+#include <array>
+#include <bit>
+#include <tuple>
+#include <utility>
+
+namespace wbl {
+
+template<typename ColumnLog, int COLUMN>
+struct ColumnViewT;
+
+/*
+    @brief Several value columns sharing one timestamp column
+
+    Sampling every sensor at one instant is a single push_back, and each
+    column is exposed as DataLogT storage through column<I>(). Time lookups
+    go through a small cache shared by all columns, so plotting several
+    columns over the same range searches the time column once.
+*/
+template<typename TIME_T, int LOOP_SIZE, typename... Columns>
+struct ColumnLogT {
+    using time_type = TIME_T;
+
+    static constexpr const int _size = LOOP_SIZE;
+    static constexpr const int column_count = sizeof...(Columns);
+    static constexpr const int cache_size = LOG_COLUMN_SEARCH_CACHE;
+    static constexpr const int cache_bits = std::countr_zero(unsigned(cache_size));
+
+    static_assert(column_count > 0, "ColumnLogT requires at least one column");
+    static_assert((cache_size & (cache_size - 1)) == 0, "LOG_COLUMN_SEARCH_CACHE must be a power of two");
+
+    template<int I>
+    using column_type = std::tuple_element_t<I, std::tuple<Columns...>>;
+
+    template<int I>
+    using point_type = DataPointT<TIME_T, column_type<I>>;
+
+    template<int I>
+    using view_type = ColumnViewT<ColumnLogT, I>;
+
+    template<int I>
+    using log_type = DataLogT<point_type<I>, view_type<I>>;
+
+    template<typename Seq>
+    struct ViewsOf;
+
+    template<int... Is>
+    struct ViewsOf<std::integer_sequence<int, Is...>> {
+        using type = std::tuple<view_type<Is>...>;
+    };
+
+    struct SearchEntry {
+        TIME_T time;
+        int index;
+        uint32_t version;
+    };
+
+    int index, count;
+    uint32_t version;
+    TIME_T times[_size];
+    std::tuple<std::array<Columns, _size>...> columns;
+    typename ViewsOf<std::make_integer_sequence<int, column_count>>::type views;
+    mutable SearchEntry search_cache[cache_size];
+
+    ColumnLogT():index(0),count(0),version(1),views(make_views(std::make_integer_sequence<int, column_count>())),search_cache{} {}
+
+    ColumnLogT(const ColumnLogT &) = delete;
+
+    template<int... Is>
+    inline auto make_views(std::integer_sequence<int, Is...>) {
+        return typename ViewsOf<std::integer_sequence<int, Is...>>::type(view_type<Is>(*this)...);
+    }
+
+    constexpr inline int size() const { return count; }
+
+    constexpr inline int capacity() const { return _size; }
+
+    constexpr inline void clear() { count = 0; index = 0; version++; }
+
+    template<int I>
+    constexpr inline view_type<I> &column() { return std::get<I>(views); }
+
+    constexpr inline void push_back(const TIME_T &time, const Columns&... values) {
+        if (index >= _size)
+            index = 0;
+        if (count < _size)
+            count++;
+
+        times[index] = time;
+        store_values(std::make_integer_sequence<int, column_count>(), values...);
+        index++;
+        version++;
+    }
+
+    template<int... Is>
+    constexpr inline void store_values(std::integer_sequence<int, Is...>, const Columns&... values) {
+        ((std::get<Is>(columns)[index] = values), ...);
+    }
+
+    constexpr inline int normalize(const int &pos) const {
+        return pos < 0 ? pos + count : pos;
+    }
+
+    constexpr inline int to_rel(const int &pos) const {
+        const int i = normalize(pos) + (count == _size ? index : 0);
+        return i >= _size ? i - _size : i;
+    }
+
+    constexpr inline bool has(const int &pos) const {
+        const int i = normalize(pos);
+        return count && i >= 0 && i < count;
+    }
+
+    constexpr inline const TIME_T &get_time(const int &pos) const { return times[to_rel(pos)]; }
+
+    template<int I>
+    constexpr inline const column_type<I> &get_value(const int &pos) const { return std::get<I>(columns)[to_rel(pos)]; }
+
+    // Fibonacci hash, the top bits are the well mixed ones
+    static constexpr inline uint32_t cache_slot(const TIME_T &time) {
+        return cache_bits ? (uint32_t(time) * 2654435761u) >> (32 - cache_bits) : 0;
+    }
+
+    /*
+        Index of the nearest point at or before time, never the upper bound
+    */
+    constexpr inline int index_of_time(const TIME_T &time) const {
+        SearchEntry &entry = search_cache[cache_slot(time)];
+
+        if (entry.version == version && entry.time == time)
+            return entry.index;
+
+        int lo = 0, hi = count;
+        while (hi - lo > 1) {
+            const int mid = lo + (hi - lo) / 2;
+            if (get_time(mid) <= time)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        entry = { time, lo, version };
+
+        return lo;
+    }
+};
+
+/*
+    @brief One column of a ColumnLogT, usable as DataLogT storage
+*/
+template<typename ColumnLog, int COLUMN>
+struct ColumnViewT {
+    using time_type = typename ColumnLog::time_type;
+    using value_type = typename ColumnLog::template column_type<COLUMN>;
+    using point_type = DataPointT<time_type, value_type>;
+
+    ColumnLog *columns;
+
+    constexpr ColumnViewT(ColumnLog &columns):columns(&columns){}
+
+    constexpr inline int size() const { return columns->size(); }
+
+    constexpr inline int capacity() const { return columns->capacity(); }
+
+    // Clears every column, they share one time column
+    constexpr inline void clear() { columns->clear(); }
+
+    constexpr inline bool has(const int &pos) const { return columns->has(pos); }
+
+    constexpr inline point_type get(const int &pos) const {
+        return point_type(columns->get_time(pos), columns->template get_value<COLUMN>(pos));
+    }
+
+    constexpr inline int index_of_time(const time_type &time) const { return columns->index_of_time(time); }
+};
+
+}
@@ -0,0 +1,396 @@
+#pragma once
+
+#include "config.h"
+#include "log.h"
+
+#include <inttypes.h>
+#include <type_traits>
+
+namespace wbl {
+
+/*
+    @brief Bit-packed time series storage, usable as DataLogT storage
+
+    Points are packed into fixed size blocks. Each block header keeps the first
+    point uncompressed, plus the last time and the min/max value of the block.
+    Following points store the delta-of-delta of time and the delta of value,
+    zig-zag encoded behind a short prefix code. A point where both are zero
+    opens a run, its length follows and is rewritten in place while the same
+    step repeats, so a steady 1 Hz series with an unchanged value costs a
+    few bits per run and a block lasts for its full count of points.
+
+    How long the blocks last depends on the noise. The default 12 blocks of
+    48 bytes take about the RAM of a 100 point LoopBuffer. At 1 Hz they keep
+    hours of a value that only steps now and then, around 800 points with
+    exact times and 2 bits of noise, and under 200 with microsecond timer
+    jitter and 5 bits of noise. capacity() estimates it from the points
+    stored. When every block is in use the oldest block is dropped as a whole.
+*/
+template<typename DataPoint = DataPointT<>, int BLOCK_BYTES = LOG_BLOCK_BYTES, int BLOCK_COUNT = LOG_BLOCK_COUNT>
+struct DeltaBufferT {
+    using point_type = DataPoint;
+    using time_type = typename DataPoint::time_type;
+    using value_type = typename DataPoint::value_type;
+
+    static_assert(std::is_integral<time_type>::value && std::is_integral<value_type>::value, "DeltaBufferT requires integral time and value types");
+
+    static constexpr const int block_bits = BLOCK_BYTES * 8;
+
+    // Payload widths for the 10, 110, 1110 and 1111 prefixes, 0 encodes zero
+    static constexpr const uint8_t time_widths[] = { 3, 9, 16, 32 };
+    static constexpr const uint8_t value_widths[] = { 3, 8, 16, 32 };
+    // Run length minus one, after a zero time and value code
+    static constexpr const uint8_t run_widths[] = { 3, 8, 12, 16 };
+
+    struct Block {
+        time_type time_first, time_last;
+        value_type value_first, value_min, value_max;
+        uint16_t count, bits;
+        uint8_t data[BLOCK_BYTES];
+    };
+
+    struct Cursor {
+        int block = -1, base = 0, index = 0;
+        uint16_t bit = 0, run = 0;
+        int64_t delta = 0;
+        point_type point;
+    };
+
+    Block blocks[BLOCK_COUNT];
+    int first = 0, used = 0, count = 0;
+
+    // Writer state for the newest block
+    int64_t last_delta = 0;
+    value_type last_value = 0;
+    // Length of the run ending the newest block and where its length field starts
+    uint16_t run = 0, run_bit = 0;
+
+    mutable Cursor cursor;
+
+    constexpr DeltaBufferT(){}
+
+    constexpr inline int size() const { return count; }
+
+    /*
+        @brief Points the blocks hold at the density of the stored ones
+
+        Full blocks count as spent, the newest as far as it is written. A
+        steady series reaches UINT16_MAX points per block. Before the first
+        point only the worst case is known, a point per block.
+    */
+    constexpr inline int capacity() const {
+        int64_t bits = 0;
+        for (int b = 0; b < used; b++)
+            bits += b < used - 1 ? block_bits : get_block(b).bits;
+
+        const int64_t most = int64_t(BLOCK_COUNT) * UINT16_MAX;
+        if (!count)
+            return BLOCK_COUNT;
+        if (!bits)
+            return int(most);
+
+        const int64_t estimate = int64_t(count) * BLOCK_COUNT * block_bits / bits;
+        return int(estimate < most ? estimate : most);
+    }
+
+    constexpr inline int block_count() const { return used; }
+
+    constexpr inline void clear() {
+        first = 0;
+        used = 0;
+        count = 0;
+        cursor = Cursor();
+    }
+
+    constexpr inline int slot(const int &block) const { return (first + block) % BLOCK_COUNT; }
+
+    constexpr inline const Block &get_block(const int &block) const { return blocks[slot(block)]; }
+
+    constexpr inline Block &get_block(const int &block) { return blocks[slot(block)]; }
+
+    static constexpr inline uint64_t zigzag(const int64_t &v) {
+        return (uint64_t(v) << 1) ^ uint64_t(v >> 63);
+    }
+
+    static constexpr inline int64_t unzigzag(const uint64_t &v) {
+        return int64_t(v >> 1) ^ -int64_t(v & 1);
+    }
+
+    static constexpr inline int code_bits(const uint64_t &zz, const uint8_t *widths) {
+        if (!zz)
+            return 1;
+        for (int k = 0; k < 4; k++)
+            if (zz < (uint64_t(1) << widths[k]))
+                return k + 1 + (k < 3) + widths[k];
+        return -1;
+    }
+
+    static constexpr inline void put_bits(uint8_t *data, uint16_t &pos, const uint64_t &value, const uint8_t &n) {
+        for (int i = n - 1; i >= 0;) {
+            const uint8_t room = 8 - (pos & 7);
+            const uint8_t take = (i + 1) < room ? (i + 1) : room;
+            const uint8_t chunk = (value >> (i + 1 - take)) & ((1 << take) - 1);
+            uint8_t &byte = data[pos >> 3];
+            if (!(pos & 7))
+                byte = 0;
+            byte |= chunk << (room - take);
+            pos += take;
+            i -= take;
+        }
+    }
+
+    static constexpr inline uint64_t get_bits(const uint8_t *data, uint16_t &pos, const uint8_t &n) {
+        uint64_t value = 0;
+        for (int i = n; i > 0;) {
+            const uint8_t room = 8 - (pos & 7);
+            const uint8_t take = i < room ? i : room;
+            const uint8_t chunk = (data[pos >> 3] >> (room - take)) & ((1 << take) - 1);
+            value = (value << take) | chunk;
+            pos += take;
+            i -= take;
+        }
+        return value;
+    }
+
+    static constexpr inline void encode(uint8_t *data, uint16_t &pos, const uint64_t &zz, const uint8_t *widths) {
+        if (!zz) {
+            put_bits(data, pos, 0, 1);
+            return;
+        }
+
+        int k = 0;
+        while (k < 3 && zz >= (uint64_t(1) << widths[k]))
+            k++;
+
+        // k+1 ones, terminated by a zero except for the last code
+        put_bits(data, pos, (k < 3) ? ((1 << (k + 2)) - 2) : 15, k + 1 + (k < 3));
+        put_bits(data, pos, zz, widths[k]);
+    }
+
+    static constexpr inline uint64_t decode(const uint8_t *data, uint16_t &pos, const uint8_t *widths) {
+        int k = 0;
+        while (k < 4 && get_bits(data, pos, 1))
+            k++;
+
+        if (!k)
+            return 0;
+
+        return get_bits(data, pos, widths[k - 1]);
+    }
+
+    constexpr inline void start_block(const DataPoint &point) {
+        if (used == BLOCK_COUNT) {
+            count -= blocks[first].count;
+            first = (first + 1) % BLOCK_COUNT;
+            used--;
+            // Block numbers and bases shift when the oldest is dropped
+            cursor = Cursor();
+        }
+
+        Block &block = blocks[slot(used++)];
+        block.time_first = block.time_last = point.time;
+        block.value_first = block.value_min = block.value_max = point.value;
+        block.count = 1;
+        block.bits = 0;
+
+        last_delta = 0;
+        last_value = point.value;
+        run = 0;
+        count++;
+    }
+
+    constexpr inline void push_back(const DataPoint &point) {
+        if (!used) {
+            start_block(point);
+            return;
+        }
+
+        Block &block = get_block(used - 1);
+
+        const int64_t delta = int64_t(point.time) - int64_t(block.time_last);
+        const uint64_t time_zz = zigzag(delta - last_delta);
+        const uint64_t value_zz = zigzag(int64_t(point.value) - int64_t(last_value));
+
+        const bool repeat = !time_zz && !value_zz;
+
+        if (repeat && run) {
+            if (run_bit + code_bits(run, run_widths) > block_bits || block.count == UINT16_MAX) {
+                start_block(point);
+                return;
+            }
+
+            // A cursor past the length field would read the old length
+            if (cursor.block == used - 1 && cursor.bit > run_bit)
+                cursor = Cursor();
+
+            block.data[run_bit >> 3] &= uint8_t(0xff00 >> (run_bit & 7));
+            block.bits = run_bit;
+            encode(block.data, block.bits, run, run_widths);
+            run++;
+        } else {
+            const int time_bits = code_bits(time_zz, time_widths);
+            const int value_bits = code_bits(value_zz, value_widths);
+
+            if (time_bits < 0 || value_bits < 0 || block.bits + time_bits + value_bits + repeat > block_bits || block.count == UINT16_MAX) {
+                start_block(point);
+                return;
+            }
+
+            encode(block.data, block.bits, time_zz, time_widths);
+            encode(block.data, block.bits, value_zz, value_widths);
+
+            run = 0;
+            if (repeat) {
+                run_bit = block.bits;
+                encode(block.data, block.bits, 0, run_widths);
+                run = 1;
+            }
+        }
+
+        block.time_last = point.time;
+        block.count++;
+        if (point.value < block.value_min)
+            block.value_min = point.value;
+        if (point.value > block.value_max)
+            block.value_max = point.value;
+
+        last_delta = delta;
+        last_value = point.value;
+        count++;
+    }
+
+    constexpr inline void seek_block(const int &block, const int &base) const {
+        const Block &b = get_block(block);
+        cursor.block = block;
+        cursor.base = base;
+        cursor.index = 0;
+        cursor.bit = 0;
+        cursor.run = 0;
+        cursor.delta = 0;
+        cursor.point = point_type(b.time_first, b.value_first);
+    }
+
+    constexpr inline void step() const {
+        const Block &b = get_block(cursor.block);
+        int64_t value = cursor.point.value;
+
+        if (cursor.run)
+            cursor.run--;
+        else {
+            const uint64_t time_zz = decode(b.data, cursor.bit, time_widths);
+            const uint64_t value_zz = decode(b.data, cursor.bit, value_widths);
+            cursor.delta += unzigzag(time_zz);
+            value += unzigzag(value_zz);
+            if (!time_zz && !value_zz)
+                cursor.run = uint16_t(decode(b.data, cursor.bit, run_widths));
+        }
+
+        cursor.point = point_type(time_type(cursor.point.time + cursor.delta), value_type(value));
+        cursor.index++;
+    }
+
+    constexpr inline point_type decode_at(const int &block, const int &base, const int &index) const {
+        if (cursor.block != block || cursor.index > index)
+            seek_block(block, base);
+
+        while (cursor.index < index)
+            step();
+
+        return cursor.point;
+    }
+
+    constexpr inline int normalize(const int &pos) const {
+        return pos < 0 ? pos + count : pos;
+    }
+
+    constexpr inline bool has(const int &pos) const {
+        const int i = normalize(pos);
+        return count && i >= 0 && i < count;
+    }
+
+    constexpr inline point_type get(const int &pos) const {
+        const int i = normalize(pos);
+
+        if (i < 0 || i >= count)
+            return point_type();
+
+        // Sequential reads continue from the cursor block
+        int block = 0, base = 0;
+        if (cursor.block >= 0 && i >= cursor.base) {
+            block = cursor.block;
+            base = cursor.base;
+        }
+
+        for (; block < used && i - base >= get_block(block).count; block++)
+            base += get_block(block).count;
+
+        return decode_at(block, base, i - base);
+    }
+
+    /*
+        Index of the nearest point at or before time, never the upper bound
+    */
+    constexpr inline int index_of_time(const time_type &time) const {
+        if (!used)
+            return 0;
+
+        int lo = 0, hi = used;
+        while (hi - lo > 1) {
+            const int mid = lo + (hi - lo) / 2;
+            if (get_block(mid).time_first <= time)
+                lo = mid;
+            else
+                hi = mid;
+        }
+
+        int base = 0;
+        for (int b = 0; b < lo; b++)
+            base += get_block(b).count;
+
+        const Block &block = get_block(lo);
+
+        if (time >= block.time_last)
+            return base + block.count - 1;
+
+        seek_block(lo, base);
+        while (cursor.index + 1 < block.count) {
+            const Cursor prev = cursor;
+            step();
+            if (cursor.point.time > time) {
+                cursor = prev;
+                break;
+            }
+        }
+
+        return base + cursor.index;
+    }
+
+    constexpr inline value_type min() const {
+        if (!used)
+            return 0;
+
+        value_type v = get_block(0).value_min;
+        for (int b = 1; b < used; b++)
+            if (get_block(b).value_min < v)
+                v = get_block(b).value_min;
+
+        return v;
+    }
+
+    constexpr inline value_type max() const {
+        if (!used)
+            return 0;
+
+        value_type v = get_block(0).value_max;
+        for (int b = 1; b < used; b++)
+            if (get_block(b).value_max > v)
+                v = get_block(b).value_max;
+
+        return v;
+    }
+};
+
+using DeltaBuffer = DeltaBufferT<DataPoint>;
+using DeltaLog = DataLogT<DataPoint, DeltaBuffer>;
+
+}
@@ -3,6 +3,7 @@
 #include "types.h"
 #include "config.h"
 #include <assert.h>
+#include <inttypes.h>
 
 namespace wbl {
 
@@ -129,9 +130,18 @@ struct DataLogT {
 
     constexpr inline bool has(const int &pos) const { return log.template has(pos); }
 
-    constexpr inline DataPoint &get(const int &pos) { return log.template get(pos); }
+    // Pulls in points queued by another thread, a no-op for single threaded storage
+    constexpr inline int snapshot() {
+        if constexpr (requires { log.snapshot(); })
+            return log.snapshot();
+        else
+            return 0;
+    }
+
+    // Reference for in-memory storage, a decoded copy for packed storage
+    constexpr inline decltype(auto) get(const int &pos) { return log.template get(pos); }
 
-    constexpr inline const DataPoint &get(const int &pos) const { return log.template get(pos); }
+    constexpr inline decltype(auto) get(const int &pos) const { return log.template get(pos); }
 
     /*
         Returns the previous nearest value or the exact match, never the upper bound
@@ -154,10 +164,13 @@ struct DataLogT {
     }
 
     constexpr inline int binary_index(const time_type &time) const {
-        return binary_index(time, 0, size());
+        if constexpr (requires { log.index_of_time(time); })
+            return log.index_of_time(time);
+        else
+            return binary_index(time, 0, size());
     }
 
-    constexpr inline point_type &binary_search(const time_type &time) {
+    constexpr inline decltype(auto) binary_search(const time_type &time) {
         return get(binary_index(time));
     }
 
@@ -223,6 +236,9 @@ struct DataLogT {
     }
 
     constexpr inline value_type min() const {
+        if constexpr (requires { log.min(); })
+            return log.min();
+
         if (!size())
             return 0;
 
@@ -238,6 +254,9 @@ struct DataLogT {
     }
 
     constexpr inline value_type max() const {
+        if constexpr (requires { log.max(); })
+            return log.max();
+
         if (!size())
             return 0;
 
@@ -252,6 +271,36 @@ struct DataLogT {
         return v;
     }
 
+    constexpr inline value_type min_range(const int &start_index, const int &end_index) const {
+        if (start_index >= size())
+            return 0;
+
+        value_type v = get(start_index).value;
+
+        for (int i = start_index + 1; i < size() && i < end_index; i++) {
+            const value_type &p = get(i).value;
+            if (p < v)
+                v = p;
+        }
+
+        return v;
+    }
+
+    constexpr inline value_type max_range(const int &start_index, const int &end_index) const {
+        if (start_index >= size())
+            return 0;
+
+        value_type v = get(start_index).value;
+
+        for (int i = start_index + 1; i < size() && i < end_index; i++) {
+            const value_type &p = get(i).value;
+            if (p > v)
+                v = p;
+        }
+
+        return v;
+    }
+
     constexpr inline value_type range() const {
         return max() - min();
     }
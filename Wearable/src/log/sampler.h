@@ -0,0 +1,393 @@
+#pragma once
+
+#include "config.h"
+#include "log.h"
+#include "spsc_buffer.h"
+#include "wbl_func.h"
+
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <inttypes.h>
+#include <tuple>
+
+namespace wbl {
+
+struct NoFilter {
+    constexpr inline bool push(const int32_t &in, int32_t &out) {
+        out = in;
+        return true;
+    }
+};
+
+/*
+    @brief Keeps every Nth sample
+*/
+template<int N>
+struct DecimateT {
+    int n = 0;
+
+    constexpr inline bool push(const int32_t &in, int32_t &out) {
+        if (++n < N)
+            return false;
+        n = 0;
+        out = in;
+        return true;
+    }
+};
+
+/*
+    @brief Averages N samples into one
+*/
+template<int N>
+struct BoxcarT {
+    int64_t sum = 0;
+    int n = 0;
+
+    constexpr inline bool push(const int32_t &in, int32_t &out) {
+        sum += in;
+        if (++n < N)
+            return false;
+        out = int32_t(sum / N);
+        sum = 0;
+        n = 0;
+        return true;
+    }
+};
+
+/*
+    @brief Cascaded integrator-comb decimator, R samples in for each sample out
+
+    Integrators wrap around, the combs undo the wrap as long as the gain R^STAGES
+    fits in 64 bits.
+*/
+template<int R, int STAGES = 3>
+struct CICT {
+    static constexpr inline int64_t gain() {
+        int64_t g = 1;
+        for (int i = 0; i < STAGES; i++)
+            g *= R;
+        return g;
+    }
+
+    uint64_t integrators[STAGES] = {}, combs[STAGES] = {};
+    int n = 0;
+
+    constexpr inline bool push(const int32_t &in, int32_t &out) {
+        uint64_t v = uint64_t(int64_t(in));
+        for (int i = 0; i < STAGES; i++)
+            v = integrators[i] += v;
+
+        if (++n < R)
+            return false;
+        n = 0;
+
+        for (int i = 0; i < STAGES; i++) {
+            const uint64_t previous = combs[i];
+            combs[i] = v;
+            v -= previous;
+        }
+
+        out = int32_t(int64_t(v) / gain());
+        return true;
+    }
+};
+
+/*
+    @brief Runs filters in order, an output is only produced when every stage produces one
+*/
+template<typename... Filters>
+struct FilterChainT {
+    std::tuple<Filters...> filters;
+
+    template<int I = 0>
+    constexpr inline bool push(const int32_t &in, int32_t &out) {
+        if constexpr (I == sizeof...(Filters)) {
+            out = in;
+            return true;
+        } else {
+            int32_t v;
+            if (!std::get<I>(filters).push(in, v))
+                return false;
+            return push<I + 1>(v, out);
+        }
+    }
+};
+
+struct SensorStats {
+    uint32_t samples = 0, outputs = 0, errors = 0, missed = 0, dropped = 0;
+    int64_t jitter_us_total = 0, jitter_us_last = 0, jitter_us_max = 0;
+
+    constexpr inline float jitter_us_avg() const {
+        return samples ? float(jitter_us_total) / samples : 0.0f;
+    }
+};
+
+/*
+    @brief A sampled input with one or more channels
+
+    read() and filter() run on the sampler task, store() runs wherever
+    SamplerT::drain() is called.
+*/
+struct ISensor {
+    const char *name;
+    uint32_t period_us;
+    uint8_t bus;
+    uint8_t channels;
+
+    int64_t next = 0;
+    SensorStats stats;
+
+    constexpr ISensor(const char *name, const uint32_t &period_us, const uint8_t &bus, const uint8_t &channels)
+        :name(name),period_us(period_us),bus(bus),channels(channels){}
+
+    virtual esp_err_t read(int32_t *values) = 0;
+
+    // Returns false while the filter is still accumulating
+    virtual bool filter(int32_t *values) = 0;
+
+    virtual void store(const int64_t &time, const int32_t *values) = 0;
+};
+
+template<int CHANNELS = 1, typename Filter = NoFilter>
+struct SensorT : public ISensor {
+    static_assert(CHANNELS <= SAMPLER_MAX_CHANNELS, "Too many channels, raise SAMPLER_MAX_CHANNELS");
+
+    using read_func = esp_err_t (*)(int32_t *values);
+    using store_func = void (*)(const int64_t &time, const int32_t *values);
+
+    read_func reader;
+    store_func storer;
+    Filter filters[CHANNELS];
+
+    constexpr SensorT(const char *name, const uint32_t &period_us, const uint8_t &bus, read_func reader, store_func storer)
+        :ISensor(name, period_us, bus, CHANNELS),reader(reader),storer(storer){}
+
+    constexpr SensorT(const char *name, const uint32_t &period_us, read_func reader, store_func storer)
+        :SensorT(name, period_us, 0, reader, storer){}
+
+    esp_err_t read(int32_t *values) override {
+        return reader(values);
+    }
+
+    bool filter(int32_t *values) override {
+        bool ready = true;
+        for (int i = 0; i < CHANNELS; i++)
+            ready &= filters[i].push(values[i], values[i]);
+        return ready;
+    }
+
+    void store(const int64_t &time, const int32_t *values) override {
+        storer(time, values);
+    }
+};
+
+/*
+    @brief Fixed table of sensors sampled on their own task
+
+    Each sensor is read on its own period, independent of the frame rate.
+    Sensors on the same bus (bus 0 means no shared bus) that are due within
+    SAMPLER_COALESCE_US are read back to back under a single acquire/release
+    of that bus, such as I2CArbiterT::acquire_bus/release_bus. Filtered
+    samples go through a lock-free queue, drain() hands them to each
+    sensor's store() on the consumer side, usually right before the UI draws.
+*/
+template<int MAX_SENSORS = SAMPLER_MAX_SENSORS>
+struct SamplerT {
+    static constexpr const char *TAG = "wbl::SamplerT";
+
+    struct Sample {
+        int64_t time;
+        uint8_t sensor;
+        int32_t values[SAMPLER_MAX_CHANNELS];
+    };
+
+    // History storage for the sample queue, routes samples to their sensor
+    struct Dispatch {
+        SamplerT *sampler;
+
+        constexpr inline void push_back(const Sample &sample) {
+            sampler->sensors[sample.sensor]->store(sample.time, sample.values);
+        }
+    };
+
+    struct Bus {
+        esp_err_t (*acquire)(void *ctx) = nullptr;
+        void (*release)(void *ctx) = nullptr;
+        void *ctx = nullptr;
+    };
+
+    ISensor *sensors[MAX_SENSORS];
+    int count = 0;
+    Bus buses[SAMPLER_MAX_BUSES];
+
+    // Sees every raw read on the sampler task and may replace it, used for record/replay
+    esp_err_t (*tap)(const ISensor &sensor, int32_t *values, esp_err_t result) = nullptr;
+
+    SPSCLoopBufferT<Sample, 1, SAMPLER_QUEUE_SIZE, Dispatch> queue;
+
+    uint32_t bus_batches = 0;
+
+    TaskHandle_t task = nullptr;
+    volatile bool running = false;
+
+    SamplerT() {
+        queue.history.sampler = this;
+    }
+
+    inline esp_err_t add(ISensor &sensor) {
+        if (count == MAX_SENSORS)
+            return ESP_ERR_NO_MEM;
+        if (sensor.bus >= SAMPLER_MAX_BUSES || sensor.channels > SAMPLER_MAX_CHANNELS || !sensor.period_us)
+            return ESP_ERR_INVALID_ARG;
+
+        sensors[count++] = &sensor;
+        return ESP_OK;
+    }
+
+    inline SamplerT &operator<<(ISensor &sensor) {
+        add(sensor);
+        return *this;
+    }
+
+    inline void set_bus(const uint8_t &bus, esp_err_t (*acquire)(void*), void (*release)(void*), void *ctx = nullptr) {
+        buses[bus] = { acquire, release, ctx };
+    }
+
+    inline void sample(const uint8_t &index, const int64_t &now) {
+        ISensor &sensor = *sensors[index];
+        SensorStats &stats = sensor.stats;
+
+        // Coalesced reads run early, count both directions
+        const int64_t jitter = now - sensor.next;
+        const int64_t magnitude = jitter < 0 ? -jitter : jitter;
+        stats.jitter_us_last = jitter;
+        stats.jitter_us_total += magnitude;
+        if (magnitude > stats.jitter_us_max)
+            stats.jitter_us_max = magnitude;
+
+        // Stay on the original grid, skipping periods that already passed
+        sensor.next += sensor.period_us;
+        if (sensor.next <= now) {
+            const int64_t behind = (now - sensor.next) / sensor.period_us + 1;
+            stats.missed += behind;
+            sensor.next += behind * sensor.period_us;
+        }
+
+        Sample s;
+        s.time = now;
+        s.sensor = index;
+
+        esp_err_t err = sensor.read(s.values);
+        if (tap)
+            err = tap(sensor, s.values, err);
+
+        if (err != ESP_OK) {
+            stats.errors++;
+            return;
+        }
+        stats.samples++;
+
+        if (!sensor.filter(s.values))
+            return;
+        stats.outputs++;
+
+        if (!queue.push_back(s))
+            stats.dropped++;
+    }
+
+    /*
+        @brief Reads every due sensor, returns the time of the next deadline
+    */
+    inline int64_t poll(const int64_t &now) {
+        int64_t next = now + 1000000;
+
+        for (int i = 0; i < count; i++)
+            if (!sensors[i]->next)
+                sensors[i]->next = now;
+
+        for (uint8_t bus = 0; bus < SAMPLER_MAX_BUSES; bus++) {
+            const int64_t window = bus ? now + SAMPLER_COALESCE_US : now;
+            bool acquired = false;
+
+            for (int i = 0; i < count; i++) {
+                ISensor &sensor = *sensors[i];
+                if (sensor.bus != bus || sensor.next > window)
+                    continue;
+
+                if (!acquired && buses[bus].acquire) {
+                    if (buses[bus].acquire(buses[bus].ctx) != ESP_OK) {
+                        sensor.stats.errors++;
+                        break;
+                    }
+                }
+                if (!acquired)
+                    bus_batches += bus != 0;
+                acquired = true;
+
+                sample(i, micros());
+            }
+
+            if (acquired && buses[bus].release)
+                buses[bus].release(buses[bus].ctx);
+        }
+
+        for (int i = 0; i < count; i++)
+            if (sensors[i]->next < next)
+                next = sensors[i]->next;
+
+        return next;
+    }
+
+    /*
+        @brief Consumer side, stores queued samples into their logs
+    */
+    inline int drain() {
+        return queue.snapshot();
+    }
+
+    inline void print_stats() const {
+        for (int i = 0; i < count; i++) {
+            const ISensor &sensor = *sensors[i];
+            const SensorStats &s = sensor.stats;
+            printf("%s: samples %" PRIu32 " outputs %" PRIu32 " errors %" PRIu32 " missed %" PRIu32 " dropped %" PRIu32 " jitter avg %.1fus max %" PRIi64 "us\n",
+                sensor.name, s.samples, s.outputs, s.errors, s.missed, s.dropped, s.jitter_us_avg(), s.jitter_us_max);
+        }
+        printf("bus batches %" PRIu32 "\n", bus_batches);
+    }
+
+    static void sample_task(void *arg) {
+        SamplerT *sampler = (SamplerT*)arg;
+
+        while (sampler->running) {
+            const int64_t wait = sampler->poll(micros()) - micros();
+            delay(wait > 1000 ? TickType_t(wait / 1000) : 1);
+        }
+
+        sampler->task = nullptr;
+        vTaskDelete(nullptr);
+    }
+
+    inline esp_err_t start(const BaseType_t &core = tskNO_AFFINITY) {
+        if (task)
+            return ESP_OK;
+
+        running = true;
+
+        if (xTaskCreatePinnedToCore(sample_task, "sampler", 4096, this, tskIDLE_PRIORITY + 2, &task, core) != pdPASS) {
+            running = false;
+            return ESP_ERR_NO_MEM;
+        }
+
+        return ESP_OK;
+    }
+
+    inline void stop() {
+        running = false;
+    }
+};
+
+using Sampler = SamplerT<>;
+
+}
@@ -0,0 +1,419 @@
+#pragma once
+
+#include "config.h"
+#include "log.h"
+#include "wbl_func.h"
+#include "esp_system.h"
+#include "esp_check.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+
+#include <atomic>
+#include <inttypes.h>
+#include <string.h>
+
+namespace wbl {
+
+static constexpr inline uint32_t crc32(const void *data, const uint32_t &length, uint32_t crc = 0) {
+    constexpr const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+
+    const uint8_t *bytes = (const uint8_t*)data;
+    crc = ~crc;
+    for (uint32_t i = 0; i < length; i++) {
+        crc = table[(crc ^ bytes[i]) & 0xf] ^ (crc >> 4);
+        crc = table[(crc ^ (bytes[i] >> 4)) & 0xf] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+/*
+    @brief Append-only log of DataPoints on a block device
+
+    The device region is a ring of 512 byte pages. Every page carries a magic,
+    a sequence number and a CRC, and page N of the ring always holds a sequence
+    congruent to N. Points are batched into pages in RAM, completed pages are
+    written in whole runs by flush(), normally from a low priority task.
+    Every INDEX_INTERVAL data pages an index page of (time -> page) entries is
+    written, linked to the previous index page.
+
+    recover() binary searches the sequence numbers for the write head, so boot
+    only reads O(log n) pages plus the tail. A torn page fails its CRC and is
+    treated as the end of the log.
+
+    push_back() and flush() may run on different tasks, sync() and recover()
+    must run on the producer with the flush task stopped or idle.
+*/
+template<typename Device, typename DataPoint = DataPointT<>, int PAGE_BUFFERS = SDLOG_PAGE_BUFFERS, int INDEX_INTERVAL = SDLOG_INDEX_INTERVAL>
+struct SegmentLogT {
+    static constexpr const char *TAG = "wbl::SegmentLogT";
+    static constexpr const uint32_t PAGE_SIZE = 512;
+    static constexpr const uint32_t MAGIC = 0x474C4257; // WBLG
+
+    using point_type = DataPoint;
+    using time_type = typename DataPoint::time_type;
+    using value_type = typename DataPoint::value_type;
+
+    enum PageType : uint8_t {
+        PAGE_DATA = 1,
+        PAGE_INDEX = 2,
+    };
+
+    struct PageHeader {
+        uint32_t magic;
+        uint32_t sequence;
+        uint32_t crc;
+        PageType type;
+        uint8_t reserved;
+        uint16_t count;
+        time_type time_first, time_last;
+    };
+
+    struct IndexEntry {
+        time_type time;
+        uint32_t page;
+    };
+
+    struct IndexHeader {
+        uint32_t previous;
+        uint32_t count;
+    };
+
+    static constexpr const int POINTS_PER_PAGE = (PAGE_SIZE - sizeof(PageHeader)) / sizeof(DataPoint);
+    static constexpr const int INDEX_ENTRIES = (PAGE_SIZE - sizeof(PageHeader) - sizeof(IndexHeader)) / sizeof(IndexEntry);
+    static constexpr const uint32_t NO_PAGE = UINT32_MAX;
+
+    static_assert(INDEX_INTERVAL <= INDEX_ENTRIES, "INDEX_INTERVAL does not fit an index page");
+
+    struct alignas(4) Page {
+        PageHeader header;
+        uint8_t payload[PAGE_SIZE - sizeof(PageHeader)];
+
+        inline DataPoint *points() { return (DataPoint*)payload; }
+        inline IndexHeader &index() { return *(IndexHeader*)payload; }
+        inline IndexEntry *entries() { return (IndexEntry*)(payload + sizeof(IndexHeader)); }
+
+        inline void seal() {
+            header.magic = MAGIC;
+            header.crc = 0;
+            header.crc = crc32(this, PAGE_SIZE);
+        }
+
+        inline bool is_valid() const {
+            Page copy;
+            memcpy(&copy, this, PAGE_SIZE);
+            copy.header.crc = 0;
+            return header.magic == MAGIC && crc32(&copy, PAGE_SIZE) == header.crc;
+        }
+    };
+
+    static_assert(sizeof(Page) == PAGE_SIZE, "Page must be one block");
+
+    struct Stats {
+        uint32_t flushes = 0, pages = 0, dropped = 0, errors = 0;
+        uint64_t bytes = 0;
+        int64_t flush_us_total = 0, flush_us_last = 0, flush_us_max = 0;
+    };
+
+    Device &device;
+    uint32_t first_block, page_count;
+
+    Page pages[PAGE_BUFFERS];
+    std::atomic<uint32_t> queued{0}, flushed{0};
+
+    uint32_t sequence = 0;
+    bool page_open = false;
+    uint32_t last_index_page = NO_PAGE;
+    IndexEntry index_entries[INDEX_ENTRIES];
+    int index_count = 0, pages_since_index = 0;
+
+    Stats stats;
+    TaskHandle_t task = nullptr;
+    volatile bool running = false;
+    uint32_t flush_period = SDLOG_FLUSH_PERIOD;
+
+    // The log owns blocks first_block..first_block+page_count-1 and nothing else on the device
+    constexpr SegmentLogT(Device &device, const uint32_t &first_block, const uint32_t &page_count)
+        :device(device),first_block(first_block),page_count(page_count) { }
+
+    constexpr inline uint32_t page_of(const uint32_t &seq) const { return seq % page_count; }
+
+    constexpr inline Page &current() { return pages[queued.load(std::memory_order_relaxed) % PAGE_BUFFERS]; }
+
+    constexpr inline bool has_free_page() const {
+        return queued.load(std::memory_order_relaxed) - flushed.load(std::memory_order_acquire) < PAGE_BUFFERS;
+    }
+
+    inline void start_page(Page &page, const PageType &type) {
+        memset(&page, 0, PAGE_SIZE);
+        page.header.type = type;
+        page.header.sequence = sequence;
+        page_open = type == PAGE_DATA;
+    }
+
+    inline void complete_page(Page &page) {
+        page_open = false;
+        page.seal();
+        sequence++;
+        queued.fetch_add(1, std::memory_order_release);
+    }
+
+    inline void write_index() {
+        Page &page = current();
+        start_page(page, PAGE_INDEX);
+        page.index().previous = last_index_page;
+        page.index().count = index_count;
+        memcpy(page.entries(), index_entries, sizeof(IndexEntry) * index_count);
+        page.header.count = index_count;
+        page.header.time_first = index_entries[0].time;
+        page.header.time_last = index_entries[index_count-1].time;
+
+        last_index_page = page_of(sequence);
+        index_count = 0;
+        pages_since_index = 0;
+
+        complete_page(page);
+    }
+
+    inline void complete_data_page(Page &page) {
+        if (index_count < INDEX_ENTRIES)
+            index_entries[index_count++] = IndexEntry{page.header.time_first, page_of(sequence)};
+
+        complete_page(page);
+
+        if (++pages_since_index >= INDEX_INTERVAL && index_count && has_free_page())
+            write_index();
+    }
+
+    /*
+        @returns false if the RAM pages are all waiting on flush and the point was dropped
+    */
+    inline bool push_back(const DataPoint &point) {
+        if (!page_count)
+            return false;
+
+        if (!has_free_page()) {
+            stats.dropped++;
+            return false;
+        }
+
+        Page &page = current();
+
+        if (!page_open)
+            start_page(page, PAGE_DATA);
+
+        if (!page.header.count)
+            page.header.time_first = point.time;
+
+        page.points()[page.header.count++] = point;
+        page.header.time_last = point.time;
+
+        if (page.header.count >= POINTS_PER_PAGE)
+            complete_data_page(page);
+
+        return true;
+    }
+
+    inline void push_back(const time_type &time, const value_type &value) {
+        push_back(point_type(time, value));
+    }
+
+    /*
+        @brief Write every completed page, one device write per contiguous run
+    */
+    inline esp_err_t flush() {
+        uint32_t tail = flushed.load(std::memory_order_relaxed);
+        const uint32_t head = queued.load(std::memory_order_acquire);
+
+        if (tail == head)
+            return ESP_OK;
+
+        const int64_t start = micros();
+
+        while (tail != head) {
+            const uint32_t slot = tail % PAGE_BUFFERS;
+            const Page &page = pages[slot];
+            const uint32_t device_page = page_of(page.header.sequence);
+
+            uint32_t run = head - tail;
+            if (run > PAGE_BUFFERS - slot)
+                run = PAGE_BUFFERS - slot;
+            if (run > page_count - device_page)
+                run = page_count - device_page;
+
+            const esp_err_t err = device.write_blocks(first_block + device_page, &page, run);
+            if (err != ESP_OK) {
+                stats.errors++;
+                return err;
+            }
+
+            tail += run;
+            flushed.store(tail, std::memory_order_release);
+            stats.pages += run;
+            stats.bytes += run * PAGE_SIZE;
+        }
+
+        const int64_t elapsed = micros() - start;
+        stats.flushes++;
+        stats.flush_us_last = elapsed;
+        stats.flush_us_total += elapsed;
+        if (elapsed > stats.flush_us_max)
+            stats.flush_us_max = elapsed;
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Complete the partial page and flush, for shutdown
+    */
+    inline esp_err_t sync() {
+        Page &page = current();
+        if (page_open && page.header.count)
+            complete_data_page(page);
+        return flush();
+    }
+
+    inline esp_err_t read_page(const uint32_t &page, Page &out) {
+        return device.read_blocks(first_block + page, &out, 1);
+    }
+
+    inline bool read_valid(const uint32_t &page, Page &out) {
+        return read_page(page, out) == ESP_OK && out.is_valid() && page_of(out.header.sequence) == page;
+    }
+
+    /*
+        @brief Find the write head after a reset
+
+        Pages 0..k of the current lap carry consecutive sequences starting at
+        page 0, so the last of them is found by binary search.
+    */
+    inline esp_err_t recover() {
+        ESP_RETURN_ON_ERROR(!page_count ? ESP_ERR_INVALID_ARG : ESP_OK, TAG, "no block range reserved");
+        ESP_RETURN_ON_ERROR(first_block + page_count > device.get_block_count() ? ESP_ERR_INVALID_SIZE : ESP_OK, TAG, "block range past the end of the device");
+
+        queued = 0;
+        flushed = 0;
+        sequence = 0;
+        page_open = false;
+        last_index_page = NO_PAGE;
+        index_count = 0;
+        pages_since_index = 0;
+
+        Page page;
+        uint32_t base;
+
+        if (!read_valid(0, page)) {
+            // Page 0 torn while starting a new lap, the previous lap ends at the last page
+            if (!read_valid(page_count - 1, page))
+                return ESP_OK;
+            sequence = page.header.sequence + 1;
+        } else {
+            base = page.header.sequence;
+
+            uint32_t lo = 0, hi = page_count;
+            while (hi - lo > 1) {
+                const uint32_t mid = lo + (hi - lo) / 2;
+                if (read_valid(mid, page) && page.header.sequence == base + mid)
+                    lo = mid;
+                else
+                    hi = mid;
+            }
+
+            sequence = base + lo + 1;
+        }
+
+        // Only the tail is scanned, for the newest index page
+        for (uint32_t i = 1; i <= INDEX_INTERVAL + 1 && i <= sequence && i <= page_count; i++) {
+            const uint32_t p = page_of(sequence - i);
+            if (!read_valid(p, page))
+                break;
+            if (page.header.type == PAGE_INDEX) {
+                last_index_page = p;
+                break;
+            }
+            pages_since_index++;
+        }
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Page holding time or the nearest earlier point, walking the index chain backwards
+
+        Data pages not yet covered by an index page are not searched.
+    */
+    inline uint32_t find_page(const time_type &time) {
+        Page page;
+        uint32_t index_page = last_index_page;
+        uint32_t found = NO_PAGE;
+
+        uint32_t newer = sequence;
+
+        // Stops at a page overwritten by a later lap, sequences must keep decreasing
+        while (index_page != NO_PAGE) {
+            if (!read_valid(index_page, page) || page.header.type != PAGE_INDEX || page.header.sequence >= newer)
+                break;
+            newer = page.header.sequence;
+
+            const IndexEntry *entries = page.entries();
+            for (int i = page.index().count - 1; i >= 0; i--) {
+                found = entries[i].page;
+                if (entries[i].time <= time)
+                    return found;
+            }
+
+            index_page = page.index().previous;
+        }
+
+        return found;
+    }
+
+    static void flush_task(void *arg) {
+        SegmentLogT *log = (SegmentLogT*)arg;
+
+        while (log->running) {
+            log->flush();
+            // stop() wakes it early
+            ulTaskNotifyTake(pdTRUE, log->flush_period / portTICK_PERIOD_MS);
+        }
+
+        log->task = nullptr;
+        vTaskDelete(nullptr);
+    }
+
+    inline esp_err_t start(const uint32_t &period_ms = SDLOG_FLUSH_PERIOD) {
+        if (task)
+            return ESP_OK;
+        ESP_RETURN_ON_ERROR(!page_count ? ESP_ERR_INVALID_ARG : ESP_OK, TAG, "no block range reserved");
+
+        flush_period = period_ms;
+        running = true;
+
+        if (xTaskCreate(flush_task, "sdlog", 4096, this, tskIDLE_PRIORITY + 1, &task) != pdPASS) {
+            running = false;
+            return ESP_ERR_NO_MEM;
+        }
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Stops the flush task and waits for it, then completes the open page and flushes
+
+        Call on the producer, points pushed before it returns are on the device.
+    */
+    inline esp_err_t stop() {
+        if (task) {
+            running = false;
+            xTaskNotifyGive(task);
+            while (task)
+                delay(1);
+        }
+
+        return sync();
+    }
+};
+
+}
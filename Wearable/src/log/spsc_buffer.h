@@ -0,0 +1,99 @@
+#pragma once
+
+#include "config.h"
+#include "log.h"
+
+#include <inttypes.h>
+#include <atomic>
+
+namespace wbl {
+
+/*
+    @brief Lock-free single-producer/single-consumer log storage
+
+    The producer (a sampling task, possibly on the other core) calls
+    push_back, which only writes into a bounded queue. The consumer (the
+    renderer) calls snapshot() to move queued points into its own History
+    storage and then reads History without any locking. Points pushed while
+    the queue is full are dropped and counted rather than blocking the
+    producer.
+
+    Everything but push_back and dropped belongs to the consumer thread.
+*/
+template<typename T, int LOOP_SIZE = LOG_BUFFER_SIZE, int QUEUE_SIZE = LOG_QUEUE_SIZE, typename History = LoopBufferT<T, LOOP_SIZE>>
+struct SPSCLoopBufferT {
+    static_assert((QUEUE_SIZE & (QUEUE_SIZE - 1)) == 0, "QUEUE_SIZE must be a power of two");
+
+    static constexpr const uint32_t queue_mask = QUEUE_SIZE - 1;
+
+    T queue[QUEUE_SIZE];
+
+    // head is only written by the producer, tail only by the consumer
+    alignas(64) std::atomic<uint32_t> head;
+    alignas(64) std::atomic<uint32_t> tail;
+    std::atomic<uint32_t> dropped;
+
+    History history;
+
+    SPSCLoopBufferT():head(0),tail(0),dropped(0){}
+
+    /*
+        Producer side, returns false when the point was dropped
+    */
+    inline bool push_back(const T &value) {
+        const uint32_t h = head.load(std::memory_order_relaxed);
+
+        if (h - tail.load(std::memory_order_acquire) >= QUEUE_SIZE) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        queue[h & queue_mask] = value;
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    /*
+        Consumer side, number of points waiting in the queue
+    */
+    inline int pending() const {
+        return int(head.load(std::memory_order_acquire) - tail.load(std::memory_order_relaxed));
+    }
+
+    /*
+        Consumer side, moves every queued point into history and returns how many
+    */
+    inline int snapshot() {
+        const uint32_t t = tail.load(std::memory_order_relaxed);
+        const uint32_t h = head.load(std::memory_order_acquire);
+
+        for (uint32_t i = t; i != h; i++)
+            history.push_back(queue[i & queue_mask]);
+
+        tail.store(h, std::memory_order_release);
+
+        return int(h - t);
+    }
+
+    constexpr inline int size() const { return history.size(); }
+
+    constexpr inline int capacity() const { return history.capacity(); }
+
+    inline void clear() {
+        tail.store(head.load(std::memory_order_acquire), std::memory_order_release);
+        history.clear();
+    }
+
+    constexpr inline bool has(const int &pos) const { return history.has(pos); }
+
+    constexpr inline decltype(auto) get(const int &pos) { return history.get(pos); }
+
+    constexpr inline decltype(auto) get(const int &pos) const { return history.get(pos); }
+};
+
+template<typename T, int LOOP_SIZE = LOG_BUFFER_SIZE, int QUEUE_SIZE = LOG_QUEUE_SIZE>
+using SPSCLoopBuffer = SPSCLoopBufferT<T, LOOP_SIZE, QUEUE_SIZE>;
+
+using SPSCDataLog = DataLogT<DataPoint, SPSCLoopBuffer<DataPoint>>;
+
+}
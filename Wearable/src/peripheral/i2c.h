@@ -8,6 +8,7 @@
 #include "esp_check.h"
 #include "esp_types.h"
 #include "esp_timer.h"
+#include "i2c_arbiter.h"
 
 namespace wbl {
 
@@ -20,6 +21,12 @@ struct I2C_BUS {
 
     i2c_master_bus_handle_t bus = 0;
 
+    // One arbiter per bus, shared by every device on it
+    static inline I2CArbiter &arbiter() {
+        static I2CArbiter instance;
+        return instance;
+    }
+
     inline esp_err_t probe(uint16_t device_id) {
         ESP_RETURN_ON_ERROR(i2c_master_probe(bus, device_id, 1000 / portTICK_PERIOD_MS), TAG, "failed to probe device %i", device_id);
 
@@ -42,6 +49,7 @@ struct I2C_BUS {
         };
 
         ESP_RETURN_ON_ERROR(i2c_new_master_bus(&bus_config, &bus), TAG, "i2c_new_master_bus failed");
+        ESP_RETURN_ON_ERROR(arbiter().start(), TAG, "arbiter start failed");
 
         if (bus != nullptr)
             return ESP_OK;
@@ -65,6 +73,19 @@ struct I2C : public BUS {
     i2c_master_dev_handle_t dev = 0;
 
     inline esp_err_t write(const uint8_t *c, const uint8_t n) {
+        // Once the arbiter owns the bus a direct transfer would cut into its queue
+        I2CArbiter &arbiter = BUS::arbiter();
+        if (arbiter.running && xTaskGetCurrentTaskHandle() != arbiter.task && !arbiter.held_by_caller()) {
+            I2CTransaction t;
+            t.dev = dev;
+            t.timeout_ms = I2C_TIMEOUT;
+            t.write_data = c;
+            t.write_size = n;
+            ESP_RETURN_ON_ERROR(arbiter.transfer(t), TAG, "arbiter transfer failed");
+
+            return ESP_OK;
+        }
+
         ESP_RETURN_ON_ERROR(i2c_master_transmit(dev, c, n, I2C_TIMEOUT / portTICK_PERIOD_MS), TAG, "i2c_master_transmit failed");
 
         return ESP_OK;
@@ -106,6 +127,15 @@ struct I2C : public BUS {
         return ESP_OK;
     }
 
+    /*
+        @brief Queues t on the bus arbiter without blocking
+    */
+    inline esp_err_t submit(I2CTransaction &t) {
+        t.dev = dev;
+        t.timeout_ms = I2C_TIMEOUT;
+        return BUS::arbiter().submit(t);
+    }
+
     inline esp_err_t probe() {
         ESP_RETURN_ON_ERROR(BUS::probe(I2C_ADDRESS), TAG, "failed to probe device");
 
@@ -0,0 +1,336 @@
+#pragma once
+
+#include "config.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "driver/i2c_master.h"
+#include "esp_check.h"
+#include "esp_timer.h"
+
+#include <atomic>
+#include <inttypes.h>
+
+namespace wbl {
+
+enum I2CPriority : uint8_t {
+    I2C_PRIORITY_DISPLAY = 0,
+    I2C_PRIORITY_NORMAL = 1,
+    I2C_PRIORITY_SENSOR = 2,
+    I2C_PRIORITIES = 3,
+};
+
+/*
+    @brief One queued bus transfer, owned by the caller until it completes
+
+    A write is described by write_data alone, a read by read_data alone and
+    a write-read sets both. The callback runs on the arbiter task. Callers that want a
+    future instead poll done(), or block in I2CArbiterT::transfer() from a
+    task that is allowed to block.
+*/
+struct I2CTransaction {
+    enum State : uint8_t {
+        IDLE = 0,
+        QUEUED = 1,
+        DONE = 2,
+    };
+
+    i2c_master_dev_handle_t dev = nullptr;
+    const uint8_t *write_data = nullptr;
+    uint16_t write_size = 0;
+    uint8_t *read_data = nullptr;
+    uint16_t read_size = 0;
+    uint8_t priority = I2C_PRIORITY_NORMAL;
+    int timeout_ms = 1000;
+
+    void (*callback)(I2CTransaction &transaction, void *ctx) = nullptr;
+    void *ctx = nullptr;
+
+    std::atomic<uint8_t> state{IDLE};
+    esp_err_t result = ESP_OK;
+    int64_t queued_us = 0;
+    // Set before submit, read by the arbiter once the transfer completes
+    std::atomic<TaskHandle_t> waiter{nullptr};
+
+    inline bool done() const { return state.load(std::memory_order_acquire) == DONE; }
+
+    inline bool busy() const { return state.load(std::memory_order_acquire) == QUEUED; }
+};
+
+/*
+    @brief Serializes every transfer on one I2C bus through a task
+
+    Transactions wait in one queue per priority. The arbiter always takes the
+    highest priority transaction next, so display flushes overtake sensor
+    polls between transfers. submit() never waits for the bus, only for the
+    queue lock, and a full queue is reported as ESP_ERR_NO_MEM.
+*/
+template<int QUEUE_DEPTH = I2C_QUEUE_DEPTH>
+struct I2CArbiterT {
+    static constexpr const char *TAG = "wbl::I2CArbiterT";
+
+    struct Stats {
+        std::atomic<uint32_t> submitted{0}, rejected{0};
+        uint32_t completed = 0, errors = 0;
+        uint32_t completed_by[I2C_PRIORITIES] = {};
+        int64_t busy_us = 0, started_us = 0;
+        int64_t queue_us_total[I2C_PRIORITIES] = {}, queue_us_max[I2C_PRIORITIES] = {};
+
+        // Fraction of time since start() the bus spent transferring
+        inline float utilization(const int64_t &now) const {
+            return now > started_us ? float(busy_us) / float(now - started_us) : 0.0f;
+        }
+
+        inline float queue_us_avg(const uint8_t &priority) const {
+            return completed_by[priority] ? float(queue_us_total[priority]) / completed_by[priority] : 0.0f;
+        }
+    };
+
+    QueueHandle_t queues[I2C_PRIORITIES] = {};
+    SemaphoreHandle_t pending = nullptr;
+    // Held around every queue change, cancel() rebuilds a queue without one transaction
+    SemaphoreHandle_t queue_lock = nullptr;
+    // Held by the arbiter for each transfer, or by a task driving the bus itself
+    SemaphoreHandle_t owner = nullptr;
+    std::atomic<TaskHandle_t> holder{nullptr};
+    TaskHandle_t task = nullptr;
+    volatile bool running = false;
+
+    Stats stats;
+
+    inline esp_err_t submit(I2CTransaction &t) {
+        if (!running || t.priority >= I2C_PRIORITIES || !t.dev)
+            return ESP_ERR_INVALID_STATE;
+
+        uint8_t expected = t.state.load(std::memory_order_acquire);
+        if (expected == I2CTransaction::QUEUED || !t.state.compare_exchange_strong(expected, I2CTransaction::QUEUED))
+            return ESP_ERR_INVALID_STATE;
+
+        t.queued_us = esp_timer_get_time();
+
+        I2CTransaction *ptr = &t;
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        const bool queued = xQueueSend(queues[t.priority], &ptr, 0) == pdTRUE;
+        xSemaphoreGive(queue_lock);
+        if (!queued) {
+            t.state.store(I2CTransaction::IDLE, std::memory_order_release);
+            stats.rejected++;
+            return ESP_ERR_NO_MEM;
+        }
+
+        stats.submitted++;
+        xSemaphoreGive(pending);
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Takes t out of its queue, false if the arbiter already took it
+    */
+    inline bool cancel(I2CTransaction &t) {
+        I2CTransaction *kept[QUEUE_DEPTH];
+        int count = 0;
+        bool found = false;
+
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        QueueHandle_t queue = queues[t.priority];
+        while (count < QUEUE_DEPTH && xQueueReceive(queue, &kept[count], 0) == pdTRUE) {
+            if (kept[count] == &t)
+                found = true;
+            else
+                count++;
+        }
+        for (int i = 0; i < count; i++)
+            xQueueSend(queue, &kept[i], 0);
+        if (found)
+            t.state.store(I2CTransaction::IDLE, std::memory_order_release);
+        xSemaphoreGive(queue_lock);
+
+        return found;
+    }
+
+    /*
+        @brief Blocks the calling task until t completes, never call from the UI task
+
+        t must have been submitted by transfer(), which names the waiter
+        before the arbiter can see t. On a timeout t is taken out of its
+        queue so the caller may free it. One already on the bus is waited
+        for, its own timeout_ms bounds it.
+    */
+    inline esp_err_t wait(I2CTransaction &t, const TickType_t &ticks = portMAX_DELAY) {
+        ESP_RETURN_ON_FALSE(t.waiter.load(std::memory_order_relaxed) == xTaskGetCurrentTaskHandle(), ESP_ERR_INVALID_STATE, TAG, "not waiting on t");
+
+        while (!t.done()) {
+            if (ulTaskNotifyTake(pdTRUE, ticks))
+                continue;
+
+            if (cancel(t)) {
+                t.waiter.store(nullptr, std::memory_order_relaxed);
+                return ESP_ERR_TIMEOUT;
+            }
+
+            while (!t.done())
+                ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        }
+
+        t.waiter.store(nullptr, std::memory_order_relaxed);
+
+        return t.result;
+    }
+
+    inline esp_err_t transfer(I2CTransaction &t, const TickType_t &ticks = portMAX_DELAY) {
+        t.waiter.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+
+        const esp_err_t err = submit(t);
+        if (err != ESP_OK)
+            t.waiter.store(nullptr, std::memory_order_relaxed);
+        ESP_RETURN_ON_ERROR(err, TAG, "submit failed");
+
+        return wait(t, ticks);
+    }
+
+    /*
+        @brief Keeps the arbiter off the bus while the calling task drives it directly
+
+        Meant for a batch of short transfers, e.g. the sensor reads SamplerT
+        coalesces. Queued transfers wait until release(). Before start()
+        nothing else uses the bus and this returns at once.
+    */
+    inline esp_err_t acquire(const TickType_t &ticks = portMAX_DELAY) {
+        if (!running)
+            return ESP_OK;
+        if (xSemaphoreTake(owner, ticks) != pdTRUE)
+            return ESP_ERR_TIMEOUT;
+
+        holder.store(xTaskGetCurrentTaskHandle(), std::memory_order_release);
+        return ESP_OK;
+    }
+
+    inline void release() {
+        if (holder.load(std::memory_order_acquire) != xTaskGetCurrentTaskHandle())
+            return;
+
+        holder.store(nullptr, std::memory_order_release);
+        xSemaphoreGive(owner);
+    }
+
+    inline bool held_by_caller() const {
+        return holder.load(std::memory_order_acquire) == xTaskGetCurrentTaskHandle();
+    }
+
+    // For SamplerT::set_bus, ctx is the arbiter
+    static esp_err_t acquire_bus(void *ctx) {
+        return ((I2CArbiterT*)ctx)->acquire();
+    }
+
+    static void release_bus(void *ctx) {
+        ((I2CArbiterT*)ctx)->release();
+    }
+
+    inline I2CTransaction *next() {
+        I2CTransaction *t = nullptr;
+
+        xSemaphoreTake(queue_lock, portMAX_DELAY);
+        for (uint8_t p = 0; p < I2C_PRIORITIES; p++)
+            if (xQueueReceive(queues[p], &t, 0) == pdTRUE)
+                break;
+        xSemaphoreGive(queue_lock);
+
+        return t;
+    }
+
+    inline void execute(I2CTransaction &t) {
+        xSemaphoreTake(owner, portMAX_DELAY);
+
+        const int64_t start = esp_timer_get_time();
+        const int64_t queued = start - t.queued_us;
+
+        if (t.read_data && !t.write_size)
+            t.result = i2c_master_receive(t.dev, t.read_data, t.read_size, t.timeout_ms);
+        else if (t.read_data)
+            t.result = i2c_master_transmit_receive(t.dev, t.write_data, t.write_size, t.read_data, t.read_size, t.timeout_ms);
+        else
+            t.result = i2c_master_transmit(t.dev, t.write_data, t.write_size, t.timeout_ms);
+
+        xSemaphoreGive(owner);
+
+        stats.busy_us += esp_timer_get_time() - start;
+        stats.completed++;
+        stats.completed_by[t.priority]++;
+        stats.queue_us_total[t.priority] += queued;
+        if (queued > stats.queue_us_max[t.priority])
+            stats.queue_us_max[t.priority] = queued;
+        if (t.result != ESP_OK)
+            stats.errors++;
+
+        // A polling caller may free t once it is DONE, and the callback may resubmit it, read it all first
+        TaskHandle_t waiter = t.waiter.load(std::memory_order_acquire);
+        void (*callback)(I2CTransaction &transaction, void *ctx) = t.callback;
+        void *ctx = t.ctx;
+        t.state.store(I2CTransaction::DONE, std::memory_order_release);
+
+        if (callback)
+            callback(t, ctx);
+
+        if (waiter)
+            xTaskNotifyGive(waiter);
+    }
+
+    static void arbiter_task(void *arg) {
+        I2CArbiterT *arbiter = (I2CArbiterT*)arg;
+
+        while (arbiter->running) {
+            if (xSemaphoreTake(arbiter->pending, 100 / portTICK_PERIOD_MS) != pdTRUE)
+                continue;
+
+            I2CTransaction *t = arbiter->next();
+            if (t)
+                arbiter->execute(*t);
+        }
+
+        arbiter->task = nullptr;
+        vTaskDelete(nullptr);
+    }
+
+    inline esp_err_t start(const BaseType_t &core = tskNO_AFFINITY) {
+        if (task)
+            return ESP_OK;
+
+        for (uint8_t p = 0; p < I2C_PRIORITIES; p++) {
+            if (!queues[p])
+                queues[p] = xQueueCreate(QUEUE_DEPTH, sizeof(I2CTransaction*));
+            ESP_RETURN_ON_FALSE(queues[p], ESP_ERR_NO_MEM, TAG, "xQueueCreate failed");
+        }
+
+        if (!pending)
+            pending = xSemaphoreCreateCounting(QUEUE_DEPTH * I2C_PRIORITIES, 0);
+        ESP_RETURN_ON_FALSE(pending, ESP_ERR_NO_MEM, TAG, "xSemaphoreCreateCounting failed");
+
+        if (!owner)
+            owner = xSemaphoreCreateMutex();
+        ESP_RETURN_ON_FALSE(owner, ESP_ERR_NO_MEM, TAG, "xSemaphoreCreateMutex failed");
+
+        if (!queue_lock)
+            queue_lock = xSemaphoreCreateMutex();
+        ESP_RETURN_ON_FALSE(queue_lock, ESP_ERR_NO_MEM, TAG, "xSemaphoreCreateMutex failed");
+
+        stats.started_us = esp_timer_get_time();
+        running = true;
+
+        if (xTaskCreatePinnedToCore(arbiter_task, "i2c", 4096, this, configMAX_PRIORITIES - 2, &task, core) != pdPASS) {
+            running = false;
+            return ESP_ERR_NO_MEM;
+        }
+
+        return ESP_OK;
+    }
+
+    inline void stop() {
+        running = false;
+    }
+};
+
+using I2CArbiter = I2CArbiterT<>;
+
+}
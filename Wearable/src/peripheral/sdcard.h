@@ -0,0 +1,62 @@
+#pragma once
+
+#include "config.h"
+#include "driver/sdmmc_host.h"
+#include "sdmmc_cmd.h"
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include <inttypes.h>
+
+namespace wbl {
+
+/*
+    @brief SD card in 1-bit SD mode, addressed as raw 512 byte blocks
+*/
+template<gpio_num_t _CLK, gpio_num_t _CMD, gpio_num_t _D0>
+struct SDCardT {
+    static constexpr const char *TAG = "wbl::SDCardT";
+    static constexpr const uint32_t BLOCK_SIZE = 512;
+
+    sdmmc_card_t card = {};
+    bool ready = false;
+
+    inline esp_err_t init() {
+        if (ready)
+            return ESP_OK;
+
+        sdmmc_host_t host = SDMMC_HOST_DEFAULT();
+        sdmmc_slot_config_t slot = SDMMC_SLOT_CONFIG_DEFAULT();
+        slot.width = 1;
+        slot.clk = _CLK;
+        slot.cmd = _CMD;
+        slot.d0 = _D0;
+        slot.flags |= SDMMC_SLOT_FLAG_INTERNAL_PULLUP;
+
+        ESP_RETURN_ON_ERROR(sdmmc_host_init(), TAG, "sdmmc_host_init failed");
+        ESP_RETURN_ON_ERROR(sdmmc_host_init_slot(host.slot, &slot), TAG, "sdmmc_host_init_slot failed");
+        ESP_RETURN_ON_ERROR(sdmmc_card_init(&host, &card), TAG, "sdmmc_card_init failed");
+
+        ready = true;
+
+        return ESP_OK;
+    }
+
+    inline uint32_t get_block_count() const { return ready ? card.csd.capacity : 0; }
+
+    inline esp_err_t read_blocks(const uint32_t &block, void *dst, const uint32_t &count) {
+        ESP_RETURN_ON_ERROR(sdmmc_read_sectors(&card, dst, block, count), TAG, "sdmmc_read_sectors failed");
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t write_blocks(const uint32_t &block, const void *src, const uint32_t &count) {
+        ESP_RETURN_ON_ERROR(sdmmc_write_sectors(&card, src, block, count), TAG, "sdmmc_write_sectors failed");
+
+        return ESP_OK;
+    }
+};
+
+using SDCard = SDCardT<SDCARD_CLK, SDCARD_CMD, SDCARD_D0>;
+
+}
@@ -0,0 +1,200 @@
+#pragma once
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "driver/spi_master.h"
+#include "driver/gpio.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+namespace wbl {
+
+template<spi_host_device_t _HOST, gpio_num_t _MOSI, gpio_num_t _SCLK, int _MAX_TRANSFER>
+struct SPI_BUS {
+    static constexpr const char *TAG = "wbl::SPI_BUS";
+    static constexpr spi_host_device_t HOST = _HOST;
+    static constexpr int MAX_TRANSFER = _MAX_TRANSFER;
+
+    // One per host, shared by every device on it
+    static inline bool &initialized() {
+        static bool instance = false;
+        return instance;
+    }
+
+    inline esp_err_t init() {
+        if (initialized())
+            return ESP_OK;
+
+        spi_bus_config_t bus_config = {};
+        bus_config.mosi_io_num = _MOSI;
+        bus_config.miso_io_num = -1;
+        bus_config.sclk_io_num = _SCLK;
+        bus_config.quadwp_io_num = -1;
+        bus_config.quadhd_io_num = -1;
+        bus_config.max_transfer_sz = MAX_TRANSFER;
+
+        ESP_RETURN_ON_ERROR(spi_bus_initialize(HOST, &bus_config, SPI_DMA_CH_AUTO), TAG, "spi_bus_initialize failed");
+
+        initialized() = true;
+
+        return ESP_OK;
+    }
+};
+
+/*
+    @brief Write-only SPI device with a D/C line, as used by display controllers
+
+    Commands go out as polling transfers. Data can be queued for DMA, up to
+    QUEUE transfers are in flight and complete in order. Each transfer
+    carries its D/C level, set right before it starts.
+*/
+template<gpio_num_t _CS, gpio_num_t _DC, gpio_num_t _RST, uint32_t _CLOCK, typename BUS, uint8_t _QUEUE=2>
+struct SPI_DC : public BUS {
+    static constexpr const char *TAG = "wbl::SPI_DC";
+    static constexpr gpio_num_t DC = _DC;
+    static constexpr gpio_num_t RST = _RST;
+    static constexpr uint32_t CLOCK = _CLOCK;
+    static constexpr uint8_t QUEUE = _QUEUE;
+
+    spi_device_handle_t dev = nullptr;
+    spi_transaction_t transactions[QUEUE] = {};
+    uint8_t queued = 0, next = 0;
+
+    static void IRAM_ATTR pre_transfer(spi_transaction_t *t) {
+        gpio_set_level(DC, int(intptr_t(t->user)));
+    }
+
+    inline esp_err_t init() {
+        ESP_RETURN_ON_ERROR(BUS::init(), TAG, "spi_bus init failed");
+
+        if (dev != nullptr)
+            return ESP_OK;
+
+        gpio_config_t io = {};
+        io.pin_bit_mask = (1ULL << DC) | (RST != GPIO_NUM_NC ? 1ULL << RST : 0);
+        io.mode = GPIO_MODE_OUTPUT;
+        ESP_RETURN_ON_ERROR(gpio_config(&io), TAG, "gpio_config failed");
+
+        if (RST != GPIO_NUM_NC) {
+            gpio_set_level(RST, 0);
+            vTaskDelay(1);
+            gpio_set_level(RST, 1);
+            vTaskDelay(1);
+        }
+
+        spi_device_interface_config_t dev_config = {};
+        dev_config.mode = 0;
+        dev_config.clock_speed_hz = CLOCK;
+        dev_config.spics_io_num = _CS;
+        dev_config.queue_size = QUEUE;
+        dev_config.pre_cb = pre_transfer;
+
+        ESP_RETURN_ON_ERROR(spi_bus_add_device(BUS::HOST, &dev_config, &dev), TAG, "spi_bus_add_device failed");
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Blocking transfer, waits for queued data first since the two can not overlap
+    */
+    inline esp_err_t transmit(const uint8_t *data, const size_t &size, const bool &dc) {
+        ESP_RETURN_ON_ERROR(wait_all(), TAG, "wait_all failed");
+
+        spi_transaction_t t = {};
+        t.length = size * 8;
+        t.tx_buffer = data;
+        t.user = (void*)intptr_t(dc);
+        ESP_RETURN_ON_ERROR(spi_device_polling_transmit(dev, &t), TAG, "spi_device_polling_transmit failed");
+
+        return ESP_OK;
+    }
+
+    template<typename ...T>
+    inline esp_err_t write_command(const uint8_t &c, const T&... arguments) {
+        ESP_RETURN_ON_ERROR(transmit(&c, 1, false), TAG, "write_command failed");
+
+        if constexpr (sizeof...(arguments) > 0) {
+            const uint8_t buf[] = {uint8_t(arguments)...};
+            ESP_RETURN_ON_ERROR(transmit(buf, sizeof(buf), true), TAG, "write_command arguments failed");
+        }
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Sends a table of commands, count(c) arguments follow each command byte
+    */
+    template<typename COUNT>
+    inline esp_err_t write_commands(const uint8_t *c, const size_t &n, COUNT count) {
+        for (size_t i = 0; i < n;) {
+            const uint8_t args = count(c[i]);
+            ESP_RETURN_ON_ERROR(transmit(&c[i], 1, false), TAG, "write_commands failed");
+            if (args)
+                ESP_RETURN_ON_ERROR(transmit(&c[i + 1], args, true), TAG, "write_commands arguments failed");
+            i += 1 + args;
+        }
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t wait_one() {
+        if (!queued)
+            return ESP_OK;
+
+        spi_transaction_t *done;
+        ESP_RETURN_ON_ERROR(spi_device_get_trans_result(dev, &done, portMAX_DELAY), TAG, "spi_device_get_trans_result failed");
+        queued--;
+
+        return ESP_OK;
+    }
+
+    inline esp_err_t wait_all() {
+        while (queued)
+            ESP_RETURN_ON_ERROR(wait_one(), TAG, "wait_one failed");
+
+        return ESP_OK;
+    }
+
+    // Waits until another transfer can be queued, the oldest buffer is free again after this
+    inline esp_err_t wait_slot() {
+        if (queued == QUEUE)
+            ESP_RETURN_ON_ERROR(wait_one(), TAG, "wait_one failed");
+
+        return ESP_OK;
+    }
+
+    /*
+        @brief Queues data for DMA with D/C high, data must stay untouched until its slot is waited for
+    */
+    inline esp_err_t queue_data(const uint8_t *data, const size_t &size) {
+        ESP_RETURN_ON_ERROR(wait_slot(), TAG, "wait_slot failed");
+
+        spi_transaction_t &t = transactions[next];
+        t = {};
+        t.length = size * 8;
+        t.tx_buffer = data;
+        t.user = (void*)intptr_t(1);
+        ESP_RETURN_ON_ERROR(spi_device_queue_trans(dev, &t, portMAX_DELAY), TAG, "spi_device_queue_trans failed");
+
+        next = (next + 1) % QUEUE;
+        queued++;
+
+        return ESP_OK;
+    }
+
+    // Reaps finished transfers without waiting
+    inline bool busy() {
+        spi_transaction_t *done;
+        while (queued && spi_device_get_trans_result(dev, &done, 0) == ESP_OK)
+            queued--;
+        return queued;
+    }
+};
+
+using SPI_BUS_2 = SPI_BUS<SPI2_HOST, GPIO_NUM_38, GPIO_NUM_39, 4096>;
+
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include "config.h"
+#include "freertos/FreeRTOS.h"
+#include "driver/uart.h"
+#include "esp_log.h"
+#include "esp_check.h"
+
+#include <inttypes.h>
+#include <stddef.h>
+
+namespace wbl {
+
+/*
+    @brief 8N1 UART with a driver owned TX ring buffer
+
+    write() only blocks when the ring buffer is full, callers that must not
+    wait check writable() first.
+*/
+template<uart_port_t _PORT, gpio_num_t _TX, gpio_num_t _RX, int _BAUD, int _TX_BUFFER>
+struct UartT {
+    static constexpr const char *TAG = "wbl::UartT";
+    static constexpr uart_port_t PORT = _PORT;
+    static constexpr int RX_BUFFER = 256;
+
+    bool ready = false;
+
+    inline esp_err_t init() {
+        if (ready)
+            return ESP_OK;
+
+        const uart_config_t config = {
+            .baud_rate = _BAUD,
+            .data_bits = UART_DATA_8_BITS,
+            .parity = UART_PARITY_DISABLE,
+            .stop_bits = UART_STOP_BITS_1,
+            .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+            .source_clk = UART_SCLK_DEFAULT,
+        };
+
+        ESP_RETURN_ON_ERROR(uart_driver_install(PORT, RX_BUFFER, _TX_BUFFER, 0, nullptr, 0), TAG, "uart_driver_install failed");
+        ESP_RETURN_ON_ERROR(uart_param_config(PORT, &config), TAG, "uart_param_config failed");
+        ESP_RETURN_ON_ERROR(uart_set_pin(PORT, _TX, _RX, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE), TAG, "uart_set_pin failed");
+
+        ready = true;
+
+        return ESP_OK;
+    }
+
+    inline size_t writable() const {
+        size_t free = 0;
+        if (!ready || uart_get_tx_buffer_free_size(PORT, &free) != ESP_OK)
+            return 0;
+        return free;
+    }
+
+    inline int write(const uint8_t *data, const size_t &size) {
+        return ready ? uart_write_bytes(PORT, data, size) : -1;
+    }
+
+    inline int read(uint8_t *data, const size_t &size, const uint32_t &timeout_ms = 0) {
+        return ready ? uart_read_bytes(PORT, data, size, timeout_ms / portTICK_PERIOD_MS) : -1;
+    }
+};
+
+using MirrorUart = UartT<UART_NUM_1, GPIO_NUM_1, GPIO_NUM_2, SCREEN_MIRROR_BAUD, SCREEN_MIRROR_TX_BUFFER>;
+
+}
@@ -0,0 +1,695 @@
+#pragma once
+
+#include "config.h"
+#include "texture.h"
+#include "surface.h"
+#include "ui.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+
+namespace wbl {
+
+enum DisplayOp : ub {
+    DL_NONE = 0,
+    DL_FILL,
+    DL_BORDER,
+    DL_PIXEL,
+    DL_VSPAN,
+    DL_LINE,
+    DL_CIRCLE,
+    DL_STROKE,
+    DL_SPRITE,
+    DL_SERIES,
+    DL_ENVELOPE,
+    DL_OPS,
+};
+
+// Template arguments of the line, circle and stroke kernels, two bits each
+enum DisplayType : ub {
+    DT_FLOAT = 0,
+    DT_SHORT = 1,
+    DT_FB = 2,
+    DT_INT = 3,
+};
+
+template<typename T>
+inline constexpr ub display_type() {
+    if constexpr (std::is_same_v<T, float>)
+        return DT_FLOAT;
+    else if constexpr (std::is_same_v<T, short>)
+        return DT_SHORT;
+    else if constexpr (std::is_same_v<T, fb>)
+        return DT_FB;
+    else {
+        static_assert(std::is_same_v<T, int>, "Recorded kernels take float, short, fb or int");
+        return DT_INT;
+    }
+}
+
+template<typename calc, typename IType, typename FType = float>
+inline constexpr ub display_types() {
+    return display_type<calc>() | (display_type<IType>() << 2) | (display_type<FType>() << 4);
+}
+
+template<typename Fn>
+inline constexpr void with_display_type(const ub &code, Fn &&fn) {
+    switch (code & 3) {
+        case DT_FLOAT: fn.template operator()<float>(); return;
+        case DT_SHORT: fn.template operator()<short>(); return;
+        case DT_FB: fn.template operator()<fb>(); return;
+        default: fn.template operator()<int>(); return;
+    }
+}
+
+/*
+    @brief One recorded draw call
+
+    Coordinates are whole pixels. Series and envelopes are followed by their
+    values as shorts, padded to a word. Commands hold no pointers, sprites
+    name their source by registration index, so lists copy and serialize as
+    they are.
+*/
+struct DisplayCommand {
+    DisplayOp op;
+    pixel px;
+    // display_types() of the kernel, the source index for sprites
+    ub variant;
+    // Fill for circles, SeriesStyle for series
+    ub flags;
+    // Pixels are runs of c along a row, d apart
+    short a, b, c, d, e, f;
+    // Radius or stroke width
+    float w;
+
+    inline constexpr fb getPayload() const {
+        switch (op) {
+            case DL_SERIES: return (d * 2 + 3) & ~3;
+            case DL_ENVELOPE: return d * 4;
+            default: return 0;
+        }
+    }
+
+    inline const short *getValues() const {
+        return (const short*)(this + 1);
+    }
+
+    /*
+        @brief Conservative bounds of what the command draws, false when it cannot touch rect
+    */
+    inline constexpr bool touches(const Size &rect) const {
+        int left = a, top = b, right = a + 1, bottom = b + 1;
+        const int grow = int(w) + 1;
+
+        switch (op) {
+            case DL_FILL:
+                right = c;
+                bottom = d;
+                break;
+            case DL_BORDER:
+                right = a + c;
+                bottom = b + d;
+                break;
+            case DL_PIXEL:
+                right = a + (c - 1) * d + 1;
+                break;
+            case DL_VSPAN:
+                top = b < c ? b : c;
+                bottom = (b < c ? c : b) + 1;
+                break;
+            case DL_LINE:
+            case DL_STROKE:
+                left = a < c ? a : c;
+                top = b < d ? b : d;
+                right = (a < c ? c : a) + 1;
+                bottom = (b < d ? d : b) + 1;
+                if (op == DL_STROKE) {
+                    left -= grow;
+                    top -= grow;
+                    right += grow;
+                    bottom += grow;
+                }
+                break;
+            case DL_CIRCLE:
+                left = a - grow;
+                top = b - grow;
+                right = a + grow;
+                bottom = b + grow;
+                break;
+            case DL_SPRITE:
+                left = e;
+                top = f;
+                right = e + c;
+                bottom = f + d;
+                break;
+            case DL_SERIES:
+            case DL_ENVELOPE:
+                right = a + d;
+                top = 0;
+                bottom = 0x7fff;
+                break;
+            default:
+                break;
+        }
+
+        return left < rect.getRight() && int(rect.x) < right && top < rect.getBottom() && int(rect.y) < bottom;
+    }
+};
+
+static_assert(sizeof(DisplayCommand) == 20, "Commands are packed into lists back to back");
+
+/*
+    @brief Frame restricted to a damage rect, pixels outside it are left alone
+*/
+template<typename Frame>
+struct DamageT : public BufferRefT<Frame> {
+    Size rect;
+
+    constexpr DamageT(Frame &frame, const Size &rect):BufferRefT<Frame>(frame),rect(rect) { }
+
+    inline constexpr fb getClipTop() const {
+        const fb top = this->buffer.getClipTop();
+        return rect.y > top ? rect.y : top;
+    }
+
+    inline constexpr fb getClipBottom() const {
+        const fb bottom = this->buffer.getClipBottom();
+        return rect.getBottom() < bottom ? rect.getBottom() : bottom;
+    }
+
+    inline constexpr fb getValueBits() const {
+        return this->buffer.getValueBits();
+    }
+
+    inline constexpr fb getAlphaTest() const {
+        return this->buffer.getAlphaTest();
+    }
+
+    inline constexpr void putPixel(const fb &x, const fb &y, const pixel &px) {
+        if (rect.isBound(x, y))
+            this->buffer.putPixel(x, y, px);
+    }
+
+    inline constexpr void putPixel(const Origin &pos, const pixel &px) {
+        putPixel(pos.x, pos.y, px);
+    }
+
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        if (x < rect.x || x >= rect.getRight())
+            return;
+
+        const fb top = y0 > rect.y ? y0 : rect.y;
+        const fb bottom = y1 < rect.getBottom() - 1 ? y1 : rect.getBottom() - 1;
+        if (top <= bottom)
+            this->buffer.putVSpan(x, top, bottom, px);
+    }
+};
+
+/*
+    @brief Replay kernels for Target, filled in as lists are recorded or deserialized
+
+    Templated kernels are looked up by op and display_types(), sprite sources
+    by the order they were first drawn in.
+*/
+template<typename Target>
+struct DisplayReplayT {
+    using Kernel = void (*)(Target &target, const DisplayCommand &command);
+    using SourceKernel = void (*)(Target &target, const void *src, const DisplayCommand &command);
+
+    struct Source {
+        const void *src;
+        SourceKernel kernel;
+    };
+
+    static inline Kernel kernels[3][64];
+    static inline Source sources[DISPLAY_LIST_SOURCES];
+    static inline fb source_count = 0;
+
+    template<DisplayOp op, typename calc, typename IType, typename FType>
+    static void kernel(Target &t, const DisplayCommand &c) {
+        if constexpr (op == DL_LINE)
+            t.template line<calc,IType>(IType(c.a), IType(c.b), IType(c.c), IType(c.d), c.px);
+        else if constexpr (op == DL_CIRCLE)
+            t.template circle<calc,IType,FType>(IType(c.a), IType(c.b), FType(c.w), c.px, c.flags);
+        else
+            t.template stroke_line<calc,IType,FType>(IType(c.a), IType(c.b), IType(c.c), IType(c.d), FType(c.w), c.px);
+    }
+
+    template<typename Source>
+    static void sprite_kernel(Target &t, const void *src, const DisplayCommand &c) {
+        t.putTexture((const Source*)src, Size(fb(c.a), fb(c.b), fb(c.c), fb(c.d)), Origin(fb(c.e), fb(c.f)));
+    }
+
+    template<DisplayOp op, typename calc, typename IType, typename FType = float>
+    static inline ub enable() {
+        constexpr ub code = display_types<calc,IType,FType>();
+        kernels[op - DL_LINE][code] = &kernel<op,calc,IType,FType>;
+        return code;
+    }
+
+    // Instantiates every combination, only lists from elsewhere need it
+    static inline void enable(const DisplayOp &op, const ub &code) {
+        with_display_type(code, [&]<typename calc>() {
+            with_display_type(code >> 2, [&]<typename IType>() {
+                with_display_type(code >> 4, [&]<typename FType>() {
+                    switch (op) {
+                        case DL_LINE: enable<DL_LINE,calc,IType,FType>(); return;
+                        case DL_CIRCLE: enable<DL_CIRCLE,calc,IType,FType>(); return;
+                        default: enable<DL_STROKE,calc,IType,FType>(); return;
+                    }
+                });
+            });
+        });
+    }
+
+    /*
+        @brief Index of src, registering it on first use. -1 when the table is full
+    */
+    template<typename Source>
+    static inline int source_index(const Source *src) {
+        for (fb i = 0; i < source_count; i++)
+            if (sources[i].src == src)
+                return i;
+
+        if (source_count >= DISPLAY_LIST_SOURCES)
+            return -1;
+
+        sources[source_count] = { src, &sprite_kernel<Source> };
+        return source_count++;
+    }
+
+    static inline void run(Target &t, const DisplayCommand &c) {
+        switch (c.op) {
+            case DL_FILL: t.fill(fb(c.a), fb(c.b), fb(c.c), fb(c.d), c.px); return;
+            case DL_BORDER: t.border(Size(fb(c.a), fb(c.b), fb(c.c), fb(c.d)), c.px); return;
+            case DL_PIXEL:
+                for (short i = 0; i < c.c; i++)
+                    t.putPixelBound(fb(c.a + i * c.d), fb(c.b), c.px);
+                return;
+            case DL_VSPAN: t.vspan(fb(c.a), fb(c.b), fb(c.c), c.px); return;
+            case DL_LINE:
+            case DL_CIRCLE:
+            case DL_STROKE:
+                kernels[c.op - DL_LINE][c.variant](t, c);
+                return;
+            case DL_SPRITE:
+                sources[c.variant].kernel(t, sources[c.variant].src, c);
+                return;
+            case DL_SERIES:
+                t.series(c.getValues(), fb(c.d), Origin(fb(c.a), fb(c.b)), fb(c.c), c.px, SeriesStyle(c.flags));
+                return;
+            case DL_ENVELOPE:
+                t.series_envelope(c.getValues(), c.getValues() + c.d, fb(c.d), Origin(fb(c.a), fb(c.b)), c.px);
+                return;
+            default:
+                return;
+        }
+    }
+
+    /*
+        @brief Runs the commands of list that can touch rect, target clips to it
+    */
+    static inline void replay(Target &t, const pixel *list, const fb &bytes, const Size &rect) {
+        for (fb offset = 0; offset < bytes;) {
+            const DisplayCommand &c = *(const DisplayCommand*)(list + offset);
+            if (c.touches(rect))
+                run(t, c);
+            offset += sizeof(DisplayCommand) + c.getPayload();
+        }
+    }
+
+    static constexpr pixel HEADER[4] = { 'D', 'L', 1, 0 };
+
+    /*
+        @brief Copies a list out behind a header, 0 when it does not fit
+
+        Sprite indices only mean the same thing to a reader that registered
+        the same sources in the same order. Both ends are little endian.
+    */
+    static inline fb serialize(const pixel *list, const fb &bytes, pixel *out, const fb &capacity) {
+        if (bytes + sizeof(HEADER) > capacity)
+            return 0;
+
+        memcpy(out, HEADER, sizeof(HEADER));
+        memcpy(out + sizeof(HEADER), list, bytes);
+
+        return bytes + sizeof(HEADER);
+    }
+
+    /*
+        @brief Checks a serialized list and enables its kernels, returns the list length or 0
+    */
+    static inline fb deserialize(const pixel *in, const fb &bytes, pixel *list, const fb &capacity) {
+        if (bytes < sizeof(HEADER) || memcmp(in, HEADER, sizeof(HEADER)) || bytes - sizeof(HEADER) > capacity)
+            return 0;
+
+        const fb length = bytes - sizeof(HEADER);
+        memcpy(list, in + sizeof(HEADER), length);
+
+        for (fb offset = 0; offset < length;) {
+            if (length - offset < sizeof(DisplayCommand))
+                return 0;
+
+            const DisplayCommand &c = *(const DisplayCommand*)(list + offset);
+            if (c.op == DL_NONE || c.op >= DL_OPS || length - offset - sizeof(DisplayCommand) < c.getPayload())
+                return 0;
+
+            if (c.op == DL_SPRITE && c.variant >= source_count)
+                return 0;
+
+            if (c.op == DL_LINE || c.op == DL_CIRCLE || c.op == DL_STROKE) {
+                if (c.variant >= 64)
+                    return 0;
+                enable(c.op, c.variant);
+            }
+
+            offset += sizeof(DisplayCommand) + c.getPayload();
+        }
+
+        return length;
+    }
+};
+
+/*
+    @brief Texture that records draws into a display list while passing them on to Texture
+
+    Mirrors the TextureT calls elements make. The list is built in a shared
+    scratch buffer between begin and end, a list that outgrows it or draws
+    an unregistered sprite source is dropped.
+*/
+template<typename Texture>
+struct DisplayRecorderT : public BufferRefT<Texture> {
+    using Target = TextureT<DamageT<Texture>>;
+    using Replay = DisplayReplayT<Target>;
+
+    alignas(4) static inline pixel scratch[DISPLAY_LIST_SCRATCH];
+
+    fb length = 0, last = 0;
+    bool recording = false, overflowed = false;
+
+    constexpr DisplayRecorderT(Texture &texture):BufferRefT<Texture>(texture) { }
+
+    inline void begin() {
+        length = 0;
+        recording = true;
+        overflowed = false;
+    }
+
+    inline void end() {
+        recording = false;
+    }
+
+    inline DisplayCommand *push(const DisplayOp &op, const pixel &px, const fb &payload = 0) {
+        if (!recording || overflowed)
+            return nullptr;
+
+        if (length + sizeof(DisplayCommand) + payload > DISPLAY_LIST_SCRATCH) {
+            overflowed = true;
+            return nullptr;
+        }
+
+        DisplayCommand *c = (DisplayCommand*)(scratch + length);
+        *c = { op, px };
+        last = length;
+        length += sizeof(DisplayCommand) + payload;
+
+        return c;
+    }
+
+    inline fb getValueBits() const {
+        return this->buffer.getValueBits();
+    }
+
+    inline fb getAlphaTest() const {
+        return this->buffer.getAlphaTest();
+    }
+
+    inline void clear(const pixel &px = 0) {
+        this->buffer.clear(px);
+        if (DisplayCommand *c = push(DL_FILL, px)) {
+            c->c = this->getWidth();
+            c->d = this->getHeight();
+        }
+    }
+
+    inline void fill(const fb &x0, const fb &y0, const fb &x1, const fb &y1, const pixel &px) {
+        this->buffer.fill(x0, y0, x1, y1, px);
+        if (DisplayCommand *c = push(DL_FILL, px)) {
+            c->a = x0;
+            c->b = y0;
+            c->c = x1;
+            c->d = y1;
+        }
+    }
+
+    inline void fill(const Size &size, const pixel &px) {
+        fill(size.x, size.y, size.x + size.width, size.y + size.height, px);
+    }
+
+    inline void border(const Size &size, const pixel &px) {
+        this->buffer.border(size, px);
+        if (DisplayCommand *c = push(DL_BORDER, px)) {
+            c->a = size.x;
+            c->b = size.y;
+            c->c = size.width;
+            c->d = size.height;
+        }
+    }
+
+    inline void putPixel(const fb &x, const fb &y, const pixel &px) {
+        this->buffer.putPixel(x, y, px);
+
+        // Dotted and solid rows extend the previous run
+        DisplayCommand *prev = (DisplayCommand*)(scratch + last);
+        if (recording && !overflowed && length && prev->op == DL_PIXEL && prev->px == px && prev->b == short(y)) {
+            const short step = short(x) - (prev->a + (prev->c - 1) * prev->d);
+            if (prev->c == 1 && step > 0)
+                prev->d = step;
+            if (step > 0 && step == prev->d) {
+                prev->c++;
+                return;
+            }
+        }
+
+        if (DisplayCommand *c = push(DL_PIXEL, px)) {
+            c->a = x;
+            c->b = y;
+            c->c = 1;
+            c->d = 1;
+        }
+    }
+
+    inline void putPixel(const Origin &pos, const pixel &px) {
+        putPixel(pos.x, pos.y, px);
+    }
+
+    inline void vspan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        this->buffer.vspan(x, y0, y1, px);
+        if (DisplayCommand *c = push(DL_VSPAN, px)) {
+            c->a = x;
+            c->b = y0;
+            c->c = y1;
+        }
+    }
+
+    template<typename calc=short, typename IType=fb>
+    inline void line(const IType &x1, const IType &y1, const IType &x2, const IType &y2, const pixel &px) {
+        this->buffer.template line<calc,IType>(x1, y1, x2, y2, px);
+        if (DisplayCommand *c = push(DL_LINE, px)) {
+            c->variant = Replay::template enable<DL_LINE,calc,IType>();
+            c->a = x1;
+            c->b = y1;
+            c->c = x2;
+            c->d = y2;
+        }
+    }
+
+    inline void line(const Origin &start, const Origin &end, const pixel &px) {
+        line(start.x, start.y, end.x, end.y, px);
+    }
+
+    template<typename calc=short, typename FType=fb, typename ORIGIN_T=Origin, typename IType= typename ORIGIN_T::value_type>
+    inline void circle(const ORIGIN_T &center, const FType &radius, const pixel &px, const bool fill=true) {
+        circle<calc,IType,FType>(center.x, center.y, radius, px, fill);
+    }
+
+    template<typename calc=short,typename IType=fb,typename FType=short>
+    inline void circle(const IType &cx, const IType &cy, const FType &r, const pixel &px, const bool fill=true) {
+        this->buffer.template circle<calc,IType,FType>(cx, cy, r, px, fill);
+        if (DisplayCommand *c = push(DL_CIRCLE, px)) {
+            c->variant = Replay::template enable<DL_CIRCLE,calc,IType,FType>();
+            c->flags = fill;
+            c->a = cx;
+            c->b = cy;
+            c->w = r;
+        }
+    }
+
+    template<typename calc=short, typename IType=fb, typename FType=fb>
+    inline void stroke_line(const IType &x1, const IType &y1, const IType &x2, const IType &y2, const FType &width, const pixel &px) {
+        this->buffer.template stroke_line<calc,IType,FType>(x1, y1, x2, y2, width, px);
+        if (DisplayCommand *c = push(DL_STROKE, px)) {
+            c->variant = Replay::template enable<DL_STROKE,calc,IType,FType>();
+            c->a = x1;
+            c->b = y1;
+            c->c = x2;
+            c->d = y2;
+            c->w = width;
+        }
+    }
+
+    template<typename _SpriteT>
+    inline void putSprite(const _SpriteT &sprite, const Origin &position) {
+        this->buffer.putSprite(sprite, position);
+        if (!recording || overflowed)
+            return;
+
+        const int index = Replay::source_index(sprite.src);
+        if (index < 0) {
+            overflowed = true;
+            return;
+        }
+
+        if (DisplayCommand *c = push(DL_SPRITE, 0)) {
+            c->variant = index;
+            c->a = sprite.x;
+            c->b = sprite.y;
+            c->c = sprite.width;
+            c->d = sprite.height;
+            c->e = position.x;
+            c->f = position.y;
+        }
+    }
+
+    template<typename _SpriteT>
+    inline void putSprite(const _SpriteT &sprite, const fb &x, const fb &y, const fb &w = 0, const fb &h = 0) {
+        putSprite(sprite, Origin(x, y));
+    }
+
+    template<typename IType>
+    inline void series(const IType *ys, const fb &count, const Origin &offset, const fb &baseline, const pixel &px, const SeriesStyle &style = SERIES_LINE) {
+        this->buffer.series(ys, count, offset, baseline, px, style);
+        if (DisplayCommand *c = push(DL_SERIES, px, (count * 2 + 3) & ~3)) {
+            c->flags = style;
+            c->a = offset.x;
+            c->b = offset.y;
+            c->c = baseline;
+            c->d = count;
+            short *values = (short*)(c + 1);
+            for (fb i = 0; i < count; i++)
+                values[i] = ys[i];
+        }
+    }
+
+    template<typename IType>
+    inline void series_envelope(const IType *tops, const IType *bottoms, const fb &count, const Origin &offset, const pixel &px) {
+        this->buffer.series_envelope(tops, bottoms, count, offset, px);
+        if (DisplayCommand *c = push(DL_ENVELOPE, px, count * 4)) {
+            c->a = offset.x;
+            c->b = offset.y;
+            c->d = count;
+            short *values = (short*)(c + 1);
+            for (fb i = 0; i < count; i++) {
+                values[i] = tops[i];
+                values[count + i] = bottoms[i];
+            }
+        }
+    }
+};
+
+namespace UI {
+
+template<typename Buffer>
+struct RecorderMemberT {
+    DisplayRecorderT<Buffer> recorder;
+};
+
+/*
+    @brief Element whose draws are recorded, damage is repaired by replaying them
+
+    Element is built over DisplayRecorderT<Buffer>. Once it has a list its
+    draws skip REDRAW, a REDRAW that changes nothing replays the list
+    clipped to event->damage instead of running on_draw. Whatever Element
+    draws replaces the list, so it must draw all of itself when it draws.
+    Lists live in the pool, evicted or oversized ones fall back to drawing.
+*/
+template<typename Buffer, typename Element>
+struct RecordedT : private RecorderMemberT<Buffer>, public Element {
+    using Element::operator<<;
+    using Target = typename DisplayRecorderT<Buffer>::Target;
+    using Replay = typename DisplayRecorderT<Buffer>::Replay;
+
+    Buffer &frame;
+    ISurfacePool *pool;
+    SurfaceHandle handle;
+    fb list_bytes = 0;
+    // Lists are in frame coordinates, a moved element records again
+    Size recorded_box;
+    uint32_t records = 0, replays = 0;
+
+    template<typename ...Args>
+    RecordedT(Buffer &frame, ISurfacePool &pool, Args&&... args)
+        :RecorderMemberT<Buffer>{ { frame } },Element(this->recorder, std::forward<Args>(args)...),frame(frame),pool(&pool) {
+        // The scratch buffer and the pool are shared, split passes take turns
+        this->draw_locked = true;
+    }
+
+    inline const pixel *getList() {
+        const Size &box = *this;
+        if (box.x != recorded_box.x || box.y != recorded_box.y || box.width != recorded_box.width || box.height != recorded_box.height)
+            return nullptr;
+        return pool->get(handle);
+    }
+
+    inline void store() {
+        DisplayRecorderT<Buffer> &recorder = this->recorder;
+        pixel *list = recorder.overflowed ? nullptr : pool->acquire(recorder.length, handle);
+
+        if (!list) {
+            pool->release(handle);
+            list_bytes = 0;
+            return;
+        }
+
+        memcpy(list, recorder.scratch, recorder.length);
+        list_bytes = recorder.length;
+        recorded_box = *this;
+        records++;
+    }
+
+    void handle_event(Event *event) override {
+        if (event->type != Event::DRAW) {
+            Element::handle_event(event);
+            return;
+        }
+
+        DisplayRecorderT<Buffer> &recorder = this->recorder;
+        const pixel *list = getList();
+
+        const Event::Value value = event->value;
+        if (list)
+            event->value = Event::Value(value & ~Event::REDRAW);
+
+        recorder.begin();
+        Element::handle_event(event);
+        recorder.end();
+        event->value = value;
+
+        if (recorder.length || recorder.overflowed) {
+            store();
+            return;
+        }
+
+        if (list && (value & Event::REDRAW)) {
+            const Size rect = event->damage ? *event->damage : Size(0, 0, frame.getWidth(), frame.getHeight());
+            Target target(frame, rect);
+            Replay::replay(target, list, list_bytes, rect);
+            replays++;
+        }
+    }
+};
+
+}
+}
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <stdlib.h>
+#include <inttypes.h>
 #include "sizes.h"
 
 namespace wbl {
@@ -129,11 +130,30 @@ struct FramebufferT : public Buffer {
         return getPixel(pos.x, pos.y);
     }
 
+    /*
+        @brief Vertical span from y0 to y1 inclusive, unclipped
+
+        Layouts that pack a column into bytes override this with a masked write
+    */
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        for (fb y = y0; y <= y1; y++)
+            this->putPixel(x, y, px);
+    }
+
     inline void clear() {
         for (fb i = 0; i < this->SIZE; i++)
             this->buffer[i] = 0;
     }
 
+    // Rows backed by storage, all of them unless the frame is banded
+    inline constexpr fb getClipTop() const {
+        return 0;
+    }
+
+    inline constexpr fb getClipBottom() const {
+        return this->HEIGHT;
+    }
+
     inline void flush() {}
 
     inline constexpr fb getAlphaTest() const {
@@ -145,4 +165,311 @@ struct FramebufferT : public Buffer {
     }
 };
 
+/*
+    @brief Colour pixel formats, stored the way the SSD1351 reads them
+
+    Drawing still passes palette indices as pixel values, a colour buffer
+    resolves them to its format when the pixel is written.
+*/
+struct FormatRGB332 {
+    using storage = uint8_t;
+    static constexpr fb BPP = 8;
+
+    static inline constexpr storage from565(const uint16_t &c) {
+        return ((c >> 13) << 5) | (((c >> 8) & 0x07) << 2) | ((c >> 3) & 0x03);
+    }
+
+    static inline constexpr uint16_t to565(const storage &s) {
+        const uint16_t r = s >> 5, g = (s >> 2) & 0x07, b = s & 0x03;
+        return (((r << 2) | (r >> 1)) << 11) | (((g << 3) | g) << 5) | ((b << 3) | (b << 1) | (b >> 1));
+    }
+};
+
+struct FormatRGB565 {
+    using storage = uint16_t;
+    static constexpr fb BPP = 16;
+
+    // Big endian, rows go to the display without conversion
+    static inline constexpr storage from565(const uint16_t &c) {
+        return uint16_t((c >> 8) | (c << 8));
+    }
+
+    static inline constexpr uint16_t to565(const storage &s) {
+        return uint16_t((s >> 8) | (s << 8));
+    }
+};
+
+template<typename Format, fb ENTRIES = 16>
+struct PaletteT {
+    using storage = typename Format::storage;
+
+    static_assert((ENTRIES & (ENTRIES - 1)) == 0, "Indices wrap with a mask");
+
+    // Index 0 is the background, 1 what monochrome elements draw with
+    storage colors[ENTRIES] = { Format::from565(0x0000), Format::from565(0xffff) };
+
+    inline constexpr void set(const pixel &index, const uint16_t &rgb565) {
+        colors[index & (ENTRIES - 1)] = Format::from565(rgb565);
+    }
+
+    inline constexpr storage operator[](const pixel &index) const {
+        return colors[index & (ENTRIES - 1)];
+    }
+
+    // First index holding c, 0 if the colour is not in the palette
+    inline constexpr pixel index(const storage &c) const {
+        for (fb i = 0; i < ENTRIES; i++)
+            if (colors[i] == c)
+                return i;
+        return 0;
+    }
+};
+
+template<fb _WIDTH, fb _HEIGHT, typename _Format>
+struct ColorbufferT {
+    using Format = _Format;
+    using storage = typename Format::storage;
+
+    static constexpr fb WIDTH = _WIDTH;
+    static constexpr fb HEIGHT = _HEIGHT;
+    static constexpr fb BPP = Format::BPP;
+    static constexpr fb PXPERBYTE = 1;
+    // In pixels, not bytes
+    static constexpr fb SIZE = _WIDTH * _HEIGHT;
+
+    storage buffer[SIZE];
+    PaletteT<Format> palette;
+};
+
+/*
+    @brief One storage element per pixel, rows top to bottom
+*/
+template<typename Buffer>
+struct ColorFramebufferT : public FramebufferT<Buffer> {
+    using storage = typename Buffer::storage;
+
+    inline constexpr fb getOffset(const fb &x, const fb &y) const {
+        return y * this->WIDTH + x;
+    }
+
+    inline constexpr fb getOffset(const Origin &pos) const {
+        return getOffset(pos.x, pos.y);
+    }
+
+    inline constexpr void putPixel(const fb &x, const fb &y, const pixel &px) {
+        this->buffer[y * this->WIDTH + x] = this->palette[px];
+    }
+
+    inline constexpr void putPixel(const Origin &pos, const pixel &px) {
+        putPixel(pos.x, pos.y, px);
+    }
+
+    inline constexpr pixel getPixel(const fb &x, const fb &y) const {
+        return this->palette.index(this->buffer[y * this->WIDTH + x]);
+    }
+
+    inline constexpr pixel getPixel(const Origin &pos) const {
+        return getPixel(pos.x, pos.y);
+    }
+
+    inline constexpr void putColor(const fb &x, const fb &y, const storage &c) {
+        this->buffer[y * this->WIDTH + x] = c;
+    }
+
+    inline constexpr storage getColor(const fb &x, const fb &y) const {
+        return this->buffer[y * this->WIDTH + x];
+    }
+
+    inline constexpr storage *getRow(const fb &y) {
+        return &this->buffer[y * this->WIDTH];
+    }
+
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        const storage c = this->palette[px];
+        storage *p = &this->buffer[y0 * this->WIDTH + x];
+        for (fb y = y0; y <= y1; y++, p += this->WIDTH)
+            *p = c;
+    }
+
+    inline void clear() {
+        const storage c = this->palette[0];
+        for (fb i = 0; i < this->SIZE; i++)
+            this->buffer[i] = c;
+    }
+
+    // Palette indices have no alpha, anything but the background is drawn with index 1
+    inline constexpr fb getAlphaTest() const {
+        return 0;
+    }
+
+    inline constexpr fb getValueBits() const {
+        return 1;
+    }
+};
+
+/*
+    @brief Frame _HEIGHT rows tall that stores one band of Frame::HEIGHT rows
+
+    Coordinates are those of the full frame. Writes outside the current band
+    are dropped and reads there return 0, so the UI tree can be drawn once
+    per band. The display buffer moves the band and sends it between passes.
+*/
+template<typename Frame, fb _HEIGHT>
+struct BandT : public Frame {
+    static constexpr fb HEIGHT = _HEIGHT;
+    static constexpr fb BAND_ROWS = Frame::HEIGHT;
+    static constexpr fb BANDS = (_HEIGHT + BAND_ROWS - 1) / BAND_ROWS;
+
+    static_assert(BANDS <= 32, "Bands are binned in a 32 bit mask");
+
+    fb band_y = 0;
+
+    // Moves to the band and clears it to palette index 0
+    inline void setBand(const fb &band) {
+        band_y = band * BAND_ROWS;
+        Frame::clear();
+    }
+
+    inline constexpr fb getBandRows() const {
+        return HEIGHT - band_y < BAND_ROWS ? HEIGHT - band_y : BAND_ROWS;
+    }
+
+    inline constexpr bool inBand(const fb &x, const fb &y) const {
+        return x < this->WIDTH && fb(y - band_y) < getBandRows();
+    }
+
+    inline constexpr fb getHeight() const {
+        return HEIGHT;
+    }
+
+    inline constexpr Length getLength() const {
+        return Length(this->WIDTH, HEIGHT);
+    }
+
+    inline constexpr Size getFrameSize() const {
+        return Size({}, this->getLength());
+    }
+
+    inline constexpr bool isBound(const fb &x, const fb &y) const {
+        return x < this->WIDTH && y < HEIGHT;
+    }
+
+    inline constexpr bool isBound(const Origin &pos) const {
+        return isBound(pos.x, pos.y);
+    }
+
+    inline constexpr fb getClipTop() const {
+        return band_y;
+    }
+
+    inline constexpr fb getClipBottom() const {
+        return band_y + getBandRows();
+    }
+
+    inline constexpr void putPixel(const fb &x, const fb &y, const pixel &px) {
+        if (inBand(x, y))
+            Frame::putPixel(x, y - band_y, px);
+    }
+
+    inline constexpr void putPixel(const Origin &pos, const pixel &px) {
+        putPixel(pos.x, pos.y, px);
+    }
+
+    inline constexpr pixel getPixel(const fb &x, const fb &y) const {
+        return inBand(x, y) ? Frame::getPixel(x, y - band_y) : 0;
+    }
+
+    inline constexpr pixel getPixel(const Origin &pos) const {
+        return getPixel(pos.x, pos.y);
+    }
+
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        const fb top = y0 > getClipTop() ? y0 : getClipTop();
+        const fb bottom = y1 < getClipBottom() - 1 ? y1 : getClipBottom() - 1;
+
+        if (x < this->WIDTH && top <= bottom)
+            Frame::putVSpan(x, top - band_y, bottom - band_y, px);
+    }
+
+    // Colour frames only, y must be inside the band
+    inline constexpr auto *getRow(const fb &y) {
+        return Frame::getRow(y - band_y);
+    }
+};
+
+/*
+    @brief Frame whose writes are limited to a row range set per thread
+
+    Threads drawing disjoint row ranges of one frame each set their own clip,
+    page aligned ranges never share a byte in either 1bpp layout. A scroll
+    container narrows the clip to its viewport and shifts what its content
+    draws up by the rows it scrolled, coordinates stay those of the content.
+*/
+template<typename Frame>
+struct ClippedT : public Frame {
+    struct Clip {
+        fb top = 0;
+        fb bottom = Frame::HEIGHT;
+        // Rows drawn at y land on y - shift
+        fb shift = 0;
+        // Rows that can be drawn to, the content's while it is scrolled
+        fb height = Frame::HEIGHT;
+    };
+
+    static inline thread_local Clip clip;
+
+    inline constexpr fb getClipTop() const {
+        const fb frame_top = Frame::getClipTop() + clip.shift;
+        return clip.top > frame_top ? clip.top : frame_top;
+    }
+
+    inline constexpr fb getClipBottom() const {
+        const fb frame_bottom = Frame::getClipBottom() + clip.shift;
+        return clip.bottom < frame_bottom ? clip.bottom : frame_bottom;
+    }
+
+    inline constexpr fb getClipShift() const {
+        return clip.shift;
+    }
+
+    inline constexpr fb getHeight() const {
+        return clip.height;
+    }
+
+    inline constexpr Length getLength() const {
+        return Length(this->getWidth(), getHeight());
+    }
+
+    inline constexpr void putPixel(const fb &x, const fb &y, const pixel &px) {
+        if (x < this->WIDTH && fb(y - clip.top) < fb(clip.bottom - clip.top))
+            Frame::putPixel(x, y - clip.shift, px);
+    }
+
+    inline constexpr void putPixel(const Origin &pos, const pixel &px) {
+        putPixel(pos.x, pos.y, px);
+    }
+
+    inline constexpr pixel getPixel(const fb &x, const fb &y) const {
+        return Frame::getPixel(x, y - clip.shift);
+    }
+
+    inline constexpr pixel getPixel(const Origin &pos) const {
+        return getPixel(pos.x, pos.y);
+    }
+
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        const fb top = y0 > clip.top ? y0 : clip.top;
+        const fb bottom = y1 < clip.bottom - 1 ? y1 : clip.bottom - 1;
+
+        if (x < this->WIDTH && top <= bottom)
+            Frame::putVSpan(x, top - clip.shift, bottom - clip.shift, px);
+    }
+
+    // Colour frames only, y must be inside the clip
+    template<typename F = Frame>
+    inline constexpr auto *getRow(const fb &y) {
+        return F::getRow(y - clip.shift);
+    }
+};
+
 }
\ No newline at end of file
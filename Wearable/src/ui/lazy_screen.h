@@ -0,0 +1,213 @@
+#pragma once
+
+#include "config.h"
+#include "ui.h"
+#include "wbl_func.h"
+
+#include <inttypes.h>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace wbl {
+namespace UI {
+
+/*
+    @brief Memory for the elements of one screen, destroyed together in reverse order
+
+    Objects are placed upward from the start, a destructor record for each
+    is pushed downward from the end. make returns nullptr once they meet.
+*/
+struct ScreenArena {
+    struct Destructor {
+        void (*destroy)(void *object);
+        void *object;
+    };
+
+    ub *memory = nullptr;
+    fb bytes = 0, used = 0, records = 0;
+
+    template<typename T, typename ...Args>
+    inline T *make(Args&&... args) {
+        const fb offset = (used + alignof(T) - 1) & ~fb(alignof(T) - 1);
+        const fb top = bytes - (records + 1) * sizeof(Destructor);
+        if (!memory || offset + sizeof(T) > top)
+            return nullptr;
+
+        T *object = new (memory + offset) T(std::forward<Args>(args)...);
+        used = offset + sizeof(T);
+
+        records++;
+        getRecords()[0] = { [](void *object) { ((T*)object)->~T(); }, object };
+
+        return object;
+    }
+
+    // The most recent record first
+    inline Destructor *getRecords() {
+        return (Destructor*)(memory + bytes) - records;
+    }
+
+    inline void reset() {
+        Destructor *record = getRecords();
+        for (fb i = 0; i < records; i++)
+            record[i].destroy(record[i].object);
+
+        used = 0;
+        records = 0;
+    }
+};
+
+/*
+    @brief A screen whose subtree can be built and released
+*/
+struct ILazyScreen {
+    // Shown by the root, never released while set
+    bool shown = false;
+    int64_t visited_us = 0;
+
+    virtual void release() = 0;
+};
+
+struct IScreenGovernor {
+    virtual ScreenArena *acquire(ILazyScreen &screen) = 0;
+    virtual void release(ILazyScreen &screen) = 0;
+};
+
+/*
+    @brief Hands out ARENAS arenas of BYTES to lazy screens, releasing the one visited longest ago when all are in use
+
+    RAM stays at ARENAS * BYTES however many lazy screens there are. A
+    screen that is shown keeps its arena.
+*/
+template<fb BYTES = UI_SCREEN_ARENA_BYTES, fb ARENAS = UI_SCREEN_ARENAS>
+struct ScreenGovernorT : public IScreenGovernor {
+    static_assert(BYTES % alignof(ScreenArena::Destructor) == 0, "Destructor records are stored at the end");
+
+    alignas(ScreenArena::Destructor) ub memory[ARENAS][BYTES];
+    ScreenArena arenas[ARENAS];
+    ILazyScreen *owners[ARENAS] = {};
+    uint32_t builds = 0, releases = 0, failed = 0;
+
+    inline int find(const ILazyScreen *screen) const {
+        for (fb i = 0; i < ARENAS; i++)
+            if (owners[i] == screen)
+                return i;
+        return -1;
+    }
+
+    inline int least_recent() const {
+        int lru = -1;
+        for (fb i = 0; i < ARENAS; i++)
+            if (owners[i] && !owners[i]->shown && (lru < 0 || owners[i]->visited_us < owners[lru]->visited_us))
+                lru = i;
+        return lru;
+    }
+
+    ScreenArena *acquire(ILazyScreen &screen) override {
+        int slot = find(&screen);
+        if (slot < 0)
+            slot = find(nullptr);
+
+        if (slot < 0 && (slot = least_recent()) >= 0)
+            owners[slot]->release();
+
+        if (slot < 0) {
+            failed++;
+            return nullptr;
+        }
+
+        owners[slot] = &screen;
+        arenas[slot] = { memory[slot], BYTES };
+        builds++;
+
+        return &arenas[slot];
+    }
+
+    void release(ILazyScreen &screen) override {
+        const int slot = find(&screen);
+        if (slot < 0)
+            return;
+
+        arenas[slot].reset();
+        owners[slot] = nullptr;
+        releases++;
+    }
+};
+
+/*
+    @brief Screen that builds its subtree into an arena when the root first loads it
+
+    The root dispatches LOAD with REQUEST before a screen is attached, a
+    build answers CHANGE so the root lays it out again. Idle prerendering
+    only asks with a bare LOAD, an unbuilt screen stops its default and is
+    neither built nor counted as visited. The builder returns
+    false when it could not make every element, the screen then stays empty.
+    State that must outlive the elements, like log data, lives outside them.
+*/
+template<typename ScreenT = IScreen>
+struct LazyScreenT : public ScreenBaseT<ScreenT>, public ILazyScreen {
+    using Builder = bool (*)(LazyScreenT &screen, ScreenArena &arena);
+
+    IScreenGovernor &governor;
+    Builder builder;
+    ScreenArena *arena = nullptr;
+
+    LazyScreenT(const char *name, IScreenGovernor &governor, Builder builder)
+        :ScreenBaseT<ScreenT>(name),governor(governor),builder(builder) { }
+
+    inline bool built() const {
+        return arena;
+    }
+
+    void release() override {
+        while (this->child)
+            this->remove_child(this->child);
+
+        governor.release(*this);
+        arena = nullptr;
+    }
+
+    inline void load(Event *event) {
+        if (!(event->value & EventValues::REQUEST)) {
+            if (!arena)
+                event->stopDefault();
+            return;
+        }
+
+        visited_us = micros();
+        if (arena)
+            return;
+
+        arena = governor.acquire(*this);
+        if (!arena)
+            return;
+
+        if (!builder(*this, *arena)) {
+            release();
+            return;
+        }
+
+        event->value = EventValues::CHANGE;
+    }
+
+    void handle_event(Event *event) override {
+        ScreenBaseT<ScreenT>::handle_event(event);
+
+        switch (event->type) {
+            case EventTypes::LOAD:
+                load(event);
+                break;
+            case EventTypes::SCREEN:
+                shown = event->value & EventValues::VISIBLE;
+                visited_us = micros();
+                break;
+            default: break;
+        }
+    }
+};
+
+using LazyScreen = LazyScreenT<>;
+
+}
+}
\ No newline at end of file
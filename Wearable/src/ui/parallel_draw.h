@@ -0,0 +1,222 @@
+#pragma once
+
+#include "config.h"
+#include "ui.h"
+#include "wbl_func.h"
+
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+#include <inttypes.h>
+#include <algorithm>
+
+namespace wbl {
+namespace UI {
+
+struct ParallelDrawStats {
+    uint32_t frames = 0, serial_frames = 0;
+    int64_t main_us = 0, worker_us = 0, wait_us = 0;
+};
+
+/*
+    @brief Splits the DRAW pass at a page boundary, a worker task on the other core draws the bottom part
+
+    The tree is binned by page and each thread walks it with its own row clip,
+    skipping subtrees outside its pages. Elements binned on both sides are
+    drawn by both, one at a time under the shared lock. The split moves a page
+    per frame toward whichever side took longer. Buffer must be clipped per
+    thread (ClippedT).
+
+    Waking the worker and waiting for it costs more than a cheap frame saves,
+    so while adaptive the pass splits only after a serial frame cost min_us
+    or more, and keeps splitting only while a split frame beats that serial
+    one by a tenth. A split that loses goes back to serial for remeasure
+    frames, and a split that wins is measured serially again every
+    remeasure frames, so one slow frame cannot keep it split. Experimental,
+    on the host the split is slower than serial drawing.
+*/
+template<typename Buffer, typename Root = ElementRootT<Buffer>>
+struct ParallelDrawT : public IDrawPass, public IDrawLock {
+    static constexpr fb PAGE_ROWS = 8;
+    // Display buffers inherit HEIGHT twice, the default clip spans the frame
+    static constexpr fb HEIGHT = typename Buffer::Clip().bottom;
+    static constexpr fb PAGES = HEIGHT / PAGE_ROWS;
+
+    static_assert(PAGES <= 32, "Pages are binned in a 32 bit mask");
+
+    Root &root;
+    TaskHandle_t task = nullptr;
+    SemaphoreHandle_t start_sem = nullptr, done_sem = nullptr, lock_sem = nullptr;
+    volatile bool running = false;
+
+    // First page the worker draws
+    fb split = PAGES / 2;
+    // Off, every frame is split
+    bool adaptive = true, splitting = false;
+    int64_t min_us = PARALLEL_DRAW_MIN_US;
+    uint32_t remeasure = PARALLEL_DRAW_REMEASURE;
+    // Last serial and split frame times, and frames left in the current mode
+    int64_t serial_us = 0, split_us = 0;
+    uint32_t mode_frames = 0;
+    // Times both threads, e.g. a fake clock in tests
+    int64_t (*clock)() = micros;
+    Event worker_event { Event::DRAW };
+    ParallelDrawStats last, total;
+
+    ParallelDrawT(Root &root):root(root) { }
+
+    void lock() override {
+        xSemaphoreTake(lock_sem, portMAX_DELAY);
+    }
+
+    void unlock() override {
+        xSemaphoreGive(lock_sem);
+    }
+
+    static inline uint32_t pages_mask(const fb &first, const fb &end) {
+        const uint32_t below_end = end < 32 ? (1u << end) - 1 : ~0u;
+        return below_end & ~((1u << first) - 1);
+    }
+
+    inline void balance() {
+        // Ignore differences within a tenth, moving the split costs a page either way
+        const int64_t slack = (last.main_us + last.worker_us) / 10;
+
+        if (last.main_us > last.worker_us + slack && split > 1)
+            split--;
+        else if (last.worker_us > last.main_us + slack && split < PAGES - 1)
+            split++;
+    }
+
+    void draw(const Event &event) override {
+        if (!task) {
+            root.handle_deferred_event(event);
+            return;
+        }
+
+        if (adaptive && !splitting) {
+            draw_serial(event);
+            return;
+        }
+
+        const int64_t start = clock();
+
+        if (root.active_screen)
+            root.active_screen->bin_bands(PAGE_ROWS);
+        if (root.header_element)
+            root.header_element->bin_bands(PAGE_ROWS);
+
+        worker_event = event;
+        worker_event.bands = pages_mask(split, PAGES);
+        worker_event.shared = this;
+        xSemaphoreGive(start_sem);
+
+        Buffer::clip = { 0, fb(split * PAGE_ROWS) };
+        Event main_event = event;
+        main_event.bands = pages_mask(0, split);
+        main_event.shared = this;
+        root.handle_deferred_event(main_event);
+        Buffer::clip = {};
+
+        const int64_t drawn = clock();
+        xSemaphoreTake(done_sem, portMAX_DELAY);
+
+        last.main_us = drawn - start;
+        last.wait_us = clock() - drawn;
+        last.frames = 1;
+        // As long as the slower side, a fake clock only moves on the thread drawing
+        split_us = std::max(last.main_us + last.wait_us, last.worker_us);
+
+        total.frames++;
+        total.main_us += last.main_us;
+        total.worker_us += last.worker_us;
+        total.wait_us += last.wait_us;
+
+        balance();
+
+        // A split no better than serial backs off, a winning one is checked against a fresh serial frame
+        if (split_us + serial_us / 10 > serial_us) {
+            splitting = false;
+            mode_frames = remeasure;
+        } else if (mode_frames && !--mode_frames) {
+            splitting = false;
+            mode_frames = 1;
+        }
+    }
+
+    inline void draw_serial(const Event &event) {
+        const int64_t start = clock();
+        root.handle_deferred_event(event);
+        serial_us = clock() - start;
+        total.serial_frames++;
+
+        if (mode_frames && --mode_frames)
+            return;
+
+        splitting = serial_us >= min_us;
+        mode_frames = splitting ? remeasure : 0;
+    }
+
+    static void draw_task(void *arg) {
+        ParallelDrawT *self = (ParallelDrawT*)arg;
+
+        while (true) {
+            xSemaphoreTake(self->start_sem, portMAX_DELAY);
+
+            if (!self->running)
+                break;
+
+            const int64_t start = self->clock();
+
+            Buffer::clip = { fb(self->split * PAGE_ROWS), HEIGHT };
+            Event event = self->worker_event;
+            self->root.handle_deferred_event(event);
+
+            self->last.worker_us = self->clock() - start;
+
+            xSemaphoreGive(self->done_sem);
+        }
+
+        xSemaphoreGive(self->done_sem);
+        vTaskDelete(nullptr);
+    }
+
+    inline esp_err_t start(const BaseType_t &core = PARALLEL_DRAW_CORE) {
+        if (task)
+            return ESP_OK;
+
+        start_sem = xSemaphoreCreateCounting(1, 0);
+        done_sem = xSemaphoreCreateCounting(1, 0);
+        lock_sem = xSemaphoreCreateMutex();
+        if (!start_sem || !done_sem || !lock_sem)
+            return ESP_ERR_NO_MEM;
+
+        running = true;
+
+        if (xTaskCreatePinnedToCore(draw_task, "draw", 4096, this, tskIDLE_PRIORITY + 1, &task, core) != pdPASS) {
+            running = false;
+            task = nullptr;
+            return ESP_ERR_NO_MEM;
+        }
+
+        root.draw_pass = this;
+
+        return ESP_OK;
+    }
+
+    inline void stop() {
+        if (!task)
+            return;
+
+        root.draw_pass = nullptr;
+        running = false;
+        xSemaphoreGive(start_sem);
+        xSemaphoreTake(done_sem, portMAX_DELAY);
+        task = nullptr;
+    }
+};
+
+}
+}
@@ -0,0 +1,215 @@
+#pragma once
+
+#include "config.h"
+#include "framebuffer.h"
+#include "texture.h"
+#include "surface_pool.h"
+#include "ui.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <memory>
+#include <utility>
+
+namespace wbl {
+
+/*
+    @brief Draws addressed to Frame go to a 1bpp surface the size of a box
+
+    Coordinates are those of Frame. While backed, writes outside the box are
+    dropped and the whole box is drawable whatever Frame's clip is, blit
+    copies it into Frame within the clip. Without backing every call goes
+    straight to Frame.
+*/
+template<typename Frame>
+struct SurfaceT : public BufferRefT<Frame> {
+    using Backing = FramebufferT<Memorybuffer<>>;
+
+    ISurfacePool *pool = nullptr;
+    SurfaceHandle handle;
+    Backing backing { 0, 0, 1, nullptr };
+    Size box;
+    // Set by any write to the backing
+    bool drawn = false;
+
+    constexpr SurfaceT(Frame &frame):BufferRefT<Frame>(frame) { }
+
+    inline constexpr bool backed() const {
+        return backing.buffer;
+    }
+
+    // Rows are padded to whole bytes, FramebufferT takes bit offsets from x alone
+    inline constexpr static fb getStride(const Length &length) {
+        return (length.width + 7) & ~7;
+    }
+
+    inline constexpr static fb getBytes(const Length &length) {
+        return getStride(length) * length.height / 8;
+    }
+
+    /*
+        @brief Backs the surface with pool memory for box, true when the memory is new and cleared
+    */
+    inline bool bind(const Size &to) {
+        pixel *memory = pool ? pool->get(handle) : nullptr;
+        const bool resized = to.width != box.width || to.height != box.height;
+        box = to;
+
+        if (memory && !resized) {
+            backing.buffer = memory;
+            return false;
+        }
+
+        memory = pool && box.width && box.height ? pool->acquire(getBytes(box), handle) : nullptr;
+        std::construct_at(&backing, getStride(box), box.height, 1, memory);
+
+        if (memory)
+            memset(memory, 0, getBytes(box));
+
+        return memory;
+    }
+
+    inline void unbind() {
+        if (pool)
+            pool->release(handle);
+        backing.buffer = nullptr;
+    }
+
+    inline constexpr bool inBox(const fb &x, const fb &y) const {
+        return fb(x - box.x) < box.width && fb(y - box.y) < box.height;
+    }
+
+    inline constexpr fb getClipTop() const {
+        return backed() ? 0 : this->buffer.getClipTop();
+    }
+
+    inline constexpr fb getClipBottom() const {
+        return backed() ? this->buffer.getHeight() : this->buffer.getClipBottom();
+    }
+
+    inline constexpr fb getAlphaTest() const {
+        return 0;
+    }
+
+    inline constexpr fb getValueBits() const {
+        return 1;
+    }
+
+    inline constexpr void putPixel(const fb &x, const fb &y, const pixel &px) {
+        if (!backed()) {
+            this->buffer.putPixel(x, y, px);
+            return;
+        }
+
+        if (inBox(x, y)) {
+            backing.putPixel(x - box.x, y - box.y, px);
+            drawn = true;
+        }
+    }
+
+    inline constexpr void putPixel(const Origin &pos, const pixel &px) {
+        putPixel(pos.x, pos.y, px);
+    }
+
+    inline constexpr pixel getPixel(const fb &x, const fb &y) const {
+        if (backed() && inBox(x, y))
+            return backing.getPixel(x - box.x, y - box.y);
+        return this->buffer.getPixel(x, y);
+    }
+
+    inline constexpr pixel getPixel(const Origin &pos) const {
+        return getPixel(pos.x, pos.y);
+    }
+
+    inline constexpr void putVSpan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        for (fb y = y0; y <= y1; y++)
+            putPixel(x, y, px);
+    }
+
+    /*
+        @brief Copies the box into Frame, runs of one value go out as a single span
+    */
+    inline void blit() {
+        if (!backed())
+            return;
+
+        Frame &frame = this->buffer;
+        const fb top = box.y > frame.getClipTop() ? box.y : frame.getClipTop();
+        const fb bottom = box.getBottom() < frame.getClipBottom() ? box.getBottom() : frame.getClipBottom();
+        const fb right = box.getRight() < frame.getWidth() ? box.getRight() : frame.getWidth();
+
+        for (fb x = box.x; x < right; x++) {
+            for (fb y = top; y < bottom;) {
+                const pixel px = backing.getPixel(x - box.x, y - box.y);
+                fb end = y + 1;
+                while (end < bottom && backing.getPixel(x - box.x, end - box.y) == px)
+                    end++;
+                frame.putVSpan(x, y, end - 1, px);
+                y = end;
+            }
+        }
+    }
+};
+
+template<typename Frame>
+using SurfaceTextureT = TextureT<SurfaceT<Frame>>;
+
+namespace UI {
+
+template<typename Buffer>
+struct SurfaceMemberT {
+    SurfaceTextureT<Buffer> surface;
+};
+
+/*
+    @brief Element drawn into a retained surface, re-rendered only when its content changes
+
+    Element is built over SurfaceTextureT<Buffer>. Its draws skip REDRAW
+    unless the surface is new, a REDRAW or any change blits the surface
+    into the frame instead. Blits are opaque, retain leaf elements that
+    clear their own box. Elements the pool cannot hold draw to the frame.
+*/
+template<typename Buffer, typename Element>
+struct RetainedT : private SurfaceMemberT<Buffer>, public Element {
+    using Element::operator<<;
+
+    template<typename ...Args>
+    RetainedT(Buffer &frame, ISurfacePool &pool, Args&&... args)
+        :SurfaceMemberT<Buffer>{ { frame } },Element(this->surface, std::forward<Args>(args)...) {
+        this->surface.pool = &pool;
+        // The pool is not thread safe, split passes take turns
+        this->draw_locked = true;
+    }
+
+    inline SurfaceTextureT<Buffer> &getSurface() {
+        return this->surface;
+    }
+
+    void handle_event(Event *event) override {
+        if (event->type != Event::DRAW) {
+            Element::handle_event(event);
+            return;
+        }
+
+        SurfaceTextureT<Buffer> &surface = this->surface;
+        const Size &box = *this;
+        const bool fresh = surface.bind(box);
+
+        if (!surface.backed()) {
+            Element::handle_event(event);
+            return;
+        }
+
+        const Event::Value value = event->value;
+        event->value = Event::Value(fresh ? value | Event::REDRAW : value & ~Event::REDRAW);
+        surface.drawn = false;
+        Element::handle_event(event);
+        event->value = value;
+
+        if (surface.drawn || (value & Event::REDRAW))
+            surface.blit();
+    }
+};
+
+}
+}
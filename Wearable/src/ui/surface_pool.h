@@ -0,0 +1,136 @@
+#pragma once
+
+#include "config.h"
+#include "types.h"
+
+#include <inttypes.h>
+
+namespace wbl {
+
+struct SurfaceHandle {
+    fb slot = 0;
+    // 0 never matches a slot, a default handle holds nothing
+    uint32_t generation = 0;
+};
+
+struct SurfacePoolStats {
+    uint32_t acquired = 0, evicted = 0, failed = 0;
+};
+
+/*
+    @brief Bounded memory for element surfaces
+
+    Handles go stale when their memory is evicted, get returns nullptr for
+    them and the owner renders again into a new allocation.
+*/
+struct ISurfacePool {
+    virtual pixel *acquire(const fb &bytes, SurfaceHandle &handle) = 0;
+    virtual pixel *get(const SurfaceHandle &handle) = 0;
+    virtual void release(SurfaceHandle &handle) = 0;
+};
+
+/*
+    @brief First fit over BYTES of static memory, evicting the least recently used surfaces until one fits
+*/
+template<fb BYTES = SURFACE_POOL_BYTES, fb SLOTS = SURFACE_POOL_SLOTS>
+struct SurfacePoolT : public ISurfacePool {
+    static_assert(BYTES % 4 == 0, "Allocations are rounded to words");
+
+    struct Slot {
+        fb offset = 0, bytes = 0;
+        uint32_t generation = 0, last_used = 0;
+    };
+
+    alignas(4) pixel memory[BYTES];
+    Slot slots[SLOTS];
+    uint32_t clock = 0, generations = 0;
+    SurfacePoolStats stats;
+
+    inline constexpr bool overlaps(const fb &offset, const fb &bytes) const {
+        for (const Slot &slot : slots)
+            if (slot.generation && offset < slot.offset + slot.bytes && slot.offset < offset + bytes)
+                return true;
+        return false;
+    }
+
+    // Gaps start at 0 or where a surface ends
+    inline bool find_gap(const fb &bytes, fb &offset) const {
+        if (!overlaps(0, bytes)) {
+            offset = 0;
+            return true;
+        }
+
+        for (const Slot &slot : slots) {
+            const fb end = slot.offset + slot.bytes;
+            if (slot.generation && BYTES - end >= bytes && !overlaps(end, bytes)) {
+                offset = end;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    inline Slot *least_recent() {
+        Slot *lru = nullptr;
+        for (Slot &slot : slots)
+            if (slot.generation && (!lru || slot.last_used < lru->last_used))
+                lru = &slot;
+        return lru;
+    }
+
+    inline Slot *free_slot() {
+        for (Slot &slot : slots)
+            if (!slot.generation)
+                return &slot;
+        return nullptr;
+    }
+
+    pixel *acquire(const fb &requested, SurfaceHandle &handle) override {
+        release(handle);
+
+        // Offsets stay word aligned
+        const fb bytes = (requested + 3) & ~3;
+        if (!bytes || bytes > BYTES) {
+            stats.failed++;
+            return nullptr;
+        }
+
+        fb offset = 0;
+        Slot *slot = free_slot();
+        while (!slot || !find_gap(bytes, offset)) {
+            Slot *lru = least_recent();
+            lru->generation = 0;
+            stats.evicted++;
+            if (!slot)
+                slot = lru;
+        }
+
+        slot->offset = offset;
+        slot->bytes = bytes;
+        slot->generation = ++generations;
+        slot->last_used = ++clock;
+        stats.acquired++;
+
+        handle = { fb(slot - slots), slot->generation };
+        return memory + offset;
+    }
+
+    pixel *get(const SurfaceHandle &handle) override {
+        Slot &slot = slots[handle.slot];
+        if (!handle.generation || slot.generation != handle.generation)
+            return nullptr;
+
+        slot.last_used = ++clock;
+        return memory + slot.offset;
+    }
+
+    void release(SurfaceHandle &handle) override {
+        Slot &slot = slots[handle.slot];
+        if (handle.generation && slot.generation == handle.generation)
+            slot.generation = 0;
+        handle = {};
+    }
+};
+
+}
@@ -4,6 +4,7 @@
 #include "framebuffer.h"
 #include "sizes.h"
 #include <math.h>
+#include <string.h>
 
 namespace wbl {
 
@@ -39,13 +40,30 @@ struct IGraphicsContext {
     virtual inline fb getAlphaTest() const = 0;
 };
 
+enum SeriesStyle : ub {
+    SERIES_LINE = 0,
+    SERIES_FILL = 1,
+    SERIES_ENVELOPE = 2,
+};
+
 template<typename Buffer>
 struct TextureT : public Buffer {
     using Buffer::Buffer;
 
     using Sprite = SpriteT<Buffer>;
 
+    // Colour buffers store one element per pixel, the kernels below write those directly
+    static constexpr bool COLOR = requires { typename Buffer::Format; };
+
     constexpr inline void clear(const pixel &px = 0) {
+        if constexpr (COLOR) {
+            const auto c = this->palette[px];
+            const fb len = this->getSize();
+            for (fb i = 0; i < len; i++)
+                this->buffer[i] = c;
+            return;
+        }
+
         const fb len = this->getSize();
         pixel d = 0;
         for (fb i = 0; i < this->PXPERBYTE; i++)
@@ -57,9 +75,19 @@ struct TextureT : public Buffer {
 
     constexpr inline void fill(const fb &x0, const fb &y0, const fb &x1, const fb &y1, const pixel &px) {
         const fb xs = x0 >= 0 ? x0 : 0;
-        const fb ys = y0 >= 0 ? y0 : 0;
+        const fb ys = y0 >= this->getClipTop() ? y0 : this->getClipTop();
         const fb xe = x1 < this->getWidth() ? x1 : this->getWidth();
-        const fb ye = y1 < this->getHeight() ? y1 : this->getHeight();
+        const fb ye = y1 < this->getClipBottom() ? y1 : this->getClipBottom();
+
+        if constexpr (COLOR) {
+            const auto c = this->palette[px];
+            for (fb y = ys; y < ye; ++y) {
+                auto *row = this->getRow(y);
+                for (fb x = xs; x < xe; ++x)
+                    row[x] = c;
+            }
+            return;
+        }
         
         for (fb x = xs; x < xe; ++x)
             for (fb y = ys; y < ye; ++y)
@@ -187,6 +215,21 @@ struct TextureT : public Buffer {
         const fb dl = position.x;
         const fb dt = position.y;
 
+        if constexpr (COLOR) {
+            const auto c = this->palette[dest];
+            const fb top = this->getClipTop();
+            const fb bottom = db < this->getClipBottom() ? db : this->getClipBottom();
+            for (fb dy = dt, ty = tt; dy < bottom && ty < tb; dy++, ty++) {
+                if (dy < top)
+                    continue;
+                auto *row = this->getRow(dy);
+                for (fb dx = dl, tx = tl; dx < dr && tx < tr; dx++, tx++)
+                    if (texture->getPixel(tx, ty) > alpha)
+                        row[dx] = c;
+            }
+            return;
+        }
+
         for (fb dx = dl, tx = tl; dx < dr && tx < tr; dx++, tx++) {
             for (fb dy = dt, ty = tt; dy < db && ty < tb; dy++, ty++) {
                 const pixel px = texture->getPixel(tx, ty);
@@ -312,6 +355,118 @@ struct TextureT : public Buffer {
         line(start.x, start.y, end.x, end.y, px);
     }
 
+    constexpr inline void vspan(const fb &x, const fb &y0, const fb &y1, const pixel &px) {
+        const fb top = y0 < y1 ? y0 : y1;
+        const fb bottom = y0 < y1 ? y1 : y0;
+
+        if (x >= this->getWidth() || top >= this->getHeight())
+            return;
+
+        this->putVSpan(x, top, bottom < this->getHeight() ? bottom : this->getHeight() - 1, px);
+    }
+
+    /*
+        @brief Moves the pixels of box dy rows down, up when dy is negative, false when it could not
+
+        Rows that leave box are dropped, rows uncovered keep what they held.
+        Box must lie within the clip. Whole storage rows are copied when box
+        covers them, on a paged frame box and dy must also be on page
+        boundaries. Other boxes move pixels.
+    */
+    constexpr inline bool move_rows(const Size &box, const int &dy) {
+        const fb distance = dy < 0 ? -dy : dy;
+        if (!distance || distance >= box.height || box.y < this->getClipTop() || box.getBottom() > this->getClipBottom())
+            return false;
+
+        constexpr fb ROWS = [] {
+            if constexpr (requires { Buffer::PAGE_ROWS; })
+                return fb(Buffer::PAGE_ROWS);
+            else
+                return fb(1);
+        }();
+
+        // Storage is addressed in frame rows, draws may be shifted from them
+        fb shift = 0;
+        if constexpr (requires { this->getClipShift(); })
+            shift = this->getClipShift();
+
+        const fb y = box.y - shift;
+        const fb moved = box.height - distance;
+        const fb right = box.getRight();
+        const fb start = this->getOffset(box.x, y);
+        const fb end = this->getOffset(right - 1, y) + 1;
+        const bool whole = y % ROWS == 0 && box.height % ROWS == 0 && distance % ROWS == 0
+            && (box.x == 0 || this->getOffset(box.x - 1, y) != start)
+            && (right == this->getWidth() || this->getOffset(right, y) != end - 1);
+
+        if (whole) {
+            const fb stride = this->getOffset(0, ROWS) - this->getOffset(0, 0);
+            const fb bytes = (end - start) * sizeof(this->buffer[0]);
+            const fb rows = moved / ROWS, offset = distance / ROWS;
+
+            // Moving down copies the last row first so nothing is read after it was overwritten
+            for (fb i = 0; i < rows; i++) {
+                const fb row = dy > 0 ? rows - 1 - i : i;
+                const fb from = dy > 0 ? row : row + offset;
+                const fb to = dy > 0 ? row + offset : row;
+                memcpy(&this->buffer[start + to * stride], &this->buffer[start + from * stride], bytes);
+            }
+            return true;
+        }
+
+        for (fb i = 0; i < moved; i++) {
+            const fb from = dy > 0 ? box.y + moved - 1 - i : box.y + distance + i;
+            const fb to = dy > 0 ? from + distance : from - distance;
+            for (fb x = box.x; x < right; x++)
+                this->putPixel(x, to, this->getPixel(x, from));
+        }
+        return true;
+    }
+
+    /*
+        @brief Plot one y value per column, x advancing by one
+
+        SERIES_LINE joins each column to the previous one with a single span,
+        SERIES_FILL spans from each value down to baseline.
+        Values are relative to offset.
+    */
+    template<typename IType>
+    constexpr inline void series(const IType *ys, const fb &count, const Origin &offset, const fb &baseline, const pixel &px, const SeriesStyle &style = SERIES_LINE) {
+        for (fb i = 0; i < count; i++) {
+            const fb y = ys[i];
+            const fb x = offset.x + i;
+
+            switch (style) {
+                case SERIES_FILL:
+                    vspan(x, offset.y + y, offset.y + baseline, px);
+                    break;
+                default:
+                    vspan(x, offset.y + (i ? ys[i-1] : y), offset.y + y, px);
+                    break;
+            }
+        }
+    }
+
+    /*
+        @brief Plot a top/bottom pair per column, extended to touch the previous column
+    */
+    template<typename IType>
+    constexpr inline void series_envelope(const IType *tops, const IType *bottoms, const fb &count, const Origin &offset, const pixel &px) {
+        for (fb i = 0; i < count; i++) {
+            fb top = tops[i];
+            fb bottom = bottoms[i];
+
+            if (i) {
+                if (top > bottoms[i-1])
+                    top = bottoms[i-1];
+                if (bottom < tops[i-1])
+                    bottom = tops[i-1];
+            }
+
+            vspan(offset.x + i, offset.y + top, offset.y + bottom, px);
+        }
+    }
+
     template<typename calc=short, typename IType=fb, typename FType=fb, typename CALLBACK>
     constexpr inline void stroke_line_callback(const IType &x1, const IType &y1, const IType &x2, const IType &y2, const FType &width, CALLBACK callback) { 
         line_callback<calc>(x1, y1, x2, y2, [this,&width,&callback](const IType &x, const IType &y) {
@@ -414,6 +569,10 @@ struct BufferRefT {
 
     inline constexpr bool isBound(const Origin &pos) const { return isBound(pos.x, pos.y); }
 
+    inline constexpr fb getClipTop() const { return buffer.getClipTop(); }
+
+    inline constexpr fb getClipBottom() const { return buffer.getClipBottom(); }
+
     inline constexpr fb getOffset(const fb &x, const fb &y) const { return buffer.getOffset(x, y); }
 
     inline constexpr fb getOffset(const Origin &pos) const { return getOffset(pos.x, pos.y); }
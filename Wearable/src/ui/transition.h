@@ -0,0 +1,166 @@
+#pragma once
+
+#include "config.h"
+#include "ui.h"
+
+#include "esp_check.h"
+
+#include <inttypes.h>
+#include <string.h>
+#include <type_traits>
+
+namespace wbl {
+namespace UI {
+
+/*
+    @brief Slides one screen out and the next in over UI_TRANSITION_FRAMES frames
+
+    Both screens are snapshots of the whole frame. Horizontal slides shift
+    each storage row, on the SH1107 a byte is a column of a page so a shift
+    moves bytes. Vertical slides on a display with a start line (flush_scroll)
+    leave GRAM in place, each frame sends only the pages coming into view and
+    moves the start line. Other displays shift rows and flush the frame.
+*/
+template<typename Buffer>
+struct ScreenTransitionT : public IScreenTransition {
+    static constexpr const char *TAG = "wbl::UI::ScreenTransitionT";
+
+    using Frame = std::remove_cvref_t<decltype(Buffer::buffer)>;
+    using Unit = std::remove_extent_t<Frame>;
+
+    static constexpr fb FRAMES = UI_TRANSITION_FRAMES;
+    // A storage row of a paged frame holds PAGE_ROWS rows
+    static constexpr fb ROWS = [] {
+        if constexpr (requires { Buffer::PAGE_ROWS; })
+            return fb(Buffer::PAGE_ROWS);
+        else
+            return fb(1);
+    }();
+    static constexpr bool SCROLLS = requires (Buffer &b) { b.flush_scroll(ub(), ub(), ub()); };
+
+    static_assert(!SCROLLS || ROWS == 8, "flush_scroll takes SH1107 pages");
+
+    Buffer &frame;
+    Frame source, target;
+    Event::Value direction = Event::VALUE_NONE;
+    fb frames = 0;
+    // Storage rows of target already sent to GRAM
+    fb shown = 0;
+
+    ScreenTransitionT(Buffer &frame):frame(frame) { }
+
+    inline fb getStorageRows() const {
+        return frame.getHeight() / ROWS;
+    }
+
+    inline fb getStride() const {
+        return frame.getOffset(0, ROWS) - frame.getOffset(0, 0);
+    }
+
+    void begin(const Event::Value &to) override {
+        memcpy(source, frame.buffer, sizeof(source));
+        direction = to;
+        frames = 0;
+        shown = 0;
+    }
+
+    void capture() override {
+        memcpy(target, frame.buffer, sizeof(target));
+
+        // GRAM still holds the old screen, the frame mirrors it while scrolling
+        if (SCROLLS && !isHorizontal())
+            memcpy(frame.buffer, source, sizeof(source));
+    }
+
+    bool step() override {
+        if constexpr (requires { frame.flush_busy(); })
+            if (frame.flush_busy())
+                return true;
+
+        const fb next = frames + 1;
+
+        if (isHorizontal()) {
+            slide_columns(next);
+            frame.flush();
+        } else if constexpr (SCROLLS) {
+            if (scroll(next) != ESP_OK)
+                return true;
+        } else {
+            slide_rows(next);
+            frame.flush();
+        }
+
+        frames = next;
+        return frames < FRAMES;
+    }
+
+    inline bool isHorizontal() const {
+        return direction & (Event::DPAD_LEFT | Event::DPAD_RIGHT);
+    }
+
+    /*
+        @brief Shifts every storage row, the new screen enters on the side direction points to
+    */
+    inline void slide_columns(const fb &next) {
+        const fb width = frame.getWidth();
+        const fb units = frame.getOffset(width - 1, 0) + 1;
+        const fb moved = next < FRAMES ? frame.getOffset(width * next / FRAMES, 0) : units;
+        const fb rows = getStorageRows();
+
+        for (fb row = 0; row < rows; row++) {
+            const fb at = frame.getOffset(0, row * ROWS);
+            Unit *to = &frame.buffer[at];
+            const Unit *from = &source[at], *in = &target[at];
+
+            if (direction & Event::DPAD_RIGHT) {
+                memcpy(to, from + moved, (units - moved) * sizeof(Unit));
+                memcpy(to + units - moved, in, moved * sizeof(Unit));
+            } else {
+                memcpy(to, in + units - moved, moved * sizeof(Unit));
+                memcpy(to + moved, from, (units - moved) * sizeof(Unit));
+            }
+        }
+    }
+
+    /*
+        @brief Shifts whole storage rows, for displays without a start line
+    */
+    inline void slide_rows(const fb &next) {
+        const fb rows = getStorageRows(), stride = getStride();
+        const fb moved = rows * next / FRAMES;
+        Unit *to = frame.buffer;
+
+        if (direction & Event::DPAD_DOWN) {
+            memcpy(to, &source[moved * stride], (rows - moved) * stride * sizeof(Unit));
+            memcpy(to + (rows - moved) * stride, target, moved * stride * sizeof(Unit));
+        } else {
+            memcpy(to, &target[(rows - moved) * stride], moved * stride * sizeof(Unit));
+            memcpy(to + moved * stride, source, (rows - moved) * stride * sizeof(Unit));
+        }
+    }
+
+    /*
+        @brief Writes the pages coming into view over the ones that left it and moves the start line
+
+        Scrolling down by n rows shows GRAM from row n, the rows that wrap
+        around to the bottom are the first n of the new screen. Scrolling up
+        shows it from HEIGHT - n, the last n rows come in at the top.
+    */
+    inline esp_err_t scroll(const fb &next) {
+        const fb rows = getStorageRows(), stride = getStride();
+        const fb moved = rows * next / FRAMES;
+        const fb first = direction & Event::DPAD_DOWN ? shown : rows - moved;
+        const fb count = moved - shown;
+
+        memcpy(&frame.buffer[first * stride], &target[first * stride], count * stride * sizeof(Unit));
+
+        const fb line = direction & Event::DPAD_DOWN ? moved * ROWS : frame.getHeight() - moved * ROWS;
+        ESP_RETURN_ON_ERROR(frame.flush_scroll(first, count, line % frame.getHeight()), TAG, "flush_scroll failed");
+
+        shown = moved;
+        return ESP_OK;
+    }
+};
+
+}
+}
\ No newline at end of file
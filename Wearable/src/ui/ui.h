@@ -7,7 +7,10 @@
 #include <vector>
 #include <time.h>
 #include <string>
+#include <string.h>
 #include <iostream>
+#include <memory>
+#include <new>
 
 #include "texture.h"
 #include "displaybuffer.h"
@@ -18,6 +21,7 @@
 #include "wbl_func.h"
 #include "config.h"
 #include "display_timeout.h"
+#include "surface_pool.h"
 
 namespace wbl {
 namespace UI {
@@ -332,6 +336,17 @@ struct Style : public Size, public StyleInfo {
     }
 };
 
+// Serializes elements that more than one thread draws, see ParallelDrawT
+struct IDrawLock {
+    virtual void lock() = 0;
+    virtual void unlock() = 0;
+};
+
+#ifdef USE_EVENT_DBG
+// Cleared by headless emulator runs, which have no one reading stderr
+inline bool event_log = true;
+#endif
+
 struct Event {
     enum Type : uint8_t {
         TYPE_NONE,
@@ -404,6 +419,15 @@ struct Event {
     Direction direction;
     State state;
 
+    // Bands a DRAW renders, subtrees binned outside all of them are skipped
+    uint32_t bands = ~0u;
+
+    // Held while drawing elements that are also binned outside bands, or draw_locked
+    IDrawLock *shared = nullptr;
+
+    // Part of the frame a REDRAW repairs, all of it when null
+    const Size *damage = nullptr;
+
     constexpr Event(const Type &type, const Value &value, const Direction &direction, const State &state)
         :type(type),value(value),direction(direction),state(state){}
     constexpr Event(const Type &type, const Value &value)
@@ -570,17 +594,42 @@ struct IElement : public Style, public NodeMovementOpsT<IElement> {
     IElement *sibling;
     IElement *child;
 
+    // Bands this element and its children overlap, see bin_bands
+    uint32_t bands = ~0u;
+
+    // Draws touch state shared between elements, hold the shared lock for them too
+    bool draw_locked = false;
+
     virtual void handle_event(Event *event) { }
 
     constexpr inline void handle_event_log(Event *event) {
         #ifdef USE_EVENT_DBG
-        if (event->type != Event::TICK)
+        if (!std::is_constant_evaluated() && event_log && event->type != Event::TICK)
             std::cerr << (name ? name : "null") << ":" << event->to_string() << std::endl;
         #endif
         this->handle_event(event);
     }
 
+    constexpr inline void handle_event_shared(Event *event) {
+        const bool straddles = bands & ~event->bands;
+        if (event->shared && event->type == Event::DRAW && (straddles || draw_locked)) {
+            // Drawn from both sides, the first pass would mark it up to date for the second
+            const Event::Value value = event->value;
+            if (straddles)
+                event->value = Event::Value(value | Event::REDRAW);
+            event->shared->lock();
+            this->handle_event_log(event);
+            event->shared->unlock();
+            event->value = value;
+            return;
+        }
+        this->handle_event_log(event);
+    }
+
     constexpr inline void dispatch_event(Event *event) {
+        if (event->type == Event::DRAW && !(bands & event->bands))
+            return;
+
         const bool skipSelf = event->isSkipSelf();
 
         if (skipSelf)
@@ -590,7 +639,7 @@ struct IElement : public Style, public NodeMovementOpsT<IElement> {
             return;
 
         if (event->isSelfFirst() && !skipSelf)
-            this->handle_event_log(event);
+            this->handle_event_shared(event);
 
         switch (event->direction & Event::DIRECTION_ONLY) {
             case Event::PARENT:
@@ -620,7 +669,7 @@ struct IElement : public Style, public NodeMovementOpsT<IElement> {
         }
 
         if (!event->isSelfFirst() && !skipSelf)
-            this->handle_event_log(event);
+            this->handle_event_shared(event);
     }
 
     constexpr inline void dispatch_event(Event &event) {
@@ -1068,13 +1117,40 @@ struct IElement : public Style, public NodeMovementOpsT<IElement> {
 
     constexpr inline void resolve_layout() {
         #ifdef USE_EVENT_DBG
-        fprintf(stderr, "Run layout on %s\n", name ? name : "null");
+        if (!std::is_constant_evaluated() && event_log)
+            fprintf(stderr, "Run layout on %s\n", name ? name : "null");
         #endif
         resolve_relative_container_sizes();
         FlowContext root;
         resolve_container_growth(root);
         resolve_container_position();
     }
+
+    /*
+        @brief Bins the subtree by the bands of band_rows rows each box overlaps
+
+        Call after layout. Boxes are padded by a row, strokes rounded outward
+        can land just outside them. Returns the bands of this element and its children.
+    */
+    constexpr uint32_t bin_bands(const fb &band_rows) {
+        const Size &box = *this;
+        uint32_t mask = 0;
+
+        if (box.height) {
+            const fb first = (box.y ? box.y - 1 : 0) / band_rows;
+            const fb last = (box.y + box.height) / band_rows;
+
+            if (first < 32)
+                mask = (last < 31 ? (2u << last) - 1 : ~0u) & ~((1u << first) - 1);
+        }
+
+        for (IElement *cur = child; cur != nullptr; cur = cur->sibling)
+            mask |= cur->bin_bands(band_rows);
+
+        bands = mask;
+
+        return mask;
+    }
 };
 
 template<typename Buffer>
@@ -1345,15 +1421,17 @@ struct ScreenClockT : public ElementT {
 
     int64_t prev_draw_time = -1;
     bool use_milliseconds = false;
+    // Time shown in µs, e.g. a fixed one in tests
+    int64_t (*clock)() = micros;
 
     //void on_clear(Event *event) override {}
 
     void on_draw(Event *event) override {
         using calc = float;
 
-        const int64_t now = use_milliseconds ? millis() : seconds();    
+        const int64_t now = use_milliseconds ? clock() / 1000 : clock() / 1000000;
     
-        if (now == prev_draw_time)
+        if (now == prev_draw_time && !(event->value & Event::REDRAW))
             return;
     
         this->clear();
@@ -1524,6 +1602,23 @@ struct ScreenBaseT : public ScreenT {
     }
 };
 
+// Runs the DRAW pass in place of ElementRootT, e.g. split across cores
+struct IDrawPass {
+    virtual void draw(const Event &event) = 0;
+};
+
+/*
+    @brief Animates a screen change between snapshots of the frames on either side
+*/
+struct IScreenTransition {
+    // Keeps the frame on the display before the screen changes, direction is the DPAD value
+    virtual void begin(const Event::Value &direction) = 0;
+    // Keeps the frame the new screen drew
+    virtual void capture() = 0;
+    // Puts the next animation frame on the display, false once the new screen shows
+    virtual bool step() = 0;
+};
+
 template<typename Buffer, typename ElementT = ElementBaseT<Buffer>>
 struct ElementRootT : public ElementT {
     using ElementT::ElementT;
@@ -1540,6 +1635,58 @@ struct ElementRootT : public ElementT {
     IElement *header_element = nullptr;
     bool layout_dirty = true;
 
+    IDrawPass *draw_pass = nullptr;
+    // Slides screens in when set, the tree neither ticks nor draws while one runs
+    IScreenTransition *transition = nullptr;
+    bool transition_pending = false, transitioning = false;
+    // Where the next REDRAW repairs, the whole frame when null
+    const Size *damage = nullptr;
+
+    // The display buffer holds one band at a time, see draw_bands
+    static constexpr const bool BANDED = requires { Buffer::BANDS; };
+
+    // Frame storage saved from under an overlay, hash is of the frame under box as the overlay left it
+    struct SaveUnder {
+        SurfaceHandle handle;
+        Size box;
+        uint32_t hash = 0;
+        bool saved = false;
+    };
+
+    struct Overlay {
+        IElement *element = nullptr;
+        SaveUnder under;
+    };
+
+    // Holds save-unders, without one a dismissed overlay repaints the frame
+    ISurfacePool *overlay_pool = nullptr;
+    Overlay overlays[UI_OVERLAYS];
+    // The debug overlay covers the whole frame, its save would empty the pool
+    std::unique_ptr<uint8_t[]> debug_under;
+    bool debug_saved = false;
+
+    // A whole frame of screen, drawn while it was not shown
+    struct Prerender {
+        IScreen *screen = nullptr;
+        SurfaceHandle handle;
+        int64_t drawn_us = 0;
+    };
+
+    // Holds prerenders, one more frame is borrowed while drawing one
+    ISurfacePool *prerender_pool = nullptr;
+    Prerender prerenders[UI_PRERENDERS];
+    // An idle frame prerenders only if the last prerender still fits in the budget
+    int64_t frame_budget_us = UI_FRAME_BUDGET_US;
+    int64_t frame_start_us = 0, prerender_us = 0;
+
+    // A byte of a paged frame holds a column of PAGE_ROWS rows, saves are whole pages
+    static constexpr fb SAVE_ROWS = [] {
+        if constexpr (requires { Buffer::PAGE_ROWS; })
+            return fb(Buffer::PAGE_ROWS);
+        else
+            return fb(1);
+    }();
+
     template<typename FORMAT, typename ...Args>
     inline int log(FORMAT format, const Args&...args) {
         if (!debug || debug_log_offset > debug_log_length-20)
@@ -1714,10 +1861,446 @@ struct ElementRootT : public ElementT {
         }
     }
 
+    /*
+        @brief Calls run(offset, count) for each run of frame storage under box, a run per row or page
+    */
+    template<typename CALLBACK>
+    inline void for_each_run(const Size &box, CALLBACK run) {
+        const fb right = box.getRight() - 1;
+        for (fb y = box.y - box.y % SAVE_ROWS; y < box.getBottom(); y += SAVE_ROWS) {
+            const fb first = this->buffer.getOffset(box.x, y);
+            run(first, fb(this->buffer.getOffset(right, y) - first + 1));
+        }
+    }
+
+    /*
+        @brief Copies the frame under area into the overlay pool, false when it could not be kept
+    */
+    inline bool save_under(SaveUnder &under, const Size &area) {
+        using Unit = std::remove_cvref_t<decltype(this->buffer.buffer[0])>;
+
+        const fb width = this->buffer.getWidth(), height = this->buffer.getHeight();
+        const fb right = area.getRight() < width ? area.getRight() : width;
+        const fb bottom = area.getBottom() < height ? area.getBottom() : height;
+
+        under.saved = true;
+        if (area.x >= right || area.y >= bottom) {
+            under.box = Size();
+            return true;
+        }
+
+        under.box = Size(area.x, area.y, right - area.x, bottom - area.y);
+
+        fb units = 0;
+        for_each_run(under.box, [&](const fb &offset, const fb &count) { units += count; });
+
+        Unit *to = overlay_pool ? (Unit*)overlay_pool->acquire(units * sizeof(Unit), under.handle) : nullptr;
+        if (!to)
+            return false;
+
+        for_each_run(under.box, [&](const fb &offset, const fb &count) {
+            memcpy(to, &this->buffer.buffer[offset], count * sizeof(Unit));
+            to += count;
+        });
+
+        return true;
+    }
+
+    /*
+        @brief Puts back what save_under kept, false when the save was lost
+    */
+    inline bool restore_under(SaveUnder &under) {
+        using Unit = std::remove_cvref_t<decltype(this->buffer.buffer[0])>;
+
+        if (!under.saved)
+            return true;
+        under.saved = false;
+
+        if (!under.box.width || !under.box.height)
+            return true;
+
+        const Unit *from = overlay_pool ? (const Unit*)overlay_pool->get(under.handle) : nullptr;
+        if (!from)
+            return false;
+
+        for_each_run(under.box, [&](const fb &offset, const fb &count) {
+            memcpy(&this->buffer.buffer[offset], from, count * sizeof(Unit));
+            from += count;
+        });
+
+        overlay_pool->release(under.handle);
+        return true;
+    }
+
+    // FNV-1a of the frame storage under box, tells whether anything drew there since
+    inline uint32_t hash_under(const Size &box) {
+        using Unit = std::remove_cvref_t<decltype(this->buffer.buffer[0])>;
+
+        uint32_t hash = 2166136261u;
+        if (!box.width || !box.height)
+            return hash;
+
+        for_each_run(box, [&](const fb &offset, const fb &count) {
+            const uint8_t *bytes = (const uint8_t*)&this->buffer.buffer[offset];
+            for (size_t i = 0; i < count * sizeof(Unit); i++)
+                hash = (hash ^ bytes[i]) * 16777619u;
+        });
+
+        return hash;
+    }
+
+    // The rows a save under box holds, whole pages on a paged frame
+    inline Size saved_area(const Size &box) const {
+        const fb top = box.y - box.y % SAVE_ROWS;
+        const fb bottom = box.getBottom() + (SAVE_ROWS - box.getBottom() % SAVE_ROWS) % SAVE_ROWS;
+        return Size(box.x, top, box.width, bottom - top);
+    }
+
+    static constexpr inline bool crosses(const Size &a, const Size &b) {
+        return a.x < b.getRight() && b.x < a.getRight() && a.y < b.getBottom() && b.y < a.getBottom();
+    }
+
+    /*
+        @brief Draws the header and the elements of the screen that cross area again, each with its subtree
+    */
+    inline void redraw_crossing(const Size &area) {
+        Event draw(Event::DRAW, Event::REDRAW, Event::RDEPTH, Event::NORMAL);
+        draw.damage = &area;
+
+        if (active_screen)
+            for (IElement *element = active_screen->child; element != nullptr; element = element->sibling)
+                if (crosses(*element, area))
+                    element->dispatch_event(&draw);
+
+        if (header_element && crosses(*header_element, area))
+            header_element->dispatch_event(&draw);
+    }
+
+    // The whole tree drawn again over the frame, after a save under an overlay was lost
+    inline void repaint_tree() {
+        this->clear();
+        Event draw(Event::DRAW, Event::REDRAW, Event::RDEPTH, Event::NORMAL);
+        this->handle_deferred_event(draw);
+    }
+
+    /*
+        @brief Puts the tree back under every overlay, in reverse so overlapping saves unwind, false when a save was lost
+    */
+    inline bool unwind_overlays() {
+        bool restored = true;
+        for (fb i = UI_OVERLAYS; i-- > 0;)
+            restored &= restore_under(overlays[i].under);
+        return restored;
+    }
+
+    // Drops the saves once the tree repainted the whole frame under them
+    inline void forget_overlays() {
+        for (Overlay &overlay : overlays) {
+            if (overlay.under.saved && overlay_pool)
+                overlay_pool->release(overlay.under.handle);
+            overlay.under.saved = false;
+        }
+    }
+
+    inline void save_debug() {
+        const size_t bytes = sizeof(this->buffer.buffer);
+        if (!debug_under)
+            debug_under.reset(new (std::nothrow) uint8_t[bytes]);
+        if (debug_under)
+            memcpy(debug_under.get(), this->buffer.buffer, bytes);
+        debug_saved = true;
+    }
+
+    inline void restore_debug() {
+        if (!debug_saved)
+            return;
+        debug_saved = false;
+
+        if (debug_under)
+            memcpy(this->buffer.buffer, debug_under.get(), sizeof(this->buffer.buffer));
+        else
+            layout_dirty = true;
+    }
+
+    /*
+        @brief Leaves the frame as the tree drew it, a lost save repaints it next frame
+    */
+    inline void restore_overlays() {
+        restore_debug();
+        if (!unwind_overlays())
+            layout_dirty = true;
+    }
+
+    /*
+        @brief Draws the overlays over the finished frame, the tree under them is saved when they show
+
+        A quiet frame only hashes the frame under each overlay and hands it a
+        DRAW without REDRAW, so it updates itself if it changed. Where the
+        tree drew under an overlay, or one was shown, the saves are put back,
+        the elements crossing the damaged ones draw again and every overlay
+        is saved and drawn anew.
+    */
+    inline void draw_overlays() {
+        bool shown = false, damaged = false;
+        fb left = 0, top = 0, right = 0, bottom = 0;
+
+        for (Overlay &overlay : overlays) {
+            if (!overlay.element)
+                continue;
+
+            if (!overlay.under.saved) {
+                shown = true;
+                continue;
+            }
+
+            // Keeps the save from being the first one the pool evicts
+            if (overlay_pool)
+                overlay_pool->get(overlay.under.handle);
+
+            if (hash_under(overlay.under.box) == overlay.under.hash)
+                continue;
+
+            const Size area = saved_area(overlay.under.box);
+            if (!damaged) {
+                left = area.x;
+                top = area.y;
+                right = area.getRight();
+                bottom = area.getBottom();
+            }
+            left = area.x < left ? area.x : left;
+            top = area.y < top ? area.y : top;
+            right = area.getRight() > right ? area.getRight() : right;
+            bottom = area.getBottom() > bottom ? area.getBottom() : bottom;
+            damaged = true;
+        }
+
+        if (shown || damaged) {
+            if (!unwind_overlays())
+                repaint_tree();
+            else if (damaged)
+                redraw_crossing(Size(left, top, right - left, bottom - top));
+        }
+
+        for (Overlay &overlay : overlays) {
+            if (!overlay.element)
+                continue;
+
+            const bool fresh = !overlay.under.saved;
+            if (fresh)
+                save_under(overlay.under, *overlay.element);
+
+            Event draw(Event::DRAW, fresh ? Event::REDRAW : Event::VALUE_NONE, Event::RDEPTH, Event::NORMAL);
+            overlay.element->dispatch_event(&draw);
+        }
+
+        // After all of them, an overlay may draw over an earlier one
+        for (Overlay &overlay : overlays)
+            if (overlay.element)
+                overlay.under.hash = hash_under(overlay.under.box);
+    }
+
+    /*
+        @brief Draws element over the tree at box from the next frame on, until dismissed
+
+        The frame under it is saved when it first draws and put back when it
+        is dismissed, so the tree never sees the overlay. In between it draws
+        again only when the tree drew under it. Returns false when all
+        UI_OVERLAYS are in use.
+    */
+    inline bool show_overlay(IElement &element, const Size &box) {
+        for (Overlay &overlay : overlays) {
+            if (overlay.element && overlay.element != &element)
+                continue;
+
+            element << box;
+            overlay.element = &element;
+            return true;
+        }
+
+        return false;
+    }
+
+    /*
+        @brief Restores the frame under the overlays and stops drawing element, the others are saved and drawn again next frame
+    */
+    inline void dismiss_overlay(IElement &element) {
+        if constexpr (!BANDED)
+            restore_overlays();
+
+        for (Overlay &overlay : overlays)
+            if (overlay.element == &element)
+                overlay.element = nullptr;
+    }
+
+    inline Prerender *find_prerender(IScreen *screen) {
+        for (Prerender &prerender : prerenders)
+            if (prerender.screen == screen)
+                return &prerender;
+        return nullptr;
+    }
+
+    /*
+        @brief Slot to keep screen in, its own, an empty one or the stalest other than except
+    */
+    inline Prerender &prerender_slot(IScreen *screen, const Prerender *except = nullptr) {
+        if (Prerender *own = find_prerender(screen))
+            return *own;
+
+        Prerender *slot = nullptr;
+        for (Prerender &prerender : prerenders) {
+            if (&prerender == except)
+                continue;
+            if (!prerender.screen || !prerender_pool->get(prerender.handle))
+                return prerender;
+            if (!slot || prerender.drawn_us < slot->drawn_us)
+                slot = &prerender;
+        }
+
+        return *slot;
+    }
+
+    /*
+        @brief Lays out and draws screen in place of the active one as set_screen and once would
+    */
+    inline void draw_offscreen(IScreen *screen) {
+        IScreen *shown = active_screen;
+        const bool dirty = layout_dirty;
+
+        load_screen(screen);
+        this->remove_child(shown);
+        this->append_child(screen);
+        active_screen = screen;
+        this->resolve_layout();
+        this->dispatch(Event::CONTENT_SIZE, Event::REQUEST, Event::CHILDREN);
+        this->clear();
+
+        Event draw(Event::DRAW, Event::REDRAW, Event::RDEPTH, Event::NORMAL);
+        this->handle_deferred_event(draw);
+
+        this->remove_child(screen);
+        this->append_child(shown);
+        active_screen = shown;
+        this->resolve_layout();
+        layout_dirty = dirty;
+    }
+
+    /*
+        @brief Draws screen into the prerender pool, the frame is put back as it was
+    */
+    inline bool prerender(IScreen *screen) {
+        const fb bytes = sizeof(this->buffer.buffer);
+        Prerender &slot = prerender_slot(screen);
+        SurfaceHandle saved;
+
+        prerender_pool->acquire(bytes, slot.handle);
+        pixel *keep = prerender_pool->acquire(bytes, saved);
+        pixel *into = prerender_pool->get(slot.handle);
+        slot.screen = into ? screen : nullptr;
+
+        if (keep && into) {
+            memcpy(keep, this->buffer.buffer, bytes);
+            draw_offscreen(screen);
+            memcpy(into, this->buffer.buffer, bytes);
+            memcpy(this->buffer.buffer, keep, bytes);
+            slot.drawn_us = micros();
+        }
+
+        prerender_pool->release(saved);
+        return keep && into;
+    }
+
+    /*
+        @brief Prerenders the neighbour drawn longest ago, at most one a frame and each once per UI_PRERENDER_INTERVAL
+
+        Screens not built yet are skipped, only a visit builds them. The frame
+        budget is checked against how long the last prerender took.
+    */
+    inline void prerender_idle() {
+        if (!prerender_pool || !active_screen)
+            return;
+        if (micros() - frame_start_us + prerender_us > frame_budget_us)
+            return;
+
+        IScreen *neighbours[] = { active_screen->up, active_screen->right, active_screen->down, active_screen->left };
+        IScreen *stalest = nullptr;
+        int64_t drawn_us = 0;
+
+        for (IScreen *neighbour : neighbours) {
+            if (!neighbour || neighbour == active_screen || !screen_ready(neighbour))
+                continue;
+
+            const Prerender *prerender = find_prerender(neighbour);
+            const int64_t at = prerender && prerender_pool->get(prerender->handle) ? prerender->drawn_us : 0;
+            if (!stalest || at < drawn_us) {
+                stalest = neighbour;
+                drawn_us = at;
+            }
+        }
+
+        if (stalest && (!drawn_us || micros() - drawn_us >= int64_t(UI_PRERENDER_INTERVAL) * 1000)) {
+            const int64_t start = micros();
+            prerender(stalest);
+            prerender_us = micros() - start;
+        }
+    }
+
+    /*
+        @brief Shows screen from its prerender and keeps the frame of the screen left, false when it has none
+
+        Elements of screen last drew into the prerender, the next frame
+        redraws only what changed since. The header is shared and redrawn.
+    */
+    inline bool swap_prerender(IScreen *screen) {
+        if (!prerender_pool || !active_screen)
+            return false;
+
+        Prerender *ready = find_prerender(screen);
+        if (!ready || !prerender_pool->get(ready->handle))
+            return false;
+
+        restore_overlays();
+
+        const fb bytes = sizeof(this->buffer.buffer);
+        Prerender &left = prerender_slot(active_screen, ready);
+        pixel *keep = prerender_pool->acquire(bytes, left.handle);
+        const pixel *from = prerender_pool->get(ready->handle);
+        left.screen = keep && from ? active_screen : nullptr;
+
+        if (!from)
+            return false;
+
+        if (keep) {
+            memcpy(keep, this->buffer.buffer, bytes);
+            left.drawn_us = micros();
+        }
+
+        memcpy(this->buffer.buffer, from, bytes);
+        prerender_pool->release(ready->handle);
+        ready->screen = nullptr;
+
+        this->attach_screen(screen);
+
+        if (header_element) {
+            Event draw(Event::DRAW, Event::REDRAW, Event::RDEPTH, Event::NORMAL);
+            header_element->dispatch_event(&draw);
+        }
+
+        return true;
+    }
+
     inline void once(const bool &do_not_flush=false) {
         if (displayTimeout.is_display_off())
             return;
 
+        if (transitioning) {
+            transitioning = transition->step();
+            return;
+        }
+
+        frame_start_us = micros();
+        if constexpr (!BANDED)
+            restore_debug();
+
         //reset_log(false);
         log_time("ELPSD");
         
@@ -1729,16 +2312,33 @@ struct ElementRootT : public ElementT {
         if (dirty) {
             this->dispatch(Event::CONTENT_SIZE, Event::REQUEST, Event::CHILDREN);
             this->clear();
+            if constexpr (!BANDED)
+                forget_overlays();
         }
         log_time("CTSIZ");
 
-        this->handle_deferred_event(Event(Event::DRAW, dirty || redraw_needed ? Event::REDRAW : Event::VALUE_NONE, Event::RDEPTH, Event::NORMAL));
+        Event draw(Event::DRAW, dirty || redraw_needed ? Event::REDRAW : Event::VALUE_NONE, Event::RDEPTH, Event::NORMAL);
+        if (!dirty)
+            draw.damage = damage;
+        if constexpr (BANDED)
+            this->draw_bands();
+        else if (draw_pass)
+            draw_pass->draw(draw);
+        else
+            this->handle_deferred_event(draw);
         layout_dirty = false;
         redraw_needed = false;
+        damage = nullptr;
         
         log_time("DRAW.");
         int64_t log_flush_time = 0;
-        if (debug) {
+        // Overlays draw over a finished frame, a banded buffer never holds one
+        if constexpr (!BANDED)
+            draw_overlays();
+
+        if (debug && !BANDED) {
+            save_debug();
+
             if (debug_details)
                 this->overlay_tree_positions(debug_details==2, true);
 
@@ -1758,9 +2358,41 @@ struct ElementRootT : public ElementT {
         log("LOGFS:%5llius\n", log_flush_time);
         reset_log_time();
 
-        if (!do_not_flush)
+        if (transition_pending) {
+            transition_pending = false;
+            transition->capture();
+            transitioning = transition->step();
+        } else if (!do_not_flush)
             this->buffer.flush();
         log_time("FLUSH");
+
+        // Frames that only redrew what changed leave time to draw the next screens
+        if constexpr (!BANDED)
+            if (!dirty && !transitioning)
+                prerender_idle();
+    }
+
+    /*
+        @brief Draws the tree once per band, a band is sent while the next one is drawn
+
+        Nothing is kept between bands so every pass is a full redraw. Subtrees
+        are skipped in bands their boxes do not overlap.
+    */
+    inline void draw_bands() {
+        if (active_screen)
+            active_screen->bin_bands(Buffer::BAND_ROWS);
+        if (header_element)
+            header_element->bin_bands(Buffer::BAND_ROWS);
+
+        for (fb band = 0; band < Buffer::BANDS; band++) {
+            this->buffer.begin_band(band);
+
+            Event draw(Event::DRAW, Event::REDRAW, Event::RDEPTH, Event::NORMAL);
+            draw.bands = 1u << band;
+            this->handle_deferred_event(draw);
+
+            this->buffer.end_band();
+        }
     }
 
     inline void setDebug(const bool &debug_state=true) {
@@ -1799,7 +2431,6 @@ struct ElementRootT : public ElementT {
             if (event->value & EventValues::DPAD_DOWN)
                 debug_details++;
             debug_details %= 3;
-            layout_dirty = true;
         }
         #endif
 
@@ -1807,16 +2438,39 @@ struct ElementRootT : public ElementT {
             return;
 
         if (event->value & EventValues::DPAD_UP)
-            this->set_screen(active_screen->up);
+            this->slide_screen(active_screen->up, EventValues::DPAD_UP);
 
         if (event->value & EventValues::DPAD_DOWN)
-            this->set_screen(active_screen->down);
+            this->slide_screen(active_screen->down, EventValues::DPAD_DOWN);
 
         if (event->value & EventValues::DPAD_LEFT)
-            this->set_screen(active_screen->left);
+            this->slide_screen(active_screen->left, EventValues::DPAD_LEFT);
 
         if (event->value & EventValues::DPAD_RIGHT)
-            this->set_screen(active_screen->right);
+            this->slide_screen(active_screen->right, EventValues::DPAD_RIGHT);
+    }
+
+    /*
+        @brief Switches to screen, sliding it in from the side direction points to when there is a transition
+
+        The frame on the display is kept before the switch, the next once()
+        draws the new screen without flushing it and starts the animation.
+        Switches are ignored until a running transition ends.
+    */
+    void slide_screen(IScreen *screen, const Event::Value &direction) {
+        if (!screen || transitioning)
+            return;
+
+        if (transition && !BANDED && !transition_pending) {
+            transition->begin(direction);
+            transition_pending = true;
+        }
+
+        if constexpr (!BANDED)
+            if (this->swap_prerender(screen))
+                return;
+
+        this->set_screen(screen);
     }
 
     void set_header(IElement *header) {
@@ -1843,13 +2497,42 @@ struct ElementRootT : public ElementT {
         if (!screen)
             return;
 
+        this->attach_screen(screen);
+
+        this->clear();
+
+        layout_dirty = true;
+        //redraw_needed = true;
+    }
+
+    /*
+        @brief Lets screen build its subtree before it is attached or drawn, true when it did
+    */
+    inline bool load_screen(IScreen *screen) {
+        Event load(Event::LOAD, Event::REQUEST, Event::DIRECTION_NONE, Event::NORMAL);
+        screen->dispatch_event(&load);
+        return load.value & EventValues::CHANGE;
+    }
+
+    /*
+        @brief Whether screen can be drawn without building it, a bare LOAD only asks
+    */
+    inline bool screen_ready(IScreen *screen) {
+        Event load(Event::LOAD, Event::VALUE_NONE, Event::DIRECTION_NONE, Event::NORMAL);
+        screen->dispatch_event(&load);
+        return !load.isStopDefault();
+    }
+
+    // Makes screen the active child, the frame is left as it is unless screen was built
+    void attach_screen(IScreen *screen) {
+        if (load_screen(screen))
+            layout_dirty = true;
+
         if (active_screen) {
             active_screen->dispatch(EventTypes::SCREEN, EventValues::HIDDEN, EventDirection::RDEPTH);
             this->remove_child(active_screen);
         }
 
-        this->clear();
-
         this->append_child(screen);
 
         this->active_screen = screen;
@@ -1857,9 +2540,6 @@ struct ElementRootT : public ElementT {
         this->resolve_layout();
 
         this->active_screen->dispatch(EventTypes::SCREEN, EventValues::VISIBLE, EventDirection::RDEPTH);
-
-        layout_dirty = true;
-        //redraw_needed = true;
     }
 
     void set_screen(IScreen &screen) {
@@ -0,0 +1,179 @@
+#pragma once
+
+#include "config.h"
+#include "ui.h"
+
+#include <inttypes.h>
+#include <utility>
+
+namespace wbl {
+namespace UI {
+
+/*
+    @brief A row of a list, bound to the entry it last rendered
+*/
+template<typename Buffer>
+struct ListRowT : public ElementBaseT<Buffer> {
+    using ElementBaseT<Buffer>::ElementBaseT;
+
+    static constexpr uu NO_ENTRY = uu(~0);
+
+    uu index = NO_ENTRY;
+    // Whether the entry existed when it was rendered, rows past the end are left blank
+    bool filled = false;
+};
+
+/*
+    @brief Entries of a list, only those in view are asked for
+*/
+template<typename Buffer>
+struct IListSourceT {
+    virtual uu count() = 0;
+    virtual fb row_height() = 0;
+    // Draws entry index within the box of row, which was cleared before
+    virtual void render(ListRowT<Buffer> &row, const uu &index) = 0;
+};
+
+/*
+    @brief List of any length that lays out and draws only the rows in view
+
+    The source is asked for entries, ROWS row elements are bound to whichever
+    entries are in view. Rows are placed by the list and not linked into the
+    tree, so a frame costs the same for ten entries or ten thousand.
+
+    Entry i is shown by row i % visible, scrolling by fewer rows than are in
+    view moves the pixels already drawn with move_rows and renders only the
+    rows that came into view. DPAD_UP and DPAD_DOWN scroll a row and keep the
+    root from switching screens unless the list is at that end.
+*/
+template<typename Buffer, fb ROWS = UI_LIST_ROWS, typename ElementT = ElementBaseT<Buffer>>
+struct ElementListT : public ElementT {
+    using ElementT::operator<<;
+
+    using Row = ListRowT<Buffer>;
+    using Source = IListSourceT<Buffer>;
+
+    Source &source;
+    Row rows[ROWS];
+
+    // First entry in view, and the first and number of rows the frame holds
+    uu top = 0, drawn_top = 0;
+    fb drawn_visible = 0;
+
+    template<size_t ...I>
+    ElementListT(Buffer &buffer, Source &source, std::index_sequence<I...>)
+        :ElementT(buffer),source(source),rows{ ((void)I, Row(buffer))... } { }
+
+    ElementListT(Buffer &buffer, Source &source)
+        :ElementListT(buffer, source, std::make_index_sequence<ROWS>()) { }
+
+    // The box clipped to the frame
+    inline Size getViewport() const {
+        const Size &box = *this;
+        const fb frame_bottom = this->buffer.getHeight();
+        const fb bottom = box.getBottom() < frame_bottom ? box.getBottom() : frame_bottom;
+        return Size(box.x, box.y, box.width, bottom > box.y ? bottom - box.y : 0);
+    }
+
+    // Rows in view, each whole
+    inline fb getVisible() {
+        const fb height = source.row_height();
+        const fb fit = height ? getViewport().height / height : 0;
+        return fit < ROWS ? fit : ROWS;
+    }
+
+    inline uu getLastTop() {
+        const uu count = source.count();
+        const fb visible = getVisible();
+        return count > visible ? count - visible : 0;
+    }
+
+    // Puts entry at the top of the view, or as near as the end allows
+    inline bool scroll_to(const uu &entry) {
+        const uu last = getLastTop();
+        const uu previous = top;
+        top = entry < last ? entry : last;
+        return top != previous;
+    }
+
+    inline bool scroll_by(const int &entries) {
+        if (entries < 0)
+            return scroll_to(uu(-entries) > top ? 0 : top + entries);
+        return scroll_to(top + entries);
+    }
+
+    // Renders entry again on the next frame if it is in view
+    inline void invalidate(const uu &index) {
+        if (!drawn_visible)
+            return;
+
+        Row &row = rows[index % drawn_visible];
+        if (row.index == index)
+            row.index = Row::NO_ENTRY;
+    }
+
+    inline void invalidate() {
+        for (Row &row : rows)
+            row.index = Row::NO_ENTRY;
+    }
+
+    void on_user_input(Event *event) override {
+        if (!(event->value & EventValues::RELEASED))
+            return;
+
+        bool scrolled = false;
+        if (event->value & EventValues::DPAD_UP)
+            scrolled = scroll_by(-1);
+        if (event->value & EventValues::DPAD_DOWN)
+            scrolled = scroll_by(1);
+
+        if (scrolled)
+            event->stopDefault();
+    }
+
+    void on_draw(Event *event) override {
+        const Size view = getViewport();
+        const fb height = source.row_height();
+        const fb visible = getVisible();
+        const uu count = source.count();
+
+        // The source may have shrunk since the last scroll
+        const uu last = getLastTop();
+        if (top > last)
+            top = last;
+
+        if ((event->value & Event::REDRAW) || visible != drawn_visible) {
+            invalidate();
+            this->buffer.fill(Size(view.x, view.y + visible * height, view.width, view.height - visible * height), 0);
+        } else if (top != drawn_top) {
+            // Rows not moved, e.g. partly clipped or all scrolled away, render again
+            const Size shown(view.x, view.y, view.width, visible * height);
+            if (!this->buffer.move_rows(shown, (int(drawn_top) - int(top)) * height))
+                invalidate();
+        }
+
+        for (fb i = 0; i < visible; i++) {
+            const uu index = top + i;
+            const bool filled = index < count;
+            Row &row = rows[index % visible];
+
+            row << Size(view.x, view.y + i * height, view.width, height);
+
+            if (row.index == index && row.filled == filled)
+                continue;
+
+            row.clear();
+            if (filled)
+                source.render(row, index);
+
+            row.index = index;
+            row.filled = filled;
+        }
+
+        drawn_top = top;
+        drawn_visible = visible;
+    }
+};
+
+}
+}
\ No newline at end of file
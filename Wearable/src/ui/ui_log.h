@@ -4,6 +4,8 @@
 #include "ui.h"
 #include "log.h"
 
+#include <type_traits>
+
 namespace wbl {
 namespace UI {
 
@@ -18,6 +20,7 @@ struct ElementLogT : public ElementT, public DataLog {
     using storage_type = typename DataLog::storage_type;
 
     time_type last_data_time = 0;
+    SeriesStyle plot_style = SERIES_LINE;
 
     constexpr ElementLogT(DataLog &log):DataLog(log){}
     constexpr ElementLogT(Buffer &buffer, DataLog &log):ElementT(buffer),DataLog(log){}
@@ -55,6 +58,13 @@ struct ElementLogT : public ElementT, public DataLog {
         return RType(time);
     }
 
+    inline int value_snprintf(char *dest, const int &len, const value_type &value) const {
+        if constexpr (std::is_floating_point<value_type>::value)
+            return snprintf(dest, len, "%.3g", double(value));
+        else
+            return snprintf(dest, len, "%i", int(value));
+    }
+
     template<typename IType>
     inline int time_snprintf(char *dest, const int &len, const IType &time) const {
         const char *unit = time_unit(time);
@@ -114,7 +124,7 @@ struct ElementLogT : public ElementT, public DataLog {
         const int bufsize = 10;
         char buf[bufsize];
 
-        snprintf(buf, bufsize, "%i", median);
+        value_snprintf(buf, bufsize, median);
 
         this->draw_text(buf, Sprites::minifont, {0,pos.y});
     }
@@ -125,14 +135,16 @@ struct ElementLogT : public ElementT, public DataLog {
         const int bufsize_min = 10, bufsize_max = 10;
         char buf_min[bufsize_min], buf_max[bufsize_max];
 
-        snprintf(buf_min, bufsize_min, "%i", min);
-        snprintf(buf_max, bufsize_max, "%i", max);
+        value_snprintf(buf_min, bufsize_min, min);
+        value_snprintf(buf_max, bufsize_max, max);
 
         this->draw_text(buf_max, Sprites::minifont);
         this->draw_text(buf_min, Sprites::minifont, {0, plot_size.height-5});
     }
 
     void on_draw(Event *event) override {
+        this->snapshot();
+
         if (!this->is_stale())
             if (!(event->value & Event::REDRAW))
                 return;
@@ -144,8 +156,6 @@ struct ElementLogT : public ElementT, public DataLog {
 
         ElementT::clear();
 
-        uu py, px=0;
-
         const auto value_range = this->range();
         const auto value_min = this->min();
 
@@ -169,28 +179,39 @@ struct ElementLogT : public ElementT, public DataLog {
         draw_reference(plot_size);
         draw_min_max_reference(plot_size);
 
-        py = height - (((this->template get(0).value - value_min) * value_scale) * height);
+        const auto to_y = [&](const float &v) {
+            const int y = height - (((v - value_min) * value_scale) * height);
+            return uu((y > height) ? height : ((y < 0) ? 0 : y));
+        };
+
+        uu tops[width], bottoms[width];
+        tops[0] = bottoms[0] = to_y(this->template get(0).value);
         time_type pt = time_min;
 
         const time_type inc = time_type((float(1.0) / width) * time_range);
+        const bool envelope = plot_style == SERIES_ENVELOPE && this->size() >= width;
 
         for (uu x = 1; x < width; x++) {
             const time_type t = time_type((float(x) / width) * time_range) + time_min;
 
-            const float v = this->size() < width ? this->template interpolate_value<float>(t) : this->template avg_range_time<float>(pt-inc, t+inc);
-            //const float v = this->size() < width ? this->binary_search(t).value : this->template avg_range_time<int64_t>(pt-inc, t+inc);
-            const float vy = (v - value_min) * value_scale;
-
-            const int y = height - (vy * height);
-            const uu uy = (y > height) ? height : ((y < 0) ? 0 : y);
+            if (envelope) {
+                const int first = this->binary_index(pt), last = this->binary_index(t) + 1;
+                tops[x] = to_y(this->max_range(first, last));
+                bottoms[x] = to_y(this->min_range(first, last));
+            } else {
+                const float v = this->size() < width ? this->template interpolate_value<float>(t) : this->template avg_range_time<float>(pt-inc, t+inc);
+                //const float v = this->size() < width ? this->binary_search(t).value : this->template avg_range_time<int64_t>(pt-inc, t+inc);
+                tops[x] = bottoms[x] = to_y(v);
+            }
 
-            this->buffer.line(px + offsetx, py + offsety, x + offsetx, uy + offsety, 1);
-
-            py = uy;
-            px = x;
             pt = t;
         }
 
+        if (plot_style == SERIES_ENVELOPE)
+            this->buffer.series_envelope(tops, bottoms, width, {offsetx, offsety}, 1);
+        else
+            this->buffer.series(tops, width, {offsetx, offsety}, height, 1, plot_style);
+
         Origin text_pos(0, height+1);
         int bufsize = 30;
         char buf[bufsize];
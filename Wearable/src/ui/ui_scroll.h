@@ -0,0 +1,179 @@
+#pragma once
+
+#include "config.h"
+#include "ui.h"
+
+namespace wbl {
+namespace UI {
+
+/*
+    @brief Box that shows a taller column of children through its viewport
+
+    Children are laid out in a body as wide as the box and as tall as they
+    need, starting at the top of the box. The body is not linked into the
+    tree, the container hands it events and draws it through the frame clip
+    shifted by the rows scrolled, so children draw in body coordinates and
+    only what falls in the viewport reaches the frame.
+
+    Scrolling by fewer rows than are in view moves the pixels already drawn
+    with move_rows and repaints only the strip that came into view. With
+    overflow.y SCROLL or AUTO, DPAD_UP and DPAD_DOWN scroll by step rows and
+    keep the root from switching screens unless the body is at that end.
+    The container is sized by its style, e.g. a fixed height.
+*/
+template<typename Buffer, typename ElementT = ElementBaseT<Buffer>>
+struct ElementScrollT : public ElementT {
+    using ElementT::operator<<;
+
+    static_assert(requires { Buffer::clip; }, "Scroll containers draw through a ClippedT frame");
+
+    using Clip = typename Buffer::Clip;
+
+    ElementBaseT<Buffer> body;
+
+    // Rows of the body above the viewport, and those the frame shows
+    fb scroll = 0, drawn_scroll = 0;
+    fb step = UI_SCROLL_STEP;
+
+    // Box the body was laid out for, laid out again when it or a child's size changes
+    Size laid_out;
+    bool body_dirty = true, drawn = false;
+
+    ElementScrollT(Buffer &buffer):ElementT(buffer),body(buffer) {
+        body.parent = this;
+        this->overflow = OverflowT(HIDDEN, AUTO);
+    }
+
+    constexpr inline IElement &operator<<(IElement &element) {
+        return body.append_child(element);
+    }
+
+    // The box clipped to the frame
+    inline Size getViewport() const {
+        const Size &box = *this;
+        const fb frame_bottom = this->buffer.getHeight();
+        const fb bottom = box.getBottom() < frame_bottom ? box.getBottom() : frame_bottom;
+        return Size(box.x, box.y, box.width, bottom > box.y ? bottom - box.y : 0);
+    }
+
+    inline fb getContentHeight() const {
+        const Size &content = body;
+        return content.height;
+    }
+
+    inline fb getContentBottom() const {
+        const Size &content = body;
+        return content.getBottom();
+    }
+
+    inline fb getLastScroll() const {
+        const fb content = getContentHeight();
+        const fb view = getViewport().height;
+        return content > view ? content - view : 0;
+    }
+
+    inline bool scroll_to(const fb &rows) {
+        const fb last = getLastScroll();
+        const fb previous = scroll;
+        scroll = rows < last ? rows : last;
+        return scroll != previous;
+    }
+
+    inline bool scroll_by(const int &rows) {
+        if (rows < 0)
+            return scroll_to(fb(-rows) > scroll ? 0 : scroll + rows);
+        return scroll_to(scroll + rows);
+    }
+
+    inline bool needs_layout() const {
+        const Size &box = *this;
+        return body_dirty || laid_out.x != box.x || laid_out.y != box.y || Length(laid_out) != Length(box);
+    }
+
+    inline void layout() {
+        const Size &box = *this;
+        body << Origin(box.x, box.y);
+        body.resolve_layout();
+        laid_out = box;
+        body_dirty = false;
+        scroll_to(scroll);
+    }
+
+    void handle_event(Event *event) override {
+        // Events for the children go on to the body, a DRAW only through the viewport
+        if (event->type != Event::DRAW && (event->direction & Event::CHILDREN)) {
+            // Children measure against the frame, the body's rows while they are in it
+            const fb height = Buffer::clip.height;
+            Buffer::clip.height = getContentBottom();
+            body.dispatch_event(event);
+            Buffer::clip.height = height;
+        } else if (event->type == Event::CONTENT_SIZE)
+            body_dirty = true;
+
+        ElementT::handle_event(event);
+    }
+
+    void on_user_input(Event *event) override {
+        if (!(event->value & EventValues::RELEASED) || event->isStopDefault() || !(this->overflow.y & (SCROLL | AUTO)))
+            return;
+
+        bool scrolled = false;
+        if (event->value & EventValues::DPAD_UP)
+            scrolled = scroll_by(-int(step));
+        if (event->value & EventValues::DPAD_DOWN)
+            scrolled = scroll_by(step);
+
+        if (scrolled)
+            event->stopDefault();
+    }
+
+    void on_draw(Event *event) override {
+        Clip &clip = Buffer::clip;
+        const Clip saved = clip;
+
+        bool full = (event->value & Event::REDRAW) || !drawn || needs_layout();
+        if (needs_layout())
+            layout();
+
+        // Rows of the viewport left inside the clip, in the coordinates of the container
+        const Size view = getViewport();
+        const fb top = view.y > this->buffer.getClipTop() ? view.y : this->buffer.getClipTop();
+        const fb bottom = view.getBottom() < this->buffer.getClipBottom() ? view.getBottom() : this->buffer.getClipBottom();
+        if (top >= bottom) {
+            drawn = false;
+            return;
+        }
+
+        const Size shown(view.x, top, view.width, bottom - top);
+        const fb distance = scroll > drawn_scroll ? scroll - drawn_scroll : drawn_scroll - scroll;
+        if (!full && distance && !this->buffer.move_rows(shown, int(drawn_scroll) - int(scroll)))
+            full = true;
+
+        Event draw(Event::DRAW, full ? Event::REDRAW : event->value, Event::RDEPTH, Event::NORMAL);
+        draw.shared = event->shared;
+
+        clip = Clip { fb(top + scroll), fb(bottom + scroll), fb(saved.shift + scroll), getContentBottom() };
+        if (full)
+            this->buffer.fill(Size(view.x, top + scroll, view.width, bottom - top), 0);
+        body.dispatch_event(&draw);
+
+        // The strip that came into view
+        if (!full && distance) {
+            const fb strip = scroll > drawn_scroll ? bottom - distance : top;
+            clip.top = strip + scroll;
+            clip.bottom = strip + distance + scroll;
+            this->buffer.fill(Size(view.x, clip.top, view.width, distance), 0);
+
+            Event redraw(Event::DRAW, Event::REDRAW, Event::RDEPTH, Event::NORMAL);
+            redraw.shared = event->shared;
+            body.dispatch_event(&redraw);
+        }
+
+        clip = saved;
+        drawn_scroll = scroll;
+        drawn = true;
+    }
+};
+
+}
+}
\ No newline at end of file
@@ -13,8 +13,32 @@
 #include "wbl_func.h"
 #include "ui_func.h"
 #include "ui_log.h"
+#include "ui_list.h"
+#include "ui_scroll.h"
+#include "delta_buffer.h"
+#include "column_log.h"
+#include "segment_log.h"
+#include "sampler.h"
+#include "i2c.h"
+#include "sdcard.h"
 #include "display_timeout.h"
 #include "gps.h"
+#include "surface.h"
+#include "display_list.h"
+#include "lazy_screen.h"
+
+#if defined(USE_SCREEN_MIRROR) && !defined(__linux__)
+#include "uart.h"
+#include "screen_mirror.h"
+#endif
+
+#ifdef USE_PARALLEL_DRAW
+#include "parallel_draw.h"
+#endif
+
+#ifndef USE_SSD1351
+#include "transition.h"
+#endif
 
 using namespace wbl;
 using namespace Sprites;
@@ -22,21 +46,128 @@ using namespace Sprites;
 UI::ElementBaseT<DisplayTexture> test(display);
 UI::ElementInlineSpritesT<DisplayTexture, Atlas> spinline(display);
 UI::ElementInlineTextT<DisplayTexture, MinifontProvider> TEXT(display, minifont);
-UI::ScreenClockT<DisplayTexture> uiclock(display);
+SurfacePoolT<> surfaces;
+UI::RetainedT<DisplayTexture, UI::ScreenClockT<SurfaceTextureT<DisplayTexture>>> uiclock(display, surfaces);
 UI::ElementRootT<DisplayTexture> uiroot(display);
 auto txt = UI::ElementInlineTextT<DisplayTexture, MinifontProvider>(display, minifont);
+UI::ElementScrollT<DisplayTexture> txtscroll(display);
 UI::ElementBatteryT<DisplayTexture> uibattery(display);
-UI::ElementDateTimeT<DisplayTexture> uidatetime(display);
+UI::RecordedT<DisplayTexture, UI::ElementDateTimeT<DisplayRecorderT<DisplayTexture>>> uidatetime(display, surfaces);
 UI::ElementBaseT<DisplayTexture> boxtest(display);
 UI::ElementBaseT<DisplayTexture> boxtest2(display);
 UI::ElementBaseT<DisplayTexture> header(display);
 UI::ScreenBaseT<> mainscreen("Main");
 UI::ScreenBaseT<> clockscreen("Clock");
-UI::ScreenBaseT<> settingscreen("Settings");
-LoopBuffer sinelog, squarelog, sawlog, voltlog;
-UI::ElementLogT<DisplayTexture, DataLog> e_sinelog(display, sinelog), e_squarelog(display, squarelog), e_sawlog(display, sawlog), e_voltlog(display, voltlog);
+using WaveLog = ColumnLogT<int, LOG_BUFFER_SIZE, uu, ub, uu>;
+WaveLog wavelog;
+DeltaBuffer voltlog;
+DeltaLog voltdata(voltlog);
+UI::ScreenGovernorT<> governor;
+
+// The plots exist only while their screen is built, the logs they show are kept above
+bool build_settings(UI::LazyScreen &screen, UI::ScreenArena &arena) {
+    using namespace UI;
+    auto *sine = arena.make<UI::ElementLogT<DisplayTexture, WaveLog::log_type<0>>>(display, wavelog.column<0>());
+    auto *square = arena.make<UI::ElementLogT<DisplayTexture, WaveLog::log_type<1>>>(display, wavelog.column<1>());
+    auto *saw = arena.make<UI::ElementLogT<DisplayTexture, WaveLog::log_type<2>>>(display, wavelog.column<2>());
+    auto *volts = arena.make<UI::ElementLogT<DisplayTexture, DeltaLog>>(display, voltdata);
+    if (!sine || !square || !saw || !volts)
+        return false;
+
+    const StyleInfo logstyle = { .display{INLINE}, .width {62}, .height{40}, .margin{1} };
+
+    *saw << logstyle << "saw";
+    *volts << logstyle << "volts";
+    *sine << logstyle << "sine";
+    *square << logstyle << "square";
+
+    screen << *sine;
+    screen << *square;
+    screen << *saw;
+    screen << *volts;
+
+    return true;
+}
+
+UI::LazyScreen settingscreen("Settings", governor, build_settings);
+
+// The voltage log oldest first, one row per sample
+struct VoltRows : public UI::IListSourceT<DisplayTexture> {
+    UI::ElementListT<DisplayTexture> *list = nullptr;
+    int64_t first = 0;
+
+    uu count() override {
+        // Dropping the oldest samples moves every entry up
+        const int64_t start = voltdata.get_data_start_time();
+        if (start != first && list) {
+            first = start;
+            list->invalidate();
+        }
+        return voltdata.size();
+    }
+
+    fb row_height() override {
+        return 8;
+    }
+
+    void render(UI::ListRowT<DisplayTexture> &row, const uu &index) override {
+        const auto point = voltdata.get(index);
+        char text[32];
+        snprintf(text, sizeof(text), "%5u %8.2fs %4umV", unsigned(index), voltdata.get_data_time(point) / 1e6f, unsigned(point.value));
+        row.draw_text(text, minifont);
+    }
+};
+
+VoltRows voltrows;
+UI::ElementListT<DisplayTexture> voltlist(display, voltrows);
+UI::ScreenBaseT<> logscreen("Log");
+SDCard sdcard;
+SegmentLogT<SDCard> voltarchive(sdcard, SDLOG_FIRST_BLOCK, SDLOG_BLOCK_COUNT);
 UI::ElementLockIconT<DisplayTexture> e_lockicon(display);
 
+esp_err_t read_waves(int32_t *values) {
+    const int64_t t = micros();
+    values[0] = int32_t(sinf(float((int(t))/(M_PI * 2 * 100000)))*500.0f+1500.0f);
+    values[1] = ((t / 2000000) & 1) * 64;
+    values[2] = int32_t(t/5000)%1000;
+    return ESP_OK;
+}
+
+void store_waves(const int64_t &time, const int32_t *values) {
+    wavelog.push_back(time, (uu)values[0], (ub)values[1], (uu)values[2]);
+}
+
+esp_err_t read_volts(int32_t *values) {
+    const int64_t t = micros();
+    values[0] = 4000 + ((((t ^ 0xDEADBEEF) % 0xC0FFEE) | t) & 31);
+    return ESP_OK;
+}
+
+void store_volts(const int64_t &time, const int32_t *values) {
+    voltdata.push_back(time, (uu)values[0]);
+    voltarchive.push_back(time, (uu)values[0]);
+}
+
+// Sampler bus 1 is I2C_BUS_0, reads due together hold its arbiter off once
+SensorT<3> wavesensor("waves", 120000, 1, read_waves, store_waves);
+SensorT<1, BoxcarT<4>> voltsensor("volts", 15000, 1, read_volts, store_volts);
+Sampler sampler;
+
+#if defined(USE_SCREEN_MIRROR) && !defined(__linux__)
+MirrorUart mirroruart;
+ScreenMirrorT<MirrorUart, GME128128::PAGES, GME128128::BYTES_PER_PAGE> mirror(mirroruart, MIRROR_LAYOUT_PAGES, SCREEN_MIRROR_INTERVAL_MS * 1000, SCREEN_MIRROR_KEYFRAME_INTERVAL);
+#endif
+
+#ifdef USE_PARALLEL_DRAW
+UI::ParallelDrawT<DisplayTexture> parallel(uiroot);
+#endif
+
+// Snapshots and prerenders hold whole frames, too much for the RGB panel
+#ifndef USE_SSD1351
+UI::ScreenTransitionT<DisplayTexture> transition(display);
+SurfacePoolT<UI_PRERENDER_BYTES, UI_PRERENDERS + 1> screenpool;
+#endif
+
 void demo() {
     uibattery.set_battery_level((millis()%10000)/100);
 
@@ -64,18 +195,9 @@ void demo() {
         display.setState(!isDisplayOff);
     }
 
-    uiroot.once();
-
-    static int cnt = 0;
-    int64_t t = micros();
-    if (cnt++ % 4 == 0) {
-        e_sinelog.push_back(t, (uu)(sinf(float((int(t))/(M_PI * 2 * 100000)))*500.0f+1500.0f));
-        e_squarelog.push_back(t, (cnt & 64));
-        e_sawlog.push_back(t, (uu)(int(t/5000)%1000));
-    }
+    sampler.drain();
 
-    if (cnt % 2 == 0)
-        e_voltlog.push_back(t, (uu)(4000 + ((((t ^ 0xDEADBEEF) % 0xC0FFEE) | t) & 31)));
+    uiroot.once();
 
     int64_t time = getGPSTime();
     if (time > 0) {
@@ -118,10 +240,6 @@ void init() {
     //settingscreen << focustest;
     //settingscreen << focustest2;
     //settingscreen << focustest3;
-    settingscreen << e_sinelog;
-    settingscreen << e_squarelog;
-    settingscreen << e_sawlog;
-    settingscreen << e_voltlog;
 
     block << UI::StyleInfo { .height{26} };
     inner << StyleInfo {.height {14}};
@@ -133,14 +251,12 @@ void init() {
     block3 << StyleInfo { .width {30}, .height{20} };
     e_lockicon << StyleInfo{.display{INLINE}, .overflow{AUTO,AUTO}} << "lock";
 
-    StyleInfo logstyle = { .display{INLINE}, .width {62}, .height{40}, .margin{1} };
-
-    e_sawlog << logstyle << "saw";
-    e_voltlog << logstyle << "volts"; 
-    e_sinelog << logstyle << "sine";
-    e_squarelog << logstyle << "square";
-
     uiroot << UI::StyleInfo { .width{128}, .height{128} };
+    uiroot.overlay_pool = &surfaces;
+    #ifndef USE_SSD1351
+    uiroot.transition = &transition;
+    uiroot.prerender_pool = &screenpool;
+    #endif
 
     block << inner;
 
@@ -163,6 +279,9 @@ void init() {
     //uiclock << Size { 16, 16, 97, 97 };
     //uiclock << StyleInfo { .width{96}, .height{96}, .margin{16,4} };
     clockscreen << StyleInfo { .width{{100,PERC}}, .height{{100,PERC}} };
+    voltlist << StyleInfo { .width{{100,PERC}}, .height{{100,PERC}} };
+    voltrows.list = &voltlist;
+    logscreen << voltlist;
     uiclock << StyleInfo { .align{CENTER}, .width{{85,PERC}}, .height{{85, PERC}} };
     TEXT << Origin { 12, 16 };
     test.wrap = (UI::WrapStyle)(UI::WrapStyle::WRAP | UI::WrapStyle::TRIM_SPACE);
@@ -175,6 +294,7 @@ void init() {
     boxtest << Size { 8, 13, 5, 5 };
     boxtest2 << Size { 9, 14, 3, 3 };
     txt << StyleInfo { .align{CENTER}, .width{{70}}, .margin{4} };
+    txtscroll << StyleInfo { .width{{100,PERC}}, .height{{24}}, .overflow{AUTO} };
     uiclock.use_milliseconds = true;
 
     TEXT.text = "Hello UI";
@@ -193,6 +313,7 @@ void init() {
     //uiroot << uibattery;
     //uiroot << uidatetime;
     txt.name = "txt";
+    txtscroll.name = "txtscroll";
     header.name = "header";
     uibattery.name = "battery";
     uidatetime.name = "datetime";
@@ -211,9 +332,11 @@ void init() {
     //uiroot << screenclock;
     //uiroot << screenclocknoheader;
     clockscreen << uiclock;
-    mainscreen << txt;
+    mainscreen << txtscroll;
+    txtscroll << txt;
     mainscreen.set_left(clockscreen);
     mainscreen.set_right(settingscreen);
+    settingscreen.set_right(logscreen);
 
     uiroot.set_header(header);
     //uiroot.set_screen(mainscreen);
@@ -236,6 +359,22 @@ void app_main() {
         goto end;
     } else {
         printf("Display initialized\n");
+        if (sdcard.init() != ESP_OK || voltarchive.recover() != ESP_OK || voltarchive.start() != ESP_OK)
+            printf("SD card log unavailable\n");
+        sampler.set_bus(1, I2CArbiter::acquire_bus, I2CArbiter::release_bus, &I2C_BUS_0::arbiter());
+        if (sampler.add(wavesensor) != ESP_OK || sampler.add(voltsensor) != ESP_OK || sampler.start() != ESP_OK)
+            printf("Sampler unavailable\n");
+        #if defined(USE_SCREEN_MIRROR) && !defined(__linux__)
+        if (mirroruart.init() == ESP_OK) {
+            display.on_flush = [](const uint8_t *frame) { mirror.update(frame); };
+            mirror.start();
+        } else
+            printf("Screen mirror unavailable\n");
+        #endif
+        #ifdef USE_PARALLEL_DRAW
+        if (parallel.start() != ESP_OK)
+            printf("Parallel draw unavailable\n");
+        #endif
         display.clear(0);
         display.flush();
         while (1) {